@@ -0,0 +1,32 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_counter.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+static atomic<uint64_t> allocation_count{0};
+static atomic<uint64_t> allocation_bytes{0};
+//-------------------------------------------------------------------------------------------------------------
+AllocationCounters GetAllocationCounters() {
+    return {allocation_count.load(memory_order_relaxed), allocation_bytes.load(memory_order_relaxed)};
+}
+//-------------------------------------------------------------------------------------------------------------
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    allocation_bytes.fetch_add(size, memory_order_relaxed);
+    if (void* pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+//-------------------------------------------------------------------------------------------------------------
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+//-------------------------------------------------------------------------------------------------------------
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+//-------------------------------------------------------------------------------------------------------------
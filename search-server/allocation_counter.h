@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Счетчики замененного глобального operator new. Подключается только в бенчмарк: замена действует
+ *  на весь процесс, включая потоки параллельных алгоритмов. Аллокации с выравниванием (align_val_t) не считаются */
+struct AllocationCounters {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+//-------------------------------------------------------------------------------------------------------------
+AllocationCounters GetAllocationCounters();
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,345 @@
+#include <chrono>
+#include <execution>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "corpus_generator.h"
+#include "latency_histogram.h"
+#include "perf_counters.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Размеры синтетического корпуса и запросов, задаются аргументами --имя=значение */
+struct BenchmarkConfig {
+    int document_count = 10'000;
+    int vocabulary_size = 1'000;
+    int max_word_length = 10;
+    int document_word_count = 70;
+    int query_count = 100;
+    int query_word_count = 70;
+    /** Сколько раз прогоняется набор запросов в замерах поиска */
+    int repetitions = 1;
+    /** Сколько документов удаляется в замерах RemoveDocument */
+    int removal_count = 1'000;
+    unsigned seed = mt19937::default_seed;
+    bool is_json = false;
+};
+//-------------------------------------------------------------------------------------------------------------
+struct BenchmarkResult {
+    string name;
+    uint64_t operation_count = 0;
+    uint64_t total_ns = 0;
+    uint64_t allocation_count = 0;
+    uint64_t allocation_bytes = 0;
+    /** Счетчики процессора потока, запустившего замер: в параллельных замерах работа потоков TBB в них не попадает */
+    PerfCounterSample counters;
+
+    double NanosecondsPerOperation() const {
+        return operation_count == 0 ? 0.0 : static_cast<double>(total_ns) / operation_count;
+    }
+
+    double OperationsPerSecond() const {
+        return total_ns == 0 ? 0.0 : operation_count * 1e9 / total_ns;
+    }
+
+    double AllocationsPerOperation() const {
+        return operation_count == 0 ? 0.0 : static_cast<double>(allocation_count) / operation_count;
+    }
+
+    double BytesPerOperation() const {
+        return operation_count == 0 ? 0.0 : static_cast<double>(allocation_bytes) / operation_count;
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Задержки фаз запросов FindTopDocuments за все замеры поиска, есть только в сборке с SEARCH_SERVER_PHASE_TIMING */
+struct PhaseResult {
+    QueryPhase phase;
+    LatencySnapshot latency;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Результаты замеров складываются сюда, чтобы компилятор не выбросил вызовы */
+static volatile double benchmark_sink = 0.0;
+//-------------------------------------------------------------------------------------------------------------
+template <typename Function>
+static BenchmarkResult Measure(string name, uint64_t operation_count, Function function) {
+    const AllocationCounters before = GetAllocationCounters();
+    const PerfCounterSample counters_before = ThreadPerfCounters().Read();
+    const auto start = chrono::steady_clock::now();
+    function();
+    const auto duration = chrono::steady_clock::now() - start;
+    const PerfCounterSample counters_after = ThreadPerfCounters().Read();
+    const AllocationCounters after = GetAllocationCounters();
+    return {move(name), operation_count, static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(duration).count()),
+            after.count - before.count, after.bytes - before.bytes, counters_after - counters_before};
+}
+//-------------------------------------------------------------------------------------------------------------
+static BenchmarkConfig ParseArguments(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    const auto parse_int = [](const string& value) {
+        size_t parsed = 0;
+        const int result = stoi(value, &parsed);
+        if (parsed != value.size() || result <= 0) {
+            throw invalid_argument("expected positive integer, got "s + value);
+        }
+        return result;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        if (argument == "--json"s) {
+            config.is_json = true;
+            continue;
+        }
+        const size_t equal = argument.find('=');
+        if (argument.rfind("--"s, 0) != 0 || equal == string::npos) {
+            throw invalid_argument("unknown argument "s + argument);
+        }
+        const string name = argument.substr(2, equal - 2);
+        const string value = argument.substr(equal + 1);
+        if (name == "documents"s) {
+            config.document_count = parse_int(value);
+        } else if (name == "vocabulary"s) {
+            config.vocabulary_size = parse_int(value);
+        } else if (name == "max-word-length"s) {
+            config.max_word_length = parse_int(value);
+        } else if (name == "document-words"s) {
+            config.document_word_count = parse_int(value);
+        } else if (name == "queries"s) {
+            config.query_count = parse_int(value);
+        } else if (name == "query-words"s) {
+            config.query_word_count = parse_int(value);
+        } else if (name == "repetitions"s) {
+            config.repetitions = parse_int(value);
+        } else if (name == "removals"s) {
+            config.removal_count = parse_int(value);
+        } else if (name == "seed"s) {
+            config.seed = static_cast<unsigned>(parse_int(value));
+        } else {
+            throw invalid_argument("unknown argument "s + argument);
+        }
+    }
+    return config;
+}
+//-------------------------------------------------------------------------------------------------------------
+static unique_ptr<SearchServer> BuildServer(const vector<string>& dictionary, const vector<string>& documents,
+                                            int copy_count = 1) {
+    auto server = make_unique<SearchServer>(dictionary[0]);
+    for (int copy = 0; copy < copy_count; ++copy) {
+        for (size_t i = 0; i < documents.size(); ++i) {
+            server->AddDocument(static_cast<int>(copy * documents.size() + i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    return server;
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename DocumentPredicate>
+static BenchmarkResult BenchmarkFindTopDocuments(string name, ExecutionPolicy&& policy, const SearchServer& server,
+                                                 const vector<string>& queries, int repetitions,
+                                                 DocumentPredicate document_predicate) {
+    return Measure(move(name), queries.size() * repetitions, [&] {
+        double total_relevance = 0.0;
+        for (int repetition = 0; repetition < repetitions; ++repetition) {
+            for (const string& query : queries) {
+                for (const Document& document : server.FindTopDocuments(policy, query, document_predicate)) {
+                    total_relevance += document.relevance;
+                }
+            }
+        }
+        benchmark_sink = benchmark_sink + total_relevance;
+    });
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy>
+static BenchmarkResult BenchmarkMatchDocument(string name, ExecutionPolicy&& policy, const SearchServer& server,
+                                              const vector<string>& queries, int repetitions) {
+    const int document_count = server.GetDocumentCount();
+    return Measure(move(name), queries.size() * repetitions, [&] {
+        size_t matched_word_count = 0;
+        for (int repetition = 0; repetition < repetitions; ++repetition) {
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto [words, status] = server.MatchDocument(policy, queries[i], static_cast<int>(i % document_count));
+                matched_word_count += words.size();
+            }
+        }
+        benchmark_sink = benchmark_sink + matched_word_count;
+    });
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy>
+static BenchmarkResult BenchmarkRemoveDocument(string name, ExecutionPolicy&& policy, const vector<string>& dictionary,
+                                               const vector<string>& documents, int removal_count) {
+    // удаляются документы, равномерно разбросанные по корпусу, сервер строится вне замера
+    const unique_ptr<SearchServer> server = BuildServer(dictionary, documents);
+    const int document_count = static_cast<int>(documents.size());
+    removal_count = min(removal_count, document_count);
+    return Measure(move(name), removal_count, [&] {
+        for (int i = 0; i < removal_count; ++i) {
+            server->RemoveDocument(policy, static_cast<int>(static_cast<int64_t>(i) * document_count / removal_count));
+        }
+    });
+}
+//-------------------------------------------------------------------------------------------------------------
+static BenchmarkResult BenchmarkRemoveDuplicates(const vector<string>& dictionary, const vector<string>& documents) {
+    // каждый документ добавлен дважды, половина сервера - дубликаты
+    const unique_ptr<SearchServer> server = BuildServer(dictionary, documents, 2);
+    const uint64_t document_count = server->GetDocumentCount();
+    return Measure("remove_duplicates"s, document_count, [&] {
+        benchmark_sink = benchmark_sink + RemoveDuplicates(*server).size();
+    });
+}
+//-------------------------------------------------------------------------------------------------------------
+static void PrintTable(ostream& out, const vector<BenchmarkResult>& results, const vector<PhaseResult>& phases) {
+    // столбцы счетчиков процессора печатаются, только если счетчики доступны
+    const bool has_counters = !results.empty() && results.front().counters.HasAny();
+    out << left << setw(36) << "benchmark"s << right << setw(10) << "ops"s << setw(14) << "ns/op"s << setw(14) << "ops/s"s
+        << setw(12) << "allocs/op"s << setw(14) << "bytes/op"s;
+    if (has_counters) {
+        out << setw(8) << "ipc"s << setw(14) << "llc-miss/op"s << setw(14) << "br-miss/op"s;
+    }
+    out << '\n';
+    out << fixed << setprecision(1);
+    for (const BenchmarkResult& result : results) {
+        out << left << setw(36) << result.name << right << setw(10) << result.operation_count
+            << setw(14) << result.NanosecondsPerOperation() << setw(14) << result.OperationsPerSecond()
+            << setw(12) << result.AllocationsPerOperation() << setw(14) << result.BytesPerOperation();
+        if (has_counters) {
+            out << setprecision(2) << setw(8) << result.counters.InstructionsPerCycle() << setprecision(1)
+                << setw(14) << result.counters.PerOperation(PerfCounter::LLC_MISSES, result.operation_count)
+                << setw(14) << result.counters.PerOperation(PerfCounter::BRANCH_MISSES, result.operation_count);
+        }
+        out << '\n';
+    }
+    if (!has_counters) {
+        out << "(perf counters unavailable: no ipc and miss columns)\n"s;
+    }
+    if (phases.empty()) {
+        return;
+    }
+    out << '\n' << left << setw(36) << "query phase"s << right << setw(10) << "count"s << setw(14) << "p50 ns"s
+        << setw(14) << "p99 ns"s << setw(14) << "p999 ns"s << setw(14) << "max ns"s << '\n';
+    for (const PhaseResult& phase : phases) {
+        out << left << setw(36) << QueryPhaseName(phase.phase) << right << setw(10) << phase.latency.count
+            << setw(14) << phase.latency.p50_ns << setw(14) << phase.latency.p99_ns << setw(14) << phase.latency.p999_ns
+            << setw(14) << phase.latency.max_ns << '\n';
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+static void PrintJson(ostream& out, const BenchmarkConfig& config, const vector<BenchmarkResult>& results,
+                      const vector<PhaseResult>& phases) {
+    out << "{\n  \"config\": {"s
+        << "\"documents\": "s << config.document_count
+        << ", \"vocabulary\": "s << config.vocabulary_size
+        << ", \"max_word_length\": "s << config.max_word_length
+        << ", \"document_words\": "s << config.document_word_count
+        << ", \"queries\": "s << config.query_count
+        << ", \"query_words\": "s << config.query_word_count
+        << ", \"repetitions\": "s << config.repetitions
+        << ", \"removals\": "s << config.removal_count
+        << ", \"seed\": "s << config.seed << "},\n  \"results\": [\n"s;
+    out << setprecision(3) << fixed;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        out << "    {\"name\": \""s << result.name << "\", \"operations\": "s << result.operation_count
+            << ", \"total_ns\": "s << result.total_ns
+            << ", \"ns_per_op\": "s << result.NanosecondsPerOperation()
+            << ", \"ops_per_sec\": "s << result.OperationsPerSecond()
+            << ", \"allocations_per_op\": "s << result.AllocationsPerOperation()
+            << ", \"bytes_per_op\": "s << result.BytesPerOperation();
+        // недоступный счетчик - null
+        const auto write_counter = [&out](const char* name, bool is_available, double value) {
+            out << ", \""s << name << "\": "s;
+            if (is_available) {
+                out << value;
+            } else {
+                out << "null"s;
+            }
+        };
+        const PerfCounterSample& counters = result.counters;
+        write_counter("ipc", counters.Has(PerfCounter::CYCLES) && counters.Has(PerfCounter::INSTRUCTIONS), counters.InstructionsPerCycle());
+        write_counter("cycles_per_op", counters.Has(PerfCounter::CYCLES), counters.PerOperation(PerfCounter::CYCLES, result.operation_count));
+        write_counter("instructions_per_op", counters.Has(PerfCounter::INSTRUCTIONS),
+                      counters.PerOperation(PerfCounter::INSTRUCTIONS, result.operation_count));
+        write_counter("llc_misses_per_op", counters.Has(PerfCounter::LLC_MISSES),
+                      counters.PerOperation(PerfCounter::LLC_MISSES, result.operation_count));
+        write_counter("branch_misses_per_op", counters.Has(PerfCounter::BRANCH_MISSES),
+                      counters.PerOperation(PerfCounter::BRANCH_MISSES, result.operation_count));
+        out << "}"s << (i + 1 < results.size() ? ",\n"s : "\n"s);
+    }
+    out << "  ],\n  \"phases\": [\n"s;
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const LatencySnapshot& latency = phases[i].latency;
+        out << "    {\"name\": \""s << QueryPhaseName(phases[i].phase) << "\", \"count\": "s << latency.count
+            << ", \"min_ns\": "s << latency.min_ns << ", \"p50_ns\": "s << latency.p50_ns
+            << ", \"p99_ns\": "s << latency.p99_ns << ", \"p999_ns\": "s << latency.p999_ns
+            << ", \"max_ns\": "s << latency.max_ns << "}"s << (i + 1 < phases.size() ? ",\n"s : "\n"s);
+    }
+    out << "  ]\n}\n"s;
+}
+//-------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    try {
+        config = ParseArguments(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << "\nusage: benchmark [--documents=N] [--vocabulary=N] [--max-word-length=N] [--document-words=N]"
+                            " [--queries=N] [--query-words=N] [--repetitions=N] [--removals=N] [--seed=N] [--json]"s << endl;
+        return 1;
+    }
+
+    mt19937 generator(config.seed);
+    const vector<string> dictionary = GenerateDictionary(generator, config.vocabulary_size, config.max_word_length);
+    const vector<string> documents = GenerateQueries(generator, dictionary, config.document_count, config.document_word_count);
+    const vector<string> queries = GenerateQueries(generator, dictionary, config.query_count, config.query_word_count);
+
+    vector<BenchmarkResult> results;
+    unique_ptr<SearchServer> server;
+    results.push_back(Measure("index_build"s, documents.size(), [&] {
+        server = BuildServer(dictionary, documents);
+    }));
+
+    const auto even_id = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+    ResetQueryPhases();
+    results.push_back(BenchmarkFindTopDocuments("find_top_documents/seq/status"s, execution::seq, *server, queries,
+                                                config.repetitions, DocumentStatus::ACTUAL));
+    results.push_back(BenchmarkFindTopDocuments("find_top_documents/par/status"s, execution::par, *server, queries,
+                                                config.repetitions, DocumentStatus::ACTUAL));
+    results.push_back(BenchmarkFindTopDocuments("find_top_documents/seq/predicate"s, execution::seq, *server, queries,
+                                                config.repetitions, even_id));
+    results.push_back(BenchmarkFindTopDocuments("find_top_documents/par/predicate"s, execution::par, *server, queries,
+                                                config.repetitions, even_id));
+    results.push_back(BenchmarkMatchDocument("match_document/seq"s, execution::seq, *server, queries, config.repetitions));
+    results.push_back(BenchmarkMatchDocument("match_document/par"s, execution::par, *server, queries, config.repetitions));
+    results.push_back(Measure("process_queries"s, queries.size() * config.repetitions, [&] {
+        for (int repetition = 0; repetition < config.repetitions; ++repetition) {
+            benchmark_sink = benchmark_sink + ProcessQueries(*server, queries).size();
+        }
+    }));
+    vector<PhaseResult> phases;
+    for (const QueryPhase phase : {QueryPhase::PARSE, QueryPhase::POSTINGS, QueryPhase::MINUS_WORDS, QueryPhase::TOP_K}) {
+        if (const LatencySnapshot latency = QueryPhaseSnapshot(phase); latency.count > 0) {
+            phases.push_back({phase, latency});
+        }
+    }
+    server.reset();
+    results.push_back(BenchmarkRemoveDocument("remove_document/seq"s, execution::seq, dictionary, documents, config.removal_count));
+    results.push_back(BenchmarkRemoveDocument("remove_document/par"s, execution::par, dictionary, documents, config.removal_count));
+    results.push_back(BenchmarkRemoveDuplicates(dictionary, documents));
+
+    if (config.is_json) {
+        PrintJson(cout, config, results, phases);
+    } else {
+        PrintTable(cout, results, phases);
+    }
+    return 0;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+TEMPLATE = app
+TARGET = benchmark
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG -= qt
+DEFINES += SEARCH_SERVER_PHASE_TIMING
+
+SOURCES += \
+  allocation_counter.cpp \
+  benchmark.cpp \
+  corpus_generator.cpp \
+        document.cpp \
+  document_attributes.cpp \
+  document_filter.cpp \
+  fingerprint.cpp \
+  index_checkpoint.cpp \
+  index_memory_resource.cpp \
+  latency_histogram.cpp \
+  levenshtein_automaton.cpp \
+  memory_stats.cpp \
+  perf_counters.cpp \
+  position_encoding.cpp \
+  posting_intersection.cpp \
+  process_queries.cpp \
+  query_explain.cpp \
+  query_statistics.cpp \
+        read_input_functions.cpp \
+        request_queue.cpp \
+  scorer.cpp \
+  search_page.cpp \
+        search_server.cpp \
+  stop_word_filter.cpp \
+        string_processing.cpp \
+  text_analyzer.cpp \
+    remove_duplicates.cpp
+
+HEADERS += \
+  allocation_counter.h \
+  concurrent_map.h \
+  corpus_generator.h \
+  document.h \
+  document_attributes.h \
+  document_filter.h \
+  fingerprint.h \
+  index_checkpoint.h \
+  index_memory_resource.h \
+  latency_histogram.h \
+  levenshtein_automaton.h \
+  log_duration.h \
+  memory_stats.h \
+  paginator.h \
+  perf_counters.h \
+  position_encoding.h \
+  posting_intersection.h \
+  posting_list.h \
+  process_queries.h \
+  query_explain.h \
+  query_statistics.h \
+  read_input_functions.h \
+  request_queue.h \
+  scorer.h \
+  search_page.h \
+  search_server.h \
+  stop_word_filter.h \
+  string_processing.h \
+  text_analyzer.h \
+    remove_duplicates.h
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+#include "corpus_generator.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+string GenerateWord(mt19937& generator, int max_length) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    return word;
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    for (int i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    words.erase(unique(words.begin(), words.end()), words.end());
+    return words;
+}
+//-------------------------------------------------------------------------------------------------------------
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob) {
+    string query;
+    for (int i = 0; i < word_count; ++i) {
+        if (!query.empty()) {
+            query.push_back(' ');
+        }
+        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            query.push_back('-');
+        }
+        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+    }
+    return query;
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
+    vector<string> queries;
+    queries.reserve(query_count);
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+    }
+    return queries;
+}
+//-------------------------------------------------------------------------------------------------------------
+ZipfDistribution::ZipfDistribution(size_t count, double exponent) {
+    if (count == 0 || !(exponent >= 0.0)) {
+        throw invalid_argument("Zipf distribution needs count > 0 and exponent >= 0"s);
+    }
+    cumulative_.reserve(count);
+    double sum = 0.0;
+    for (size_t rank = 0; rank < count; ++rank) {
+        sum += 1.0 / pow(static_cast<double>(rank + 1), exponent);
+        cumulative_.push_back(sum);
+    }
+    for (double& value : cumulative_) {
+        value /= sum;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t ZipfDistribution::operator()(mt19937& generator) const {
+    const double value = uniform_real_distribution<>(0, 1)(generator);
+    const auto it = upper_bound(cumulative_.begin(), cumulative_.end(), value);
+    return min(static_cast<size_t>(it - cumulative_.begin()), cumulative_.size() - 1);
+}
+//-------------------------------------------------------------------------------------------------------------
+double ZipfDistribution::Probability(size_t rank) const {
+    return rank == 0 ? cumulative_[0] : cumulative_.at(rank) - cumulative_[rank - 1];
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<string> GenerateUniqueDictionary(mt19937& generator, int word_count, int max_length) {
+    vector<string> words;
+    words.reserve(word_count);
+    unordered_set<string> seen;
+    // слов из букв a-z длиной до max_length может не хватить, число попыток ограничено
+    for (int64_t attempts = int64_t{word_count} * 100; static_cast<int>(words.size()) < word_count; --attempts) {
+        if (attempts == 0) {
+            throw invalid_argument("not enough distinct words of length up to "s + to_string(max_length));
+        }
+        string word = GenerateWord(generator, max_length);
+        if (seen.insert(word).second) {
+            words.push_back(move(word));
+        }
+    }
+    return words;
+}
+//-------------------------------------------------------------------------------------------------------------
+static int GenerateDocumentLength(mt19937& generator, const WorkloadConfig& config) {
+    const int mean = config.mean_document_length;
+    switch (config.document_length_distribution) {
+    case DocumentLengthDistribution::FIXED:
+        return mean;
+    case DocumentLengthDistribution::UNIFORM:
+        return uniform_int_distribution(1, 2 * mean - 1)(generator);
+    case DocumentLengthDistribution::LOG_NORMAL: {
+        // среднее логнормального распределения exp(mu + sigma^2 / 2)
+        const double sigma = config.document_length_sigma;
+        const double mu = log(static_cast<double>(mean)) - sigma * sigma / 2;
+        return max(1, static_cast<int>(lround(lognormal_distribution<>(mu, sigma)(generator))));
+    }
+    }
+    return mean;
+}
+//-------------------------------------------------------------------------------------------------------------
+static string GenerateZipfText(mt19937& generator, const vector<string>& dictionary, const ZipfDistribution& words,
+                               int word_count, double minus_prob) {
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        if (minus_prob > 0 && uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            text.push_back('-');
+        }
+        text += dictionary[words(generator)];
+    }
+    return text;
+}
+//-------------------------------------------------------------------------------------------------------------
+Workload GenerateWorkload(const WorkloadConfig& config) {
+    if (config.vocabulary_size <= 0 || config.document_count < 0 || config.operation_count < 0 || config.mean_document_length <= 0
+        || config.query_word_count <= 0 || config.distinct_query_count <= 0 || !(config.churn_ratio >= 0.0 && config.churn_ratio <= 1.0)) {
+        throw invalid_argument("invalid workload config"s);
+    }
+    mt19937 generator(config.seed);
+    const vector<string> dictionary = GenerateUniqueDictionary(generator, config.vocabulary_size, config.max_word_length);
+    const ZipfDistribution words(dictionary.size(), config.word_exponent);
+    const auto generate_document = [&] {
+        return GenerateZipfText(generator, dictionary, words, GenerateDocumentLength(generator, config), 0);
+    };
+
+    Workload workload;
+    // живые id для REMOVE: удаление - обмен с последним
+    vector<int> live_ids;
+    int next_id = 0;
+    for (; next_id < config.document_count; ++next_id) {
+        workload.corpus.push_back({WorkloadOperation::Type::ADD, next_id, generate_document()});
+        live_ids.push_back(next_id);
+    }
+
+    vector<string> query_pool;
+    query_pool.reserve(config.distinct_query_count);
+    for (int i = 0; i < config.distinct_query_count; ++i) {
+        // слово могло стать и плюс-, и минус-словом, такой запрос все равно корректен
+        query_pool.push_back(GenerateZipfText(generator, dictionary, words, config.query_word_count, config.minus_word_prob));
+    }
+    const ZipfDistribution queries(query_pool.size(), config.query_exponent);
+
+    workload.operations.reserve(config.operation_count);
+    for (int i = 0; i < config.operation_count; ++i) {
+        if (config.churn_ratio > 0 && uniform_real_distribution<>(0, 1)(generator) < config.churn_ratio) {
+            if (live_ids.empty() || uniform_int_distribution(0, 1)(generator) == 0) {
+                workload.operations.push_back({WorkloadOperation::Type::ADD, next_id, generate_document()});
+                live_ids.push_back(next_id++);
+            } else {
+                const size_t index = uniform_int_distribution<size_t>(0, live_ids.size() - 1)(generator);
+                workload.operations.push_back({WorkloadOperation::Type::REMOVE, live_ids[index], {}});
+                live_ids[index] = live_ids.back();
+                live_ids.pop_back();
+            }
+            continue;
+        }
+        workload.operations.push_back({WorkloadOperation::Type::QUERY, 0, query_pool[queries(generator)]});
+    }
+    return workload;
+}
+//-------------------------------------------------------------------------------------------------------------
+void WriteWorkloadOperations(ostream& out, const vector<WorkloadOperation>& operations) {
+    for (const WorkloadOperation& operation : operations) {
+        switch (operation.type) {
+        case WorkloadOperation::Type::ADD:
+            out << "add\t"s << operation.document_id << '\t' << operation.text << '\n';
+            break;
+        case WorkloadOperation::Type::REMOVE:
+            out << "remove\t"s << operation.document_id << '\n';
+            break;
+        case WorkloadOperation::Type::QUERY:
+            out << "query\t"s << operation.text << '\n';
+            break;
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<WorkloadOperation> ReadWorkloadOperations(istream& in) {
+    vector<WorkloadOperation> operations;
+    string line;
+    for (size_t line_number = 1; getline(in, line); ++line_number) {
+        if (line.empty()) {
+            continue;
+        }
+        const auto fail = [line_number]() {
+            return invalid_argument("bad workload line "s + to_string(line_number));
+        };
+        const size_t tab = line.find('\t');
+        if (tab == string::npos) {
+            throw fail();
+        }
+        const string_view type = string_view(line).substr(0, tab);
+        const string_view argument = string_view(line).substr(tab + 1);
+        WorkloadOperation operation;
+        if (type == "query"sv) {
+            operation.text = string(argument);
+        } else if (type == "add"sv || type == "remove"sv) {
+            const size_t id_end = argument.find('\t');
+            if ((type == "add"sv) != (id_end != string_view::npos)) {
+                throw fail();
+            }
+            const string id(argument.substr(0, id_end));
+            size_t parsed = 0;
+            try {
+                operation.document_id = stoi(id, &parsed);
+            } catch (const exception&) {
+                throw fail();
+            }
+            if (parsed != id.size()) {
+                throw fail();
+            }
+            if (type == "add"sv) {
+                operation.type = WorkloadOperation::Type::ADD;
+                operation.text = string(argument.substr(id_end + 1));
+            } else {
+                operation.type = WorkloadOperation::Type::REMOVE;
+            }
+        } else {
+            throw fail();
+        }
+        operations.push_back(move(operation));
+    }
+    return operations;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Синтетические корпуса и запросы для main и benchmark: слова из букв a-z, слова запроса
+ *  выбираются из словаря равновероятно. GenerateWorkload дает нагрузку с распределением Ципфа для workload_tool */
+//-------------------------------------------------------------------------------------------------------------
+std::string GenerateWord(std::mt19937& generator, int max_length);
+//-------------------------------------------------------------------------------------------------------------
+/** word_count случайных слов длиной до max_length, соседние повторы удалены */
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+//-------------------------------------------------------------------------------------------------------------
+/** word_count слов словаря через пробел, каждое с вероятностью minus_prob - минус-слово */
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count,
+                          double minus_prob = 0);
+//-------------------------------------------------------------------------------------------------------------
+/** query_count запросов ровно по max_word_count слов (так же генерируются и тексты документов) */
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary,
+                                         int query_count, int max_word_count);
+//-------------------------------------------------------------------------------------------------------------
+/** Номер от 0 до count - 1 с вероятностью, пропорциональной 1 / (номер + 1)^exponent; exponent 0 - равновероятно.
+ *  Выбор - двоичный поиск по накопленным вероятностям */
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t count, double exponent);
+
+    size_t operator()(std::mt19937& generator) const;
+
+    double Probability(size_t rank) const;
+
+private:
+    std::vector<double> cumulative_;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** word_count разных слов длиной до max_length; если столько разных слов не набирается, бросает invalid_argument */
+std::vector<std::string> GenerateUniqueDictionary(std::mt19937& generator, int word_count, int max_length);
+//-------------------------------------------------------------------------------------------------------------
+enum class DocumentLengthDistribution {
+    FIXED,      // все документы длины mean
+    UNIFORM,    // равновероятно от 1 до 2 * mean - 1
+    LOG_NORMAL, // логнормальное со средним mean и параметром sigma: много коротких документов и длинный хвост
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Параметры нагрузки GenerateWorkload. Популярность слов и в документах, и в запросах - распределение Ципфа
+ *  по номеру слова в словаре, запросы выбираются по Ципфу из пула distinct_query_count запросов */
+struct WorkloadConfig {
+    int vocabulary_size = 10'000;
+    int max_word_length = 10;
+    double word_exponent = 1.0;
+    int document_count = 10'000;
+    DocumentLengthDistribution document_length_distribution = DocumentLengthDistribution::LOG_NORMAL;
+    int mean_document_length = 70;
+    double document_length_sigma = 0.75;
+    int operation_count = 10'000;
+    int query_word_count = 3;
+    double minus_word_prob = 0.1;
+    int distinct_query_count = 1'000;
+    double query_exponent = 1.0;
+    /** Доля операций, добавляющих или удаляющих документ (поровну) */
+    double churn_ratio = 0.0;
+    unsigned seed = std::mt19937::default_seed;
+};
+//-------------------------------------------------------------------------------------------------------------
+struct WorkloadOperation {
+    enum class Type {
+        ADD,
+        REMOVE,
+        QUERY,
+    };
+
+    Type type = Type::QUERY;
+    int document_id = 0;
+    /** Текст документа для ADD, текст запроса для QUERY */
+    std::string text;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Начальный корпус (только ADD) и поток операций над ним. REMOVE удаляет только существующие документы */
+struct Workload {
+    std::vector<WorkloadOperation> corpus;
+    std::vector<WorkloadOperation> operations;
+};
+//-------------------------------------------------------------------------------------------------------------
+Workload GenerateWorkload(const WorkloadConfig& config);
+//-------------------------------------------------------------------------------------------------------------
+/** Журнал операций - по строке на операцию: "add\t<id>\t<текст>", "remove\t<id>", "query\t<текст>" */
+void WriteWorkloadOperations(std::ostream& out, const std::vector<WorkloadOperation>& operations);
+//-------------------------------------------------------------------------------------------------------------
+/** Читает журнал WriteWorkloadOperations; строка без известной операции - invalid_argument с номером строки */
+std::vector<WorkloadOperation> ReadWorkloadOperations(std::istream& in);
+//-------------------------------------------------------------------------------------------------------------
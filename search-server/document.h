@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <iostream>
+#include <string_view>
 #include <vector>
 //-------------------------------------------------------------------------------------------------------------
 enum class DocumentStatus {
@@ -20,6 +21,13 @@ struct Document {
     int rating = 0;
 };
 //-------------------------------------------------------------------------------------------------------------
+/** Результат MatchDocument для одного документа: найденные в нем плюс-слова запроса и его статус */
+struct DocumentMatch {
+    int id = 0;
+    std::vector<std::string_view> words;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+};
+//-------------------------------------------------------------------------------------------------------------
 std::ostream& operator<<(std::ostream& out, const Document& document);
 //-------------------------------------------------------------------------------------------------------------
 void PrintDocument(const Document& document);
@@ -0,0 +1,54 @@
+#include "document_attributes.h"
+#include "memory_stats.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+DocumentAttributeStore::DocumentAttributeStore(pmr::memory_resource* resource)
+    : columns_(MakeColumns(resource, make_index_sequence<static_cast<size_t>(DocumentAttribute::COUNT)>{}))
+    , free_ordinals_(resource) {
+}
+//-------------------------------------------------------------------------------------------------------------
+uint32_t DocumentAttributeStore::Add(int rating, DocumentStatus status) {
+    uint32_t ordinal;
+    if (free_ordinals_.empty()) {
+        ordinal = static_cast<uint32_t>(GetOrdinalCount());
+        for (auto& column : columns_) {
+            column.push_back(0);
+        }
+    } else {
+        ordinal = free_ordinals_.back();
+        free_ordinals_.pop_back();
+    }
+    columns_[static_cast<size_t>(DocumentAttribute::RATING)][ordinal] = rating;
+    columns_[static_cast<size_t>(DocumentAttribute::STATUS)][ordinal] = static_cast<int32_t>(status);
+    return ordinal;
+}
+//-------------------------------------------------------------------------------------------------------------
+void DocumentAttributeStore::Remove(uint32_t ordinal) {
+    free_ordinals_.push_back(ordinal);
+}
+//-------------------------------------------------------------------------------------------------------------
+void DocumentAttributeStore::SetStatus(uint32_t ordinal, DocumentStatus status) {
+    columns_[static_cast<size_t>(DocumentAttribute::STATUS)][ordinal] = static_cast<int32_t>(status);
+}
+//-------------------------------------------------------------------------------------------------------------
+const pmr::vector<int32_t>& DocumentAttributeStore::GetColumn(DocumentAttribute attribute) const {
+    return columns_.at(static_cast<size_t>(attribute));
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t DocumentAttributeStore::GetOrdinalCount() const {
+    return columns_[0].size();
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t DocumentAttributeStore::PayloadBytes() const {
+    return columns_.size() * GetOrdinalCount() * sizeof(int32_t) + free_ordinals_.size() * sizeof(uint32_t);
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t DocumentAttributeStore::AllocatedBytes() const {
+    size_t bytes = free_ordinals_.capacity() == 0 ? 0 : MallocChunkBytes(free_ordinals_.capacity() * sizeof(uint32_t));
+    for (const auto& column : columns_) {
+        bytes += column.capacity() == 0 ? 0 : MallocChunkBytes(column.capacity() * sizeof(int32_t));
+    }
+    return bytes;
+}
+//-------------------------------------------------------------------------------------------------------------
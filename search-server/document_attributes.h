@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+
+//-------------------------------------------------------------------------------------------------------------
+/** Числовые атрибуты документа. Новый атрибут - новое значение перечисления перед COUNT */
+enum class DocumentAttribute {
+    RATING,
+    STATUS,
+    COUNT,
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Атрибуты документов по столбцам: значение атрибута документа лежит в столбце по его порядковому
+ *  номеру (ordinal). Номера плотные, освободившиеся при удалении используются повторно, поэтому
+ *  фильтры проходят столбцы подряд блоками */
+class DocumentAttributeStore {
+public:
+    /** Столбцы и список свободных номеров берут память у resource */
+    explicit DocumentAttributeStore(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    uint32_t Add(int rating, DocumentStatus status);
+
+    void Remove(uint32_t ordinal);
+
+    int GetRating(uint32_t ordinal) const {
+        return columns_[static_cast<size_t>(DocumentAttribute::RATING)][ordinal];
+    }
+
+    DocumentStatus GetStatus(uint32_t ordinal) const {
+        return static_cast<DocumentStatus>(columns_[static_cast<size_t>(DocumentAttribute::STATUS)][ordinal]);
+    }
+
+    void SetStatus(uint32_t ordinal, DocumentStatus status);
+
+    const std::pmr::vector<int32_t>& GetColumn(DocumentAttribute attribute) const;
+
+    /** Число выданных порядковых номеров, включая свободные */
+    size_t GetOrdinalCount() const;
+
+    size_t PayloadBytes() const;
+
+    size_t AllocatedBytes() const;
+
+private:
+    using Columns = std::array<std::pmr::vector<int32_t>, static_cast<size_t>(DocumentAttribute::COUNT)>;
+
+    Columns columns_;
+    std::pmr::vector<uint32_t> free_ordinals_;
+
+    /** Каждый столбец создается сразу на resource: присваивание pmr-вектора ресурс не меняет */
+    template <size_t... Index>
+    static Columns MakeColumns(std::pmr::memory_resource* resource, std::index_sequence<Index...>) {
+        return {((void)Index, std::pmr::vector<int32_t>(resource))...};
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
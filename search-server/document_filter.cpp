@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "document_filter.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Множества до этого размера проверяются сравнением с каждым значением, большие - двоичным поиском */
+static const size_t SET_COMPARE_LIMIT = 8;
+static const size_t BLOCK_SIZE = 64;
+//-------------------------------------------------------------------------------------------------------------
+FilterBitmap::FilterBitmap(size_t ordinal_count)
+    : words_((ordinal_count + BLOCK_SIZE - 1) / BLOCK_SIZE, ~uint64_t{0}) {
+    if (ordinal_count % BLOCK_SIZE != 0) {
+        words_.back() = (uint64_t{1} << (ordinal_count % BLOCK_SIZE)) - 1;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t FilterBitmap::Count() const {
+    size_t count = 0;
+    for (uint64_t word : words_) {
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<uint64_t>& FilterBitmap::GetWords() {
+    return words_;
+}
+//-------------------------------------------------------------------------------------------------------------
+DocumentFilter& DocumentFilter::Range(DocumentAttribute attribute, int32_t min, int32_t max) {
+    conditions_.push_back({attribute, min, max, {}, false});
+    return *this;
+}
+//-------------------------------------------------------------------------------------------------------------
+DocumentFilter& DocumentFilter::Equal(DocumentAttribute attribute, int32_t value) {
+    return Range(attribute, value, value);
+}
+//-------------------------------------------------------------------------------------------------------------
+DocumentFilter& DocumentFilter::In(DocumentAttribute attribute, vector<int32_t> values) {
+    sort(values.begin(), values.end());
+    values.erase(unique(values.begin(), values.end()), values.end());
+    conditions_.push_back({attribute, 0, 0, move(values), true});
+    return *this;
+}
+//-------------------------------------------------------------------------------------------------------------
+DocumentFilter& DocumentFilter::StatusIn(const vector<DocumentStatus>& statuses) {
+    vector<int32_t> values;
+    for (DocumentStatus status : statuses) {
+        values.push_back(static_cast<int32_t>(status));
+    }
+    return In(DocumentAttribute::STATUS, move(values));
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Биты count значений подряд, удовлетворяющих условию, без SIMD */
+template <typename Condition>
+static uint64_t ScalarMask(const int32_t* values, size_t count, const Condition& condition) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const bool is_match = condition.is_set
+                                  ? binary_search(condition.values.begin(), condition.values.end(), values[i])
+                                  : condition.min <= values[i] && values[i] <= condition.max;
+        mask |= uint64_t{is_match} << i;
+    }
+    return mask;
+}
+//-------------------------------------------------------------------------------------------------------------
+#ifdef __SSE2__
+/** Биты 64 значений подряд в диапазоне [min, max]: (x - min) <= (max - min) как беззнаковые,
+ *  беззнаковое сравнение SSE2 делается знаковым после сдвига обеих частей на 2^31 */
+static uint64_t RangeMask64(const int32_t* values, int32_t min, int32_t max) {
+    const __m128i sign = _mm_set1_epi32(numeric_limits<int32_t>::min());
+    const __m128i low = _mm_set1_epi32(min);
+    const __m128i span = _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(static_cast<uint32_t>(max) - static_cast<uint32_t>(min))), sign);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 4) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        const __m128i offset = _mm_xor_si128(_mm_sub_epi32(value, low), sign);
+        const int outside = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(offset, span)));
+        mask |= static_cast<uint64_t>(~outside & 0xF) << i;
+    }
+    return mask;
+}
+//-------------------------------------------------------------------------------------------------------------
+static uint64_t SetMask64(const int32_t* values, const vector<int32_t>& set) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 4) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m128i is_match = _mm_setzero_si128();
+        for (int32_t set_value : set) {
+            is_match = _mm_or_si128(is_match, _mm_cmpeq_epi32(value, _mm_set1_epi32(set_value)));
+        }
+        mask |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(is_match))) << i;
+    }
+    return mask;
+}
+#endif
+//-------------------------------------------------------------------------------------------------------------
+FilterBitmap DocumentFilter::Evaluate(const DocumentAttributeStore& attributes) const {
+    const size_t ordinal_count = attributes.GetOrdinalCount();
+    FilterBitmap bitmap(ordinal_count);
+    vector<uint64_t>& words = bitmap.GetWords();
+    for (const Condition& condition : conditions_) {
+        if (!condition.is_set && condition.min > condition.max) {
+            fill(words.begin(), words.end(), 0);
+            break;
+        }
+        const int32_t* column = attributes.GetColumn(condition.attribute).data();
+        for (size_t block = 0; block < words.size(); ++block) {
+            if (words[block] == 0) {
+                continue;
+            }
+            const int32_t* values = column + block * BLOCK_SIZE;
+            const size_t count = min(BLOCK_SIZE, ordinal_count - block * BLOCK_SIZE);
+#ifdef __SSE2__
+            if (count == BLOCK_SIZE && !condition.is_set) {
+                words[block] &= RangeMask64(values, condition.min, condition.max);
+                continue;
+            }
+            if (count == BLOCK_SIZE && condition.values.size() <= SET_COMPARE_LIMIT) {
+                words[block] &= SetMask64(values, condition.values);
+                continue;
+            }
+#endif
+            words[block] &= ScalarMask(values, count, condition);
+        }
+    }
+    return bitmap;
+}
+//-------------------------------------------------------------------------------------------------------------
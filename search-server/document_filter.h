@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "document_attributes.h"
+
+//-------------------------------------------------------------------------------------------------------------
+/** Множество порядковых номеров документов: по биту на номер */
+class FilterBitmap {
+public:
+    explicit FilterBitmap(size_t ordinal_count);
+
+    bool Contains(uint32_t ordinal) const {
+        return (words_[ordinal >> 6] >> (ordinal & 63)) & 1;
+    }
+
+    size_t Count() const;
+
+    std::vector<uint64_t>& GetWords();
+
+private:
+    std::vector<uint64_t> words_;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Фильтр по атрибутам документов: конъюнкция условий "значение в диапазоне" и "значение из множества".
+ *  Evaluate проходит столбцы DocumentAttributeStore блоками по 64 документа (SSE2, если доступен)
+ *  и строит битовую карту подходящих документов до ранжирования */
+class DocumentFilter {
+public:
+    /** min <= значение <= max */
+    DocumentFilter& Range(DocumentAttribute attribute, int32_t min, int32_t max);
+
+    DocumentFilter& Equal(DocumentAttribute attribute, int32_t value);
+
+    DocumentFilter& In(DocumentAttribute attribute, std::vector<int32_t> values);
+
+    DocumentFilter& StatusIn(const std::vector<DocumentStatus>& statuses);
+
+    FilterBitmap Evaluate(const DocumentAttributeStore& attributes) const;
+
+private:
+    struct Condition {
+        DocumentAttribute attribute;
+        int32_t min;
+        int32_t max;
+        /** Для условия-множества: отсортированные значения, иначе пусто */
+        std::vector<int32_t> values;
+        bool is_set;
+    };
+
+    std::vector<Condition> conditions_;
+};
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <limits>
+#include <string_view>
+
+#include "fingerprint.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+static const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ull;
+static const uint64_t SECOND_SEED = 0xC2B2AE3D27D4EB4Full;
+//-------------------------------------------------------------------------------------------------------------
+uint64_t Mix64(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t TermId(string_view word) {
+    return Mix64(hash<string_view>{}(word));
+}
+//-------------------------------------------------------------------------------------------------------------
+Fingerprint128 ComputeTermSetFingerprint(vector<uint64_t> term_ids) {
+    sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    return ComputeFingerprint(term_ids);
+}
+//-------------------------------------------------------------------------------------------------------------
+Fingerprint128 ComputeFingerprint(const vector<uint64_t>& term_ids) {
+    Fingerprint128 fingerprint{Mix64(term_ids.size()), Mix64(term_ids.size() ^ SECOND_SEED)};
+    for (uint64_t term_id : term_ids) {
+        fingerprint.high = Mix64(fingerprint.high + GOLDEN_GAMMA + term_id);
+        fingerprint.low = Mix64((fingerprint.low ^ term_id) + SECOND_SEED);
+    }
+    return fingerprint;
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<uint64_t> ComputeMinHash(const vector<uint64_t>& term_ids, size_t hash_count) {
+    vector<uint64_t> signature(hash_count, numeric_limits<uint64_t>::max());
+    for (uint64_t term_id : term_ids) {
+        const uint64_t term_hash = Mix64(term_id);
+        for (size_t i = 0; i < hash_count; ++i) {
+            // семейство хеш-функций: перемешивание хеша слова с номером функции
+            const uint64_t hash = Mix64(term_hash ^ (GOLDEN_GAMMA * (i + 1)));
+            if (hash < signature[i]) {
+                signature[i] = hash;
+            }
+        }
+    }
+    return signature;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------------------
+/** 128-битный отпечаток набора слов документа */
+struct Fingerprint128 {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool operator==(const Fingerprint128& other) const {
+        return high == other.high && low == other.low;
+    }
+
+    bool operator!=(const Fingerprint128& other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const Fingerprint128& other) const {
+        return high != other.high ? high < other.high : low < other.low;
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+struct Fingerprint128Hasher {
+    size_t operator()(const Fingerprint128& fingerprint) const {
+        return static_cast<size_t>(fingerprint.low);
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Перемешивание 64 бит (финализатор splitmix64) */
+uint64_t Mix64(uint64_t value);
+//-------------------------------------------------------------------------------------------------------------
+/** Идентификатор слова для отпечатков - 64-битный хеш его текста: не зависит от адресов в памяти,
+ *  поэтому отпечатки воспроизводимы между запусками */
+uint64_t TermId(std::string_view word);
+//-------------------------------------------------------------------------------------------------------------
+/** Отпечаток множества слов: идентификаторы упорядочиваются, повторы отбрасываются */
+Fingerprint128 ComputeTermSetFingerprint(std::vector<uint64_t> term_ids);
+//-------------------------------------------------------------------------------------------------------------
+/** Отпечаток последовательности идентификаторов слов: две независимые 64-битные свертки.
+ *  Одинаковые наборы слов, перечисленные в одном порядке, дают одинаковый отпечаток */
+Fingerprint128 ComputeFingerprint(const std::vector<uint64_t>& term_ids);
+//-------------------------------------------------------------------------------------------------------------
+/** MinHash сигнатура набора: для каждой из hash_count хеш-функций - минимум хеша по элементам.
+ *  Доля совпавших позиций сигнатур двух наборов оценивает их сходство Жаккара */
+std::vector<uint64_t> ComputeMinHash(const std::vector<uint64_t>& term_ids, size_t hash_count);
+//-------------------------------------------------------------------------------------------------------------
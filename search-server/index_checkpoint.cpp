@@ -0,0 +1,134 @@
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "index_checkpoint.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Сбрасывает на диск файл или каталог (для каталога - записи о переименованиях в нем).
+ *  Без POSIX полагаемся на flush потока */
+static void SyncPath(const string& path, bool is_directory) {
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = open(path.c_str(), is_directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("can't open "s + path);
+    }
+    const int result = fsync(fd);
+    close(fd);
+    if (result != 0) {
+        throw runtime_error("can't sync "s + path);
+    }
+#else
+    (void)path;
+    (void)is_directory;
+#endif
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Пишет файл через временный: сброс на диск, переименование, сброс каталога.
+ *  После возврата файл целиком на диске, при сбое на любом шаге остается прежний */
+template <typename Writer>
+static void WriteFileDurably(const string& path, Writer writer) {
+    const string temp_path = path + ".tmp"s;
+    {
+        ofstream out(temp_path, ios::binary | ios::trunc);
+        writer(out);
+        if (!out.flush()) {
+            throw runtime_error("can't write "s + temp_path);
+        }
+    }
+    SyncPath(temp_path, false);
+    filesystem::rename(temp_path, path);
+    const filesystem::path directory = filesystem::absolute(path).parent_path();
+    SyncPath(directory.string(), true);
+}
+//-------------------------------------------------------------------------------------------------------------
+IndexCheckpointer::IndexCheckpointer(SearchServer& search_server, const string& path_prefix, int deltas_per_snapshot)
+    : search_server_(search_server)
+    , path_prefix_(path_prefix)
+    , deltas_per_snapshot_(deltas_per_snapshot) {
+    if (deltas_per_snapshot_ < 1) {
+        throw invalid_argument("deltas_per_snapshot < 1"s);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexCheckpointer::Checkpoint() {
+    if (!has_snapshot_ || delta_count_ >= deltas_per_snapshot_) {
+        WriteFullSnapshot();
+        return;
+    }
+    if (!search_server_.HasChanges()) {
+        return;
+    }
+    WriteFileDurably(DeltaPath(delta_count_ + 1), [this](ostream& out) {
+        search_server_.SaveDelta(out, generation_);
+    });
+    ++delta_count_;
+    search_server_.ResetChangeTracking();
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexCheckpointer::WriteFullSnapshot() {
+    // поколение нового снимка больше поколения снимка на диске, поэтому дельты прежней цепочки,
+    // не удаленные из-за сбоя, при восстановлении отбрасываются
+    uint64_t generation = generation_;
+    if (!has_snapshot_) {
+        if (ifstream snapshot(SnapshotPath(), ios::binary); snapshot) {
+            generation = SearchServer::ReadSnapshotGeneration(snapshot);
+        } else {
+            // снимка нет - дельты на диске ни к чему не относятся
+            RemoveDeltas();
+        }
+    }
+    ++generation;
+    WriteFileDurably(SnapshotPath(), [this, generation](ostream& out) {
+        search_server_.SaveSnapshot(out, generation);
+    });
+    generation_ = generation;
+    has_snapshot_ = true;
+    RemoveDeltas();
+    search_server_.ResetChangeTracking();
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexCheckpointer::Restore() {
+    ifstream snapshot(SnapshotPath(), ios::binary);
+    if (!snapshot) {
+        throw runtime_error("no snapshot "s + SnapshotPath());
+    }
+    generation_ = search_server_.LoadSnapshot(snapshot);
+    has_snapshot_ = true;
+    delta_count_ = 0;
+    while (true) {
+        ifstream delta(DeltaPath(delta_count_ + 1), ios::binary);
+        // дельта чужого поколения осталась от прежнего снимка: цепочка на ней кончается
+        if (!delta || !search_server_.ApplyDelta(delta, generation_)) {
+            break;
+        }
+        ++delta_count_;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+int IndexCheckpointer::GetDeltaCount() const {
+    return delta_count_;
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexCheckpointer::RemoveDeltas() {
+    // удаляем все дельты на диске, а не только записанные этим объектом
+    for (int delta_number = 1; filesystem::exists(DeltaPath(delta_number)); ++delta_number) {
+        filesystem::remove(DeltaPath(delta_number));
+    }
+    delta_count_ = 0;
+}
+//-------------------------------------------------------------------------------------------------------------
+string IndexCheckpointer::SnapshotPath() const {
+    return path_prefix_ + ".snapshot"s;
+}
+//-------------------------------------------------------------------------------------------------------------
+string IndexCheckpointer::DeltaPath(int delta_number) const {
+    return path_prefix_ + ".delta."s + to_string(delta_number);
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "search_server.h"
+
+//-------------------------------------------------------------------------------------------------------------
+/** Инкрементальные контрольные точки индекса в файлах <path_prefix>.snapshot и <path_prefix>.delta.N
+ *  Checkpoint() пишет только изменения с прошлой точки, каждая deltas_per_snapshot-я точка
+ *  сворачивает цепочку в новый полный снимок, а старые дельты удаляет.
+ *  Снимок и дельты помечены поколением: каждый новый снимок увеличивает его, и Restore не применяет
+ *  дельты, оставшиеся от прежнего снимка после сбоя. Файлы пишутся через временные с fsync */
+class IndexCheckpointer {
+public:
+    IndexCheckpointer(SearchServer& search_server, const std::string& path_prefix, int deltas_per_snapshot = 16);
+
+    void Checkpoint();
+
+    void WriteFullSnapshot();
+
+    /** Загружает в пустой сервер снимок и всю цепочку дельт за ним */
+    void Restore();
+
+    int GetDeltaCount() const;
+
+private:
+    SearchServer& search_server_;
+    const std::string path_prefix_;
+    const int deltas_per_snapshot_;
+    int delta_count_ = 0;
+    bool has_snapshot_ = false;
+    uint64_t generation_ = 0;
+
+    void RemoveDeltas();
+
+    std::string SnapshotPath() const;
+
+    std::string DeltaPath(int delta_number) const;
+};
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+#include <stdexcept>
+#include <string>
+
+#include "index_memory_resource.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+void* IndexMemoryResource::CountingResource::do_allocate(size_t bytes, size_t alignment) {
+    void* const pointer = upstream->allocate(bytes, alignment);
+    reserved_bytes += bytes;
+    return pointer;
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexMemoryResource::CountingResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    upstream->deallocate(pointer, bytes, alignment);
+    reserved_bytes -= bytes;
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexMemoryResource::SetAllocation(IndexAllocation allocation, pmr::memory_resource* upstream) {
+    if (upstream == nullptr) {
+        throw invalid_argument("upstream memory resource is null"s);
+    }
+    if (stats_.live_bytes != 0) {
+        throw logic_error("index memory is in use"s);
+    }
+    // арена освобождает свои блоки у прежнего вышестоящего ресурса до его замены
+    arena_.reset();
+    upstream_.upstream = upstream;
+    allocation_ = allocation;
+    if (allocation_ == IndexAllocation::MONOTONIC) {
+        arena_ = make_unique<pmr::monotonic_buffer_resource>(ARENA_INITIAL_BYTES, &upstream_);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+IndexAllocation IndexMemoryResource::GetAllocation() const {
+    return allocation_;
+}
+//-------------------------------------------------------------------------------------------------------------
+pmr::memory_resource* IndexMemoryResource::GetUpstream() const {
+    return upstream_.upstream;
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexMemoryResource::Release() {
+    if (!arena_) {
+        if (stats_.live_bytes != 0) {
+            throw logic_error("index memory is in use"s);
+        }
+        return;
+    }
+    arena_ = make_unique<pmr::monotonic_buffer_resource>(ARENA_INITIAL_BYTES, &upstream_);
+    stats_.live_bytes = 0;
+}
+//-------------------------------------------------------------------------------------------------------------
+IndexAllocationStats IndexMemoryResource::Stats() const {
+    IndexAllocationStats stats = stats_;
+    stats.reserved_bytes = upstream_.reserved_bytes;
+    return stats;
+}
+//-------------------------------------------------------------------------------------------------------------
+void* IndexMemoryResource::do_allocate(size_t bytes, size_t alignment) {
+    void* const pointer = arena_ ? arena_->allocate(bytes, alignment) : upstream_.allocate(bytes, alignment);
+    ++stats_.allocation_count;
+    stats_.allocated_bytes += bytes;
+    stats_.live_bytes += bytes;
+    return pointer;
+}
+//-------------------------------------------------------------------------------------------------------------
+void IndexMemoryResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    // у арены deallocate ничего не делает, память вернется вместе с блоками
+    if (arena_) {
+        arena_->deallocate(pointer, bytes, alignment);
+    } else {
+        upstream_.deallocate(pointer, bytes, alignment);
+    }
+    ++stats_.deallocation_count;
+    stats_.live_bytes -= bytes;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+
+#include "memory_stats.h"
+
+//-------------------------------------------------------------------------------------------------------------
+/** Откуда контейнеры индекса берут память */
+enum class IndexAllocation {
+    HEAP,      // каждый узел отдельно у вышестоящего ресурса (по умолчанию new/delete)
+    MONOTONIC, // арена: узлы нарезаются из растущих блоков, удаление ничего не освобождает,
+               // блоки возвращаются вышестоящему ресурсу разом при уничтожении сервера или Clear
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Ресурс памяти всех контейнеров SearchServer: считает выделения и раздает память по выбранной политике.
+ *  Не потокобезопасен - память берут только методы, изменяющие индекс */
+class IndexMemoryResource final : public std::pmr::memory_resource {
+public:
+    IndexMemoryResource() = default;
+
+    IndexMemoryResource(const IndexMemoryResource&) = delete;
+    IndexMemoryResource& operator=(const IndexMemoryResource&) = delete;
+
+    /** Меняет политику и вышестоящий ресурс; если выделенная память еще не возвращена, бросает logic_error */
+    void SetAllocation(IndexAllocation allocation, std::pmr::memory_resource* upstream);
+
+    IndexAllocation GetAllocation() const;
+
+    std::pmr::memory_resource* GetUpstream() const;
+
+    /** Возвращает блоки арены вышестоящему ресурсу разом, следующая арена начинается с первого блока.
+     *  Память, выданная ареной, пропадает вместе с блоками: контейнеры на ней после этого не разрушают,
+     *  а создают заново. При политике HEAP вся выданная память должна быть уже возвращена, иначе logic_error */
+    void Release();
+
+    IndexAllocationStats Stats() const;
+
+private:
+    /** Передает запросы вышестоящему ресурсу и считает взятые у него байты */
+    class CountingResource final : public std::pmr::memory_resource {
+    public:
+        explicit CountingResource(std::pmr::memory_resource* upstream_resource)
+            : upstream(upstream_resource) {
+        }
+
+        std::pmr::memory_resource* upstream;
+        size_t reserved_bytes = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    /** Первый блок арены; следующие растут геометрически */
+    static constexpr size_t ARENA_INITIAL_BYTES = 64 * 1024;
+
+    IndexAllocation allocation_ = IndexAllocation::HEAP;
+    CountingResource upstream_{std::pmr::new_delete_resource()};
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+    IndexAllocationStats stats_;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "latency_histogram.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Единственный писатель: обычные load и store вместо fetch_add, без префикса lock */
+static void AddRelaxed(atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram(const LatencyHistogram& other) {
+    Merge(other);
+}
+//-------------------------------------------------------------------------------------------------------------
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other) {
+    if (this != &other) {
+        Reset();
+        Merge(other);
+    }
+    return *this;
+}
+//-------------------------------------------------------------------------------------------------------------
+void LatencyHistogram::Record(uint64_t value_ns) {
+    AddRelaxed(counts_[BucketIndex(value_ns)], 1);
+    AddRelaxed(count_, 1);
+    if (value_ns < min_.load(memory_order_relaxed)) {
+        min_.store(value_ns, memory_order_relaxed);
+    }
+    if (value_ns > max_.load(memory_order_relaxed)) {
+        max_.store(value_ns, memory_order_relaxed);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        if (const uint64_t count = other.counts_[i].load(memory_order_relaxed); count != 0) {
+            AddRelaxed(counts_[i], count);
+        }
+    }
+    AddRelaxed(count_, other.count_.load(memory_order_relaxed));
+    min_.store(min(min_.load(memory_order_relaxed), other.min_.load(memory_order_relaxed)), memory_order_relaxed);
+    max_.store(max(max_.load(memory_order_relaxed), other.max_.load(memory_order_relaxed)), memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------------------------------------
+void LatencyHistogram::Reset() {
+    for (atomic<uint64_t>& count : counts_) {
+        count.store(0, memory_order_relaxed);
+    }
+    count_.store(0, memory_order_relaxed);
+    min_.store(numeric_limits<uint64_t>::max(), memory_order_relaxed);
+    max_.store(0, memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t LatencyHistogram::Count() const {
+    return count_.load(memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+    // count_ читается отдельно от корзин, при одновременной записи ранг берется по сумме корзин
+    uint64_t total = 0;
+    for (const atomic<uint64_t>& count : counts_) {
+        total += count.load(memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const double fraction = clamp(percentile, 0.0, 100.0) / 100.0;
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * total)));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        cumulative += counts_[i].load(memory_order_relaxed);
+        if (cumulative >= rank) {
+            return min(BucketUpperValue(i), max_.load(memory_order_relaxed));
+        }
+    }
+    return max_.load(memory_order_relaxed);
+}
+//-------------------------------------------------------------------------------------------------------------
+LatencySnapshot LatencyHistogram::Snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.count = Count();
+    if (snapshot.count == 0) {
+        return snapshot;
+    }
+    snapshot.min_ns = min_.load(memory_order_relaxed);
+    snapshot.max_ns = max_.load(memory_order_relaxed);
+    snapshot.p50_ns = ValueAtPercentile(50.0);
+    snapshot.p99_ns = ValueAtPercentile(99.0);
+    snapshot.p999_ns = ValueAtPercentile(99.9);
+    return snapshot;
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+#if defined(__GNUC__)
+    const int exponent = 63 - __builtin_clzll(value);
+#else
+    int exponent = 0;
+    while ((value >> exponent) > 1) {
+        ++exponent;
+    }
+#endif
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    // старшие SUB_BUCKET_BITS + 1 бит значения: единица степени и номер корзины внутри степени
+    const uint64_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+    return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket);
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t LatencyHistogram::BucketUpperValue(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const int exponent = static_cast<int>(index / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    return (sub_bucket << shift) + (uint64_t{1} << shift) - 1;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Гистограммы фаз одного потока */
+struct ThreadQueryPhases {
+    array<LatencyHistogram, QUERY_PHASE_COUNT> phases;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Все когда-либо созданные гистограммы потоков; мьютекс берется только при регистрации потока и при чтении */
+struct QueryPhaseRegistry {
+    mutex threads_mutex;
+    vector<unique_ptr<ThreadQueryPhases>> threads;
+};
+//-------------------------------------------------------------------------------------------------------------
+static QueryPhaseRegistry& GetQueryPhaseRegistry() {
+    static QueryPhaseRegistry registry;
+    return registry;
+}
+//-------------------------------------------------------------------------------------------------------------
+static ThreadQueryPhases& RegisterThread() {
+    QueryPhaseRegistry& registry = GetQueryPhaseRegistry();
+    lock_guard guard(registry.threads_mutex);
+    registry.threads.push_back(make_unique<ThreadQueryPhases>());
+    return *registry.threads.back();
+}
+//-------------------------------------------------------------------------------------------------------------
+std::string_view QueryPhaseName(QueryPhase phase) {
+    switch (phase) {
+    case QueryPhase::PARSE:
+        return "parse"sv;
+    case QueryPhase::POSTINGS:
+        return "postings"sv;
+    case QueryPhase::MINUS_WORDS:
+        return "minus_words"sv;
+    case QueryPhase::TOP_K:
+        return "top_k"sv;
+    }
+    return "unknown"sv;
+}
+//-------------------------------------------------------------------------------------------------------------
+void RecordQueryPhase(QueryPhase phase, uint64_t duration_ns) {
+    thread_local ThreadQueryPhases& thread_phases = RegisterThread();
+    thread_phases.phases[static_cast<size_t>(phase)].Record(duration_ns);
+}
+//-------------------------------------------------------------------------------------------------------------
+LatencyHistogram QueryPhaseHistogram(QueryPhase phase) {
+    QueryPhaseRegistry& registry = GetQueryPhaseRegistry();
+    LatencyHistogram merged;
+    lock_guard guard(registry.threads_mutex);
+    for (const auto& thread_phases : registry.threads) {
+        merged.Merge(thread_phases->phases[static_cast<size_t>(phase)]);
+    }
+    return merged;
+}
+//-------------------------------------------------------------------------------------------------------------
+LatencySnapshot QueryPhaseSnapshot(QueryPhase phase) {
+    return QueryPhaseHistogram(phase).Snapshot();
+}
+//-------------------------------------------------------------------------------------------------------------
+void ResetQueryPhases() {
+    QueryPhaseRegistry& registry = GetQueryPhaseRegistry();
+    lock_guard guard(registry.threads_mutex);
+    for (const auto& thread_phases : registry.threads) {
+        for (LatencyHistogram& histogram : thread_phases->phases) {
+            histogram.Reset();
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <string_view>
+
+#include "log_duration.h"
+
+//-------------------------------------------------------------------------------------------------------------
+/** Процентили задержки в наносекундах */
+struct LatencySnapshot {
+    uint64_t count = 0;
+    uint64_t min_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Гистограмма задержек в стиле HDR: значения до 32 нс точно, дальше каждая степень двойки делится
+ *  на 32 корзины (относительная ошибка меньше 1/32), значения от 2^48 нс попадают в последнюю корзину.
+ *  Записывает один поток без блокировок и атомарных read-modify-write, читать и сливать (Merge)
+ *  можно из любого потока */
+class LatencyHistogram {
+public:
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram& other);
+
+    LatencyHistogram& operator=(const LatencyHistogram& other);
+
+    void Record(uint64_t value_ns);
+
+    /** Добавляет значения other; сливать в одну гистограмму должен один поток */
+    void Merge(const LatencyHistogram& other);
+
+    void Reset();
+
+    uint64_t Count() const;
+
+    /** Наименьшее значение, не меньше которого percentile процентов записей (верхняя граница корзины) */
+    uint64_t ValueAtPercentile(double percentile) const;
+
+    LatencySnapshot Snapshot() const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 47;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> min_{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> max_{0};
+
+    static size_t BucketIndex(uint64_t value);
+
+    static uint64_t BucketUpperValue(size_t index);
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Фазы обработки запроса FindTopDocuments */
+enum class QueryPhase {
+    PARSE,       // разбор запроса и поиск списков документов слов
+    POSTINGS,    // проход по спискам документов плюс-слов и подсчет релевантности
+    MINUS_WORDS, // исключение документов с минус-словами
+    TOP_K,       // отбор лучших документов
+};
+//-------------------------------------------------------------------------------------------------------------
+constexpr size_t QUERY_PHASE_COUNT = 4;
+//-------------------------------------------------------------------------------------------------------------
+std::string_view QueryPhaseName(QueryPhase phase);
+//-------------------------------------------------------------------------------------------------------------
+/** Записывает длительность фазы в гистограмму текущего потока. Гистограмма потока создается
+ *  при первой записи и живет до конца программы, поэтому значения завершившихся потоков не теряются */
+void RecordQueryPhase(QueryPhase phase, uint64_t duration_ns);
+//-------------------------------------------------------------------------------------------------------------
+/** Гистограммы фазы всех потоков, слитые в одну */
+LatencyHistogram QueryPhaseHistogram(QueryPhase phase);
+//-------------------------------------------------------------------------------------------------------------
+LatencySnapshot QueryPhaseSnapshot(QueryPhase phase);
+//-------------------------------------------------------------------------------------------------------------
+/** Обнуляет гистограммы всех потоков; записи, идущие одновременно со сбросом, могут потеряться */
+void ResetQueryPhases();
+//-------------------------------------------------------------------------------------------------------------
+/** Замер фазы от создания до разрушения объекта */
+class QueryPhaseTimer {
+public:
+    explicit QueryPhaseTimer(QueryPhase phase)
+        : phase_(phase) {
+    }
+
+    ~QueryPhaseTimer() {
+        const auto duration = std::chrono::steady_clock::now() - start_time_;
+        RecordQueryPhase(phase_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    }
+
+    QueryPhaseTimer(const QueryPhaseTimer&) = delete;
+    QueryPhaseTimer& operator=(const QueryPhaseTimer&) = delete;
+
+private:
+    const QueryPhase phase_;
+    const std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Замер фаз, чередующихся внутри одного цикла: отсчет идет для первой фазы списка, Switch переносит его
+ *  на другую фазу одним чтением часов. При разрушении каждая фаза списка записывается один раз - суммой
+ *  своих отрезков (нулем, если в нее не переключались) */
+class QueryPhaseClock {
+public:
+    explicit QueryPhaseClock(std::initializer_list<QueryPhase> phases)
+        : current_phase_(*phases.begin()) {
+        for (QueryPhase phase : phases) {
+            is_recorded_[static_cast<size_t>(phase)] = true;
+        }
+    }
+
+    void Switch(QueryPhase phase) {
+        const auto now = std::chrono::steady_clock::now();
+        durations_ns_[static_cast<size_t>(current_phase_)] +=
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_time_).count());
+        current_phase_ = phase;
+        start_time_ = now;
+    }
+
+    ~QueryPhaseClock() {
+        Switch(current_phase_);
+        for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase) {
+            if (is_recorded_[phase]) {
+                RecordQueryPhase(static_cast<QueryPhase>(phase), durations_ns_[phase]);
+            }
+        }
+    }
+
+    QueryPhaseClock(const QueryPhaseClock&) = delete;
+    QueryPhaseClock& operator=(const QueryPhaseClock&) = delete;
+
+private:
+    std::array<uint64_t, QUERY_PHASE_COUNT> durations_ns_{};
+    std::array<bool, QUERY_PHASE_COUNT> is_recorded_{};
+    QueryPhase current_phase_;
+    std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Замер фаз включается макросом SEARCH_SERVER_PHASE_TIMING (DEFINES в .pro), без него PROFILE_QUERY_PHASE
+ *  и PROFILE_QUERY_PHASES не оставляют в коде ничего */
+#ifdef SEARCH_SERVER_PHASE_TIMING
+#define PROFILE_QUERY_PHASE(phase) QueryPhaseTimer PROFILE_CONCAT(queryPhaseTimer, __LINE__)(phase)
+#define PROFILE_QUERY_PHASES(clock, ...) QueryPhaseClock clock({__VA_ARGS__})
+#define PROFILE_QUERY_PHASE_SWITCH(clock, phase) clock.Switch(phase)
+#else
+#define PROFILE_QUERY_PHASE(phase) static_cast<void>(0)
+#define PROFILE_QUERY_PHASES(clock, ...) static_cast<void>(0)
+#define PROFILE_QUERY_PHASE_SWITCH(clock, phase) static_cast<void>(0)
+#endif
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,121 @@
+#include <algorithm>
+
+#include "levenshtein_automaton.h"
+#include "string_processing.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+LevenshteinAutomaton::LevenshteinAutomaton(string_view word, int max_edits)
+    : word_(DecodeUtf8(word))
+    , alphabet_(word_)
+    , max_edits_(max_edits) {
+    sort(alphabet_.begin(), alphabet_.end());
+    alphabet_.erase(unique(alphabet_.begin(), alphabet_.end()), alphabet_.end());
+}
+//-------------------------------------------------------------------------------------------------------------
+LevenshteinAutomaton::State LevenshteinAutomaton::Start() const {
+    State state(word_.size() + 1);
+    for (size_t i = 0; i < state.size(); ++i) {
+        state[i] = min(static_cast<int>(i), max_edits_ + 1);
+    }
+    return state;
+}
+//-------------------------------------------------------------------------------------------------------------
+LevenshteinAutomaton::State LevenshteinAutomaton::Step(const State& state, char32_t code_point) const {
+    const int limit = max_edits_ + 1;
+    State next(state.size(), limit);
+    next[0] = min(state[0] + 1, limit);
+    for (size_t i = 1; i < state.size(); ++i) {
+        const int substitution = state[i - 1] + (word_[i - 1] == code_point ? 0 : 1);
+        next[i] = min({substitution, state[i] + 1, next[i - 1] + 1, limit});
+    }
+    return next;
+}
+//-------------------------------------------------------------------------------------------------------------
+static bool IsUtf8Continuation(char byte) {
+    return (static_cast<unsigned char>(byte) & 0xC0) == 0x80;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Наименьшая строка, большая всех строк с префиксом prefix; пустая, если такой нет */
+static string PrefixSuccessor(string prefix) {
+    while (!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xFF) {
+        prefix.pop_back();
+    }
+    if (!prefix.empty()) {
+        ++prefix.back();
+    }
+    return prefix;
+}
+//-------------------------------------------------------------------------------------------------------------
+LevenshteinAutomaton::State LevenshteinAutomaton::StepByte(const State& state, string_view prefix) const {
+    const size_t lead = LastCodePointStart(prefix);
+    if (!IsUtf8Continuation(prefix[lead])) {
+        const size_t end = lead + Utf8SequenceLength(prefix[lead]);
+        if (end > prefix.size()) {
+            return state;
+        }
+        if (end == prefix.size()) {
+            return Step(state, DecodeUtf8(prefix.substr(lead))[0]);
+        }
+    }
+    // неверная последовательность: байт считается отдельным символом
+    return Step(state, static_cast<unsigned char>(prefix.back()));
+}
+//-------------------------------------------------------------------------------------------------------------
+bool LevenshteinAutomaton::IsMatch(const State& state) const {
+    return state.back() <= max_edits_;
+}
+//-------------------------------------------------------------------------------------------------------------
+bool LevenshteinAutomaton::CanMatch(const State& state) const {
+    return *min_element(state.begin(), state.end()) <= max_edits_;
+}
+//-------------------------------------------------------------------------------------------------------------
+int LevenshteinAutomaton::Distance(const State& state) const {
+    return state.back();
+}
+//-------------------------------------------------------------------------------------------------------------
+string LevenshteinAutomaton::NextCandidate(string prefix, const vector<State>& states) const {
+    // кодовая точка, которой нет в слове: переход по ней одинаков для всех таких символов
+    constexpr char32_t OTHER_CODE_POINT = 0xFFFFFFFF;
+    while (!prefix.empty()) {
+        const size_t lead = LastCodePointStart(prefix);
+        const string_view last = string_view(prefix).substr(lead);
+        const u32string decoded = DecodeUtf8(last);
+        if (decoded.size() != 1 || EncodeUtf8(decoded[0]) != last || decoded[0] >= 0x10FFFF) {
+            return PrefixSuccessor(move(prefix));
+        }
+        const char32_t code_point = decoded[0];
+        const State& parent = states[lead];
+        char32_t next = OTHER_CODE_POINT;
+        if (CanMatch(Step(parent, OTHER_CODE_POINT))) {
+            next = code_point + 1;
+        } else {
+            for (auto it = upper_bound(alphabet_.begin(), alphabet_.end(), code_point); it != alphabet_.end(); ++it) {
+                if (CanMatch(Step(parent, *it))) {
+                    next = *it;
+                    break;
+                }
+            }
+        }
+        if (next != OTHER_CODE_POINT) {
+            // между последовательностями разной длины лежат неверные, их не пропускаем
+            string encoded = EncodeUtf8(next);
+            if (encoded.size() != last.size()) {
+                return PrefixSuccessor(move(prefix));
+            }
+            prefix.replace(lead, last.size(), encoded);
+            return prefix;
+        }
+        prefix.resize(lead);
+    }
+    return prefix;
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t LevenshteinAutomaton::LastCodePointStart(string_view prefix) {
+    size_t lead = prefix.size() - 1;
+    while (lead > 0 && prefix.size() - lead < 4 && IsUtf8Continuation(prefix[lead])) {
+        --lead;
+    }
+    return lead;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Автомат Левенштейна: принимает слова на расстоянии не больше max_edits от заданного.
+ *  Состояние - строка матрицы расстояний от уже прочитанного префикса до префиксов слова, значения
+ *  ограничены max_edits + 1, поэтому число различных состояний конечно. Сравнение идет по кодовым точкам,
+ *  а не по байтам */
+class LevenshteinAutomaton {
+public:
+    using State = std::vector<int>;
+
+    LevenshteinAutomaton(std::string_view word, int max_edits);
+
+    State Start() const;
+
+    State Step(const State& state, char32_t code_point) const;
+
+    /** Переход по последнему байту UTF-8 строки prefix (state - состояние для prefix без этого байта):
+     *  состояние меняется только когда байт завершает кодовую точку */
+    State StepByte(const State& state, std::string_view prefix) const;
+
+    /** Прочитанный префикс сам находится на расстоянии не больше max_edits */
+    bool IsMatch(const State& state) const;
+
+    /** Есть ли продолжение прочитанного префикса, которое будет принято */
+    bool CanMatch(const State& state) const;
+
+    int Distance(const State& state) const;
+
+    /** Наименьшая строка, большая всех строк с префиксом prefix, из которого автомат не может дойти
+     *  до принятия, и у которой автомат еще может дойти до принятия; пустая, если такой нет.
+     *  states[i] - состояние после первых i байт prefix. Символы, которых нет в слове, перебираются
+     *  одним шагом, поэтому по словарю делается один поиск вместо поиска на каждого соседа префикса.
+     *  Точно для корректного UTF-8, для неверных последовательностей - переход к следующему байту */
+    std::string NextCandidate(std::string prefix, const std::vector<State>& states) const;
+
+private:
+    std::u32string word_;
+    /** Различные кодовые точки слова по возрастанию */
+    std::u32string alphabet_;
+    int max_edits_;
+
+    /** Начало последней кодовой точки prefix */
+    static size_t LastCodePointStart(std::string_view prefix);
+};
+//-------------------------------------------------------------------------------------------------------------
@@ -3,6 +3,8 @@
 #include <chrono>
 #include <iostream>
 
+#include "perf_counters.h"
+
 #define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
 #define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
 #define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profileGuard, __LINE__)
@@ -13,20 +15,34 @@
 #define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profileGuard, __LINE__)
 #define LOG_DURATION_STREAM(x, stream) LogDuration UNIQUE_VAR_NAME_PROFILE((x), (stream))
 
+// то же со счетчиками процессора (perf_counters.h): такты, инструкции, IPC, промахи LLC и предсказания переходов
+#define LOG_DURATION_PERF(x) LogDuration UNIQUE_VAR_NAME_PROFILE((x), std::cerr, LogDuration::Mode::WITH_PERF_COUNTERS)
+#define LOG_DURATION_PERF_STREAM(x, stream) LogDuration UNIQUE_VAR_NAME_PROFILE((x), (stream), LogDuration::Mode::WITH_PERF_COUNTERS)
+
 class LogDuration {
 public:
     // заменим имя типа std::chrono::steady_clock
     // с помощью using для удобства
     using Clock = std::chrono::steady_clock;
 
-    LogDuration(const std::string& id, std::ostream& stream = std::cerr)
+    /** Что кроме времени замеряет область */
+    enum class Mode {
+        WALL_TIME,
+        WITH_PERF_COUNTERS, // счетчики потока, создавшего область; без доступа к ним печатается "perf counters unavailable"
+    };
+
+    LogDuration(const std::string& id, std::ostream& stream = std::cerr, Mode mode = Mode::WALL_TIME)
         : id_(id)
-        , stream_(stream){
+        , stream_(stream)
+        , mode_(mode) {
+        StartCounters();
     }
 
-    LogDuration(const std::string_view id, std::ostream& stream = std::cerr)
+    LogDuration(const std::string_view id, std::ostream& stream = std::cerr, Mode mode = Mode::WALL_TIME)
         : id_(id)
-        , stream_(stream){
+        , stream_(stream)
+        , mode_(mode) {
+        StartCounters();
     }
 
     ~LogDuration() {
@@ -35,11 +51,37 @@ public:
 
         const auto end_time = Clock::now();
         const auto dur = end_time - start_time_;
-        stream_ << id_ << ": "s << duration_cast<milliseconds>(dur).count() << " ms"s << std::endl;
+        if (mode_ == Mode::WALL_TIME) {
+            stream_ << id_ << ": "s << duration_cast<milliseconds>(dur).count() << " ms"s << std::endl;
+            return;
+        }
+        const PerfCounterSample counters = ThreadPerfCounters().Read() - start_counters_;
+        stream_ << id_ << ": "s << duration_cast<milliseconds>(dur).count() << " ms"s;
+        if (!counters.HasAny()) {
+            stream_ << ", perf counters unavailable"s << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            if (counters.available[i]) {
+                stream_ << ", "s << PerfCounterName(static_cast<PerfCounter>(i)) << '=' << counters.values[i];
+            }
+        }
+        if (counters.Has(PerfCounter::CYCLES) && counters.Has(PerfCounter::INSTRUCTIONS)) {
+            stream_ << ", ipc="s << counters.InstructionsPerCycle();
+        }
+        stream_ << std::endl;
     }
 
 private:
     const std::string id_;
     const Clock::time_point start_time_ = Clock::now();
     std::ostream& stream_;
+    const Mode mode_;
+    PerfCounterSample start_counters_;
+
+    void StartCounters() {
+        if (mode_ == Mode::WITH_PERF_COUNTERS) {
+            start_counters_ = ThreadPerfCounters().Read();
+        }
+    }
 };
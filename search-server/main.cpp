@@ -10,6 +10,7 @@
 #include "test_example_functions.h"
 #include "log_duration.h"
 #include "process_queries.h"
+#include "corpus_generator.h"
 
 using namespace std;
 void AddDocument(SearchServer& search_server, int document_id, const string& document, DocumentStatus status,
@@ -37,58 +38,15 @@ void MatchDocuments(const SearchServer& search_server, const string& query) {
     try {
         LOG_DURATION_STREAM("Operation time"s, cout);
         cout << "MatchDocuments query: "s << query << endl;
-        for (int document_id : search_server) {
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
-            PrintMatchDocumentResult(document_id, words, status);
+        const SearchServer::PreparedQuery prepared_query = search_server.PrepareQuery(query);
+        for (const DocumentMatch& match : search_server.MatchAllDocuments(prepared_query)) {
+            PrintMatchDocumentResult(match.id, match.words, match.status);
         }
     } catch (const exception& e) {
         cout << "MatchDocuments FAIL: "s << query << ": "s << e.what() << endl;
     }
 }
 //-------------------------------------------------------------------------------------------------------------
-string GenerateWord(mt19937& generator, int max_length) {
-    const int length = uniform_int_distribution(1, max_length)(generator);
-    string word;
-    word.reserve(length);
-    for (int i = 0; i < length; ++i) {
-        word.push_back(uniform_int_distribution('a', 'z')(generator));
-    }
-    return word;
-}
-
-vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
-    vector<string> words;
-    words.reserve(word_count);
-    for (int i = 0; i < word_count; ++i) {
-        words.push_back(GenerateWord(generator, max_length));
-    }
-    words.erase(unique(words.begin(), words.end()), words.end());
-    return words;
-}
-
-string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int word_count, double minus_prob = 0) {
-    string query;
-    for (int i = 0; i < word_count; ++i) {
-        if (!query.empty()) {
-            query.push_back(' ');
-        }
-        if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
-            query.push_back('-');
-        }
-        query += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
-    }
-    return query;
-}
-
-vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
-    vector<string> queries;
-    queries.reserve(query_count);
-    for (int i = 0; i < query_count; ++i) {
-        queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
-    }
-    return queries;
-}
-
 template <typename ExecutionPolicy>
 void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
     LOG_DURATION(mark);
@@ -0,0 +1,58 @@
+#include "memory_stats.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+size_t StructureMemory::OverheadBytes() const {
+    return allocated_bytes - payload_bytes;
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t IndexMemoryStats::TotalPayloadBytes() const {
+    return words.payload_bytes + word_to_document_freqs.payload_bytes + documents_words_freqs.payload_bytes
+           + documents.payload_bytes + document_ids.payload_bytes + positions.payload_bytes;
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t IndexMemoryStats::TotalAllocatedBytes() const {
+    return words.allocated_bytes + word_to_document_freqs.allocated_bytes + documents_words_freqs.allocated_bytes
+           + documents.allocated_bytes + document_ids.allocated_bytes + positions.allocated_bytes;
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t PostingLengthBucket(size_t length) {
+    size_t bucket = 0;
+    while (length > 0 && bucket + 1 < POSTING_LENGTH_BUCKET_COUNT) {
+        length >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+//-------------------------------------------------------------------------------------------------------------
+static void PrintStructure(ostream& out, const string& name, const StructureMemory& memory) {
+    out << name << ": "s << memory.element_count << " elements, "s
+        << memory.payload_bytes << " bytes payload, "s
+        << memory.allocated_bytes << " bytes allocated ("s
+        << memory.OverheadBytes() << " overhead)\n"s;
+}
+//-------------------------------------------------------------------------------------------------------------
+ostream& operator<<(ostream& out, const IndexMemoryStats& stats) {
+    PrintStructure(out, "words_"s, stats.words);
+    PrintStructure(out, "word_to_document_freqs_"s, stats.word_to_document_freqs);
+    PrintStructure(out, "documents_words_freqs_"s, stats.documents_words_freqs);
+    PrintStructure(out, "documents_"s, stats.documents);
+    PrintStructure(out, "document_ids_"s, stats.document_ids);
+    PrintStructure(out, "documents_words_positions_"s, stats.positions);
+    out << "terms: "s << stats.term_count << ", postings: "s << stats.posting_count
+        << ", dead terms: "s << stats.dead_term_count << " ("s << stats.dead_bytes << " bytes)"s
+        << ", posting slack: "s << stats.posting_slack_bytes << " bytes\n"s;
+    out << "posting lengths:"s;
+    for (size_t bucket = 0; bucket < stats.posting_length_histogram.size(); ++bucket) {
+        if (stats.posting_length_histogram[bucket] == 0) {
+            continue;
+        }
+        const size_t lower = bucket == 0 ? 0 : size_t{1} << (bucket - 1);
+        out << " ["s << lower << "+]="s << stats.posting_length_histogram[bucket];
+    }
+    out << "\nindex allocations: "s << stats.allocation.allocation_count << " ("s << stats.allocation.deallocation_count
+        << " freed), live: "s << stats.allocation.live_bytes << " bytes, reserved: "s << stats.allocation.reserved_bytes << " bytes"s;
+    out << "\ntotal: "s << stats.TotalAllocatedBytes() << " bytes allocated"s;
+    return out;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Число корзин гистограммы длин списков документов: корзина 0 - пустые списки,
+ *  корзина i - длины в диапазоне [2^(i-1), 2^i), последняя корзина - все что длиннее */
+constexpr size_t POSTING_LENGTH_BUCKET_COUNT = 24;
+//-------------------------------------------------------------------------------------------------------------
+/** Оценка памяти одной внутренней структуры */
+struct StructureMemory {
+    size_t element_count = 0;   // число узлов (элементов) структуры
+    size_t payload_bytes = 0;   // байты самих узлов и строк в куче
+    size_t allocated_bytes = 0; // байты с учетом служебных данных и выравнивания аллокатора
+
+    size_t OverheadBytes() const;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Счетчики ресурса памяти контейнеров индекса (IndexMemoryResource): узлы, массивы списков документов,
+ *  столбцы атрибутов и сжатые позиции */
+struct IndexAllocationStats {
+    size_t allocation_count = 0;
+    size_t deallocation_count = 0;
+    size_t allocated_bytes = 0; // всего выделено контейнерам
+    size_t live_bytes = 0;      // выделено и еще не возвращено
+    size_t reserved_bytes = 0;  // занято у вышестоящего ресурса: для арены - ее блоки целиком
+};
+//-------------------------------------------------------------------------------------------------------------
+struct IndexMemoryStats {
+    StructureMemory words;
+    StructureMemory word_to_document_freqs;
+    StructureMemory documents_words_freqs;
+    StructureMemory documents;
+    StructureMemory document_ids;
+    StructureMemory positions;
+
+    size_t term_count = 0;
+    size_t posting_count = 0;
+    std::array<size_t, POSTING_LENGTH_BUCKET_COUNT> posting_length_histogram{};
+
+    /** Слова, у которых после удаления документов не осталось ни одного документа */
+    size_t dead_term_count = 0;
+    size_t dead_bytes = 0;
+    /** Незанятая емкость массивов списков документов: запас роста и место удаленных документов */
+    size_t posting_slack_bytes = 0;
+
+    IndexAllocationStats allocation;
+
+    size_t TotalPayloadBytes() const;
+    size_t TotalAllocatedBytes() const;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Номер корзины гистограммы для списка документов длины length */
+size_t PostingLengthBucket(size_t length);
+//-------------------------------------------------------------------------------------------------------------
+/** Сколько байт реально займет блок malloc (glibc x86-64) под запрос size байт */
+constexpr size_t MallocChunkBytes(size_t size) {
+    return std::max<size_t>(32, (size + sizeof(size_t) + 15) / 16 * 16);
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Размер узла красно-черного дерева (std::set/std::map): цвет + три указателя + значение */
+template <typename Value>
+constexpr size_t TreeNodeBytes() {
+    return 4 * sizeof(void*) + sizeof(Value);
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Байты в куче под строку длины length, если она не поместилась в SSO буфер */
+inline size_t StringHeapBytes(size_t length) {
+    static const size_t sso_capacity = std::string{}.capacity();
+    return length > sso_capacity ? length + 1 : 0;
+}
+//-------------------------------------------------------------------------------------------------------------
+std::ostream& operator<<(std::ostream& out, const IndexMemoryStats& stats);
+//-------------------------------------------------------------------------------------------------------------
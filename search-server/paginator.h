@@ -53,6 +53,8 @@ private:
 //-------------------------------------------------------------------------------------------------------------
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
+    using std::begin;
+    using std::end;
     return Paginator(begin(c), end(c), page_size);
 }
 //-------------------------------------------------------------------------------------------------------------
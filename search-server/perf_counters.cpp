@@ -0,0 +1,132 @@
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf_counters.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+string_view PerfCounterName(PerfCounter counter) {
+    switch (counter) {
+    case PerfCounter::CYCLES:
+        return "cycles"sv;
+    case PerfCounter::INSTRUCTIONS:
+        return "instructions"sv;
+    case PerfCounter::LLC_MISSES:
+        return "llc_misses"sv;
+    case PerfCounter::BRANCH_MISSES:
+        return "branch_misses"sv;
+    }
+    return "unknown"sv;
+}
+//-------------------------------------------------------------------------------------------------------------
+bool PerfCounterSample::HasAny() const {
+    for (const bool is_available : available) {
+        if (is_available) {
+            return true;
+        }
+    }
+    return false;
+}
+//-------------------------------------------------------------------------------------------------------------
+double PerfCounterSample::InstructionsPerCycle() const {
+    if (!Has(PerfCounter::CYCLES) || !Has(PerfCounter::INSTRUCTIONS) || Get(PerfCounter::CYCLES) == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(Get(PerfCounter::INSTRUCTIONS)) / Get(PerfCounter::CYCLES);
+}
+//-------------------------------------------------------------------------------------------------------------
+double PerfCounterSample::PerOperation(PerfCounter counter, uint64_t operation_count) const {
+    if (!Has(counter) || operation_count == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(Get(counter)) / operation_count;
+}
+//-------------------------------------------------------------------------------------------------------------
+PerfCounterSample PerfCounterSample::operator-(const PerfCounterSample& start) const {
+    PerfCounterSample difference;
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        difference.available[i] = available[i] && start.available[i];
+        // масштабированные значения могут немного убывать, разность ограничена нулем
+        difference.values[i] = difference.available[i] && values[i] > start.values[i] ? values[i] - start.values[i] : 0;
+    }
+    return difference;
+}
+//-------------------------------------------------------------------------------------------------------------
+#if defined(__linux__)
+static int OpenCounter(PerfCounter counter) {
+    perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    switch (counter) {
+    case PerfCounter::CYCLES:
+        attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfCounter::INSTRUCTIONS:
+        attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfCounter::LLC_MISSES:
+        attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PerfCounter::BRANCH_MISSES:
+        attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // текущий поток на любом процессоре; ошибка (EACCES, ENOENT, ENOSYS) означает, что счетчика нет
+    return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+#endif
+//-------------------------------------------------------------------------------------------------------------
+PerfCounterGroup::PerfCounterGroup() {
+    descriptors_.fill(-1);
+#if defined(__linux__)
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        descriptors_[i] = OpenCounter(static_cast<PerfCounter>(i));
+    }
+#endif
+}
+//-------------------------------------------------------------------------------------------------------------
+PerfCounterGroup::~PerfCounterGroup() {
+#if defined(__linux__)
+    for (const int descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+#endif
+}
+//-------------------------------------------------------------------------------------------------------------
+PerfCounterSample PerfCounterGroup::Read() const {
+    PerfCounterSample sample;
+#if defined(__linux__)
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (descriptors_[i] < 0) {
+            continue;
+        }
+        // значение, время включения и время реального счета
+        uint64_t data[3] = {};
+        if (read(descriptors_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            continue;
+        }
+        sample.available[i] = true;
+        if (data[2] != 0) {
+            sample.values[i] = data[2] < data[1] ? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]) : data[0];
+        }
+    }
+#endif
+    return sample;
+}
+//-------------------------------------------------------------------------------------------------------------
+const PerfCounterGroup& ThreadPerfCounters() {
+    thread_local const PerfCounterGroup counters;
+    return counters;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Аппаратные счетчики процессора, которые читает PerfCounterGroup */
+enum class PerfCounter {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,    // промахи последнего уровня кеша
+    BRANCH_MISSES, // неверно предсказанные переходы
+};
+//-------------------------------------------------------------------------------------------------------------
+constexpr size_t PERF_COUNTER_COUNT = 4;
+//-------------------------------------------------------------------------------------------------------------
+std::string_view PerfCounterName(PerfCounter counter);
+//-------------------------------------------------------------------------------------------------------------
+/** Значения счетчиков. Счетчик, который не удалось открыть (нет прав, виртуальная машина без PMU,
+ *  не Linux), отсутствует: Has возвращает false, а производные величины - 0 */
+struct PerfCounterSample {
+    std::array<uint64_t, PERF_COUNTER_COUNT> values{};
+    std::array<bool, PERF_COUNTER_COUNT> available{};
+
+    bool Has(PerfCounter counter) const {
+        return available[static_cast<size_t>(counter)];
+    }
+
+    uint64_t Get(PerfCounter counter) const {
+        return values[static_cast<size_t>(counter)];
+    }
+
+    bool HasAny() const;
+
+    /** Инструкций за такт, 0 без обоих счетчиков */
+    double InstructionsPerCycle() const;
+
+    /** Значение счетчика на одну операцию из operation_count, 0 без счетчика */
+    double PerOperation(PerfCounter counter, uint64_t operation_count) const;
+
+    /** Разность замеров: счетчик есть, только если он есть в обоих */
+    PerfCounterSample operator-(const PerfCounterSample& start) const;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Счетчики perf_event_open для вызывающего потока (только пользовательский режим). Каждый счетчик
+ *  открывается отдельно, поэтому недоступный счетчик не мешает остальным. Счетчики работают с открытия,
+ *  замер области - разность двух Read. Если ядро мультиплексирует счетчики, значения масштабируются
+ *  на долю времени, когда счетчик реально считал */
+class PerfCounterGroup {
+public:
+    PerfCounterGroup();
+
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    PerfCounterSample Read() const;
+
+private:
+    std::array<int, PERF_COUNTER_COUNT> descriptors_;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Счетчики текущего потока, открываются при первом обращении и живут до завершения потока:
+ *  области профилирования не платят за открытие дескрипторов */
+const PerfCounterGroup& ThreadPerfCounters();
+//-------------------------------------------------------------------------------------------------------------
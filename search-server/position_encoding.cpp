@@ -0,0 +1,56 @@
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "position_encoding.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+vector<uint8_t> EncodePositions(const vector<uint32_t>& positions) {
+    vector<uint8_t> encoded;
+    encoded.reserve(positions.size());
+    uint32_t previous = 0;
+    for (uint32_t position : positions) {
+        uint32_t delta = position - previous;
+        previous = position;
+        while (delta >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(delta));
+    }
+    encoded.shrink_to_fit();
+    return encoded;
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<uint32_t> DecodePositions(const uint8_t* encoded, size_t size) {
+    vector<uint32_t> positions;
+    positions.reserve(size);
+    uint32_t position = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const uint8_t byte = encoded[i];
+        // в пятом байте varint от uint32_t значимы только 4 младших бита
+        if (shift == 28 && (byte & 0xF0) != 0) {
+            throw invalid_argument("encoded position exceeds 32 bits"s);
+        }
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        if (delta > numeric_limits<uint32_t>::max() - position) {
+            throw invalid_argument("encoded position exceeds 32 bits"s);
+        }
+        position += delta;
+        positions.push_back(position);
+        delta = 0;
+        shift = 0;
+    }
+    if (shift != 0) {
+        throw invalid_argument("encoded positions are truncated"s);
+    }
+    return positions;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Позиции слова в документе (по возрастанию) сжимаются разностями соседних позиций в varint:
+ *  по 7 бит на байт, старший бит - признак продолжения. Обычно одна позиция занимает один байт */
+std::vector<uint8_t> EncodePositions(const std::vector<uint32_t>& positions);
+//-------------------------------------------------------------------------------------------------------------
+/** На испорченных данных (varint длиннее 32 бит, оборванный последний varint, переполнение позиции)
+ *  бросает invalid_argument */
+std::vector<uint32_t> DecodePositions(const uint8_t* encoded, size_t size);
+
+inline std::vector<uint32_t> DecodePositions(const std::vector<uint8_t>& encoded) {
+    return DecodePositions(encoded.data(), encoded.size());
+}
+//-------------------------------------------------------------------------------------------------------------
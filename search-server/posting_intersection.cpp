@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "posting_intersection.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+size_t IntersectSorted(const int* short_ids, size_t short_count, const int* long_ids, size_t long_count,
+                       IntersectionOutput output) {
+    if (long_count / GALLOPING_SIZE_RATIO >= short_count) {
+        return IntersectGalloping(short_ids, short_count, long_ids, long_count, output);
+    }
+    return IntersectMerge(short_ids, short_count, long_ids, long_count, output);
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t IntersectGalloping(const int* short_ids, size_t short_count, const int* long_ids, size_t long_count,
+                          IntersectionOutput output) {
+    size_t match_count = 0;
+    size_t low = 0;
+    for (size_t i = 0; i < short_count && low < long_count; ++i) {
+        const int id = short_ids[i];
+        // удваиваем шаг, пока не перешагнем id, затем ищем двоичным поиском внутри последнего шага
+        size_t step = 1;
+        size_t high = low;
+        while (high < long_count && long_ids[high] < id) {
+            low = high + 1;
+            high += step;
+            step *= 2;
+        }
+        high = min(high + 1, long_count);
+        low = lower_bound(long_ids + low, long_ids + high, id) - long_ids;
+        if (low < long_count && long_ids[low] == id) {
+            output.short_indexes[match_count] = static_cast<uint32_t>(i);
+            output.long_indexes[match_count] = static_cast<uint32_t>(low);
+            ++match_count;
+            ++low;
+        }
+    }
+    return match_count;
+}
+//-------------------------------------------------------------------------------------------------------------
+static size_t MergeTail(const int* short_ids, size_t i, size_t short_count, const int* long_ids, size_t j, size_t long_count,
+                        IntersectionOutput output, size_t match_count) {
+    while (i < short_count && j < long_count) {
+        if (short_ids[i] < long_ids[j]) {
+            ++i;
+        } else if (long_ids[j] < short_ids[i]) {
+            ++j;
+        } else {
+            output.short_indexes[match_count] = static_cast<uint32_t>(i);
+            output.long_indexes[match_count] = static_cast<uint32_t>(j);
+            ++match_count;
+            ++i;
+            ++j;
+        }
+    }
+    return match_count;
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t IntersectMerge(const int* short_ids, size_t short_count, const int* long_ids, size_t long_count,
+                      IntersectionOutput output) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t match_count = 0;
+#ifdef __SSE2__
+    while (i + 4 <= short_count && j + 4 <= long_count) {
+        const __m128i short_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(short_ids + i));
+        __m128i long_block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(long_ids + j));
+        // rotation_masks[r]: бит k - элемент k короткого блока равен элементу (k + r) % 4 длинного
+        int rotation_masks[4];
+        int any_match = 0;
+        for (int rotation = 0; rotation < 4; ++rotation) {
+            rotation_masks[rotation] = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(short_block, long_block)));
+            any_match |= rotation_masks[rotation];
+            long_block = _mm_shuffle_epi32(long_block, _MM_SHUFFLE(0, 3, 2, 1));
+        }
+        for (int lane = 0; any_match != 0 && lane < 4; ++lane) {
+            for (int rotation = 0; rotation < 4; ++rotation) {
+                if (rotation_masks[rotation] & (1 << lane)) {
+                    output.short_indexes[match_count] = static_cast<uint32_t>(i + lane);
+                    output.long_indexes[match_count] = static_cast<uint32_t>(j + (lane + rotation) % 4);
+                    ++match_count;
+                    break;
+                }
+            }
+        }
+        const int short_last = short_ids[i + 3];
+        const int long_last = long_ids[j + 3];
+        if (short_last <= long_last) {
+            i += 4;
+        }
+        if (long_last <= short_last) {
+            j += 4;
+        }
+    }
+#endif
+    return MergeTail(short_ids, i, short_count, long_ids, j, long_count, output, match_count);
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** Во сколько раз длинный список должен быть длиннее короткого, чтобы вместо слияния
+ *  идти по нему галопом: для каждого элемента короткого списка - экспоненциальный, затем двоичный поиск */
+constexpr size_t GALLOPING_SIZE_RATIO = 32;
+
+/** Результат пересечения: для каждого общего элемента - его индекс в коротком и в длинном массиве */
+struct IntersectionOutput {
+    uint32_t* short_indexes;
+    uint32_t* long_indexes;
+};
+
+/** Пересечение упорядоченных по возрастанию массивов без повторов. Выход должен вмещать short_count элементов,
+ *  возвращается число общих элементов. Выбирает галоп или слияние по отношению длин */
+size_t IntersectSorted(const int* short_ids, size_t short_count, const int* long_ids, size_t long_count,
+                       IntersectionOutput output);
+
+/** Галоп по длинному массиву, O(short_count * log(long_count / short_count)) */
+size_t IntersectGalloping(const int* short_ids, size_t short_count, const int* long_ids, size_t long_count,
+                          IntersectionOutput output);
+
+/** Слияние: блоки по 4 элемента обоих массивов сравниваются каждый с каждым (SSE2),
+ *  без SSE2 и на хвостах - обычное слияние */
+size_t IntersectMerge(const int* short_ids, size_t short_count, const int* long_ids, size_t long_count,
+                      IntersectionOutput output);
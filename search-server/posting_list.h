@@ -0,0 +1,638 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <thread>
+
+#include "memory_stats.h"
+#include "document.h"
+
+/** Число записей в блоке списка документов */
+constexpr size_t POSTING_BLOCK_SIZE = 64;
+
+/** Маска статусов документов: бит 1 << status */
+using StatusMask = uint8_t;
+
+constexpr StatusMask ALL_STATUSES_MASK = 0xFF;
+
+inline StatusMask StatusBit(DocumentStatus status) {
+    return static_cast<StatusMask>(1u << static_cast<int>(status));
+}
+
+/** Статус удаленной записи списка: его бит не входит ни в одну маску статусов документов */
+constexpr uint8_t ERASED_POSTING_STATUS = 7;
+
+/** Максимум значений и число значений, равных ему: удаление значения ниже максимума
+ *  или одного из нескольких равных ему максимум не меняет и пересчета не требует */
+template <typename T>
+class CountedMaximum {
+public:
+    T Get() const {
+        return value_;
+    }
+
+    void Add(T value) {
+        if (count_ == 0 || value > value_) {
+            value_ = value;
+            count_ = 1;
+        } else if (value == value_) {
+            ++count_;
+        }
+    }
+
+    /** Возвращает true, если удалено последнее значение, равное максимуму, и максимум надо пересчитать */
+    bool Remove(T value) {
+        if (count_ == 0 || value != value_) {
+            return false;
+        }
+        --count_;
+        return count_ == 0;
+    }
+
+    void Reset() {
+        value_ = T{};
+        count_ = 0;
+    }
+
+private:
+    T value_{};
+    size_t count_ = 0;
+};
+
+/** Список документов одного слова, упорядоченный по id документа.
+ *  Id, порядковые номера документов в DocumentAttributeStore, частоты, сжатые длины документов
+ *  (EncodeDocumentLength) и статусы лежат в отдельных массивах
+ *  и разбиты на блоки по POSTING_BLOCK_SIZE записей.
+ *  Для каждого блока хранится последний id, максимальная частота и длина: по ним FindTopDocuments
+ *  отсекает целые блоки, которые не могут дать документ в топ, а Seek перескакивает блоки, не заглядывая в них.
+ *  Маска статусов блока позволяет SkipToStatus пропускать блоки без документов нужного статуса.
+ *
+ *  Изменения не сдвигают массивы на каждую запись. Удаленная запись остается на месте с ERASED_POSTING_STATUS,
+ *  итераторы ее пропускают, а массивы уплотняются, когда удаленных становится больше четверти.
+ *  Документ с id меньше последнего попадает в отсортированный буфер и вливается в массивы пачкой:
+ *  когда буфер дорастает до корня из длины списка или при первом чтении списка.
+ *  Чтение (begin, end, find, DocumentIds, GetBlocks) вливает буфер само; одновременные чтения безопасны,
+ *  одновременные чтение и изменение - нет.
+ *  Массивы берут память у ресурса аллокатора: в pmr-контейнере индекса - у ресурса сервера */
+class PostingList {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    struct Block {
+        int last_document_id;
+        uint8_t max_length_norm;
+        StatusMask status_mask;
+        double max_term_freq;
+    };
+
+    class const_iterator {
+    public:
+        const_iterator(const PostingList* postings, size_t index)
+            : postings_(postings)
+            , index_(index) {
+        }
+
+        std::pair<int, double> operator*() const {
+            return {DocumentId(), TermFreq()};
+        }
+
+        int DocumentId() const {
+            return postings_->document_ids_[index_];
+        }
+
+        uint32_t Ordinal() const {
+            return postings_->ordinals_[index_];
+        }
+
+        double TermFreq() const {
+            return postings_->term_freqs_[index_];
+        }
+
+        uint8_t LengthNorm() const {
+            return postings_->length_norms_[index_];
+        }
+
+        DocumentStatus Status() const {
+            return static_cast<DocumentStatus>(postings_->statuses_[index_]);
+        }
+
+        size_t Index() const {
+            return index_;
+        }
+
+        const_iterator& operator++() {
+            index_ = postings_->SkipErased(index_ + 1);
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return index_ == other.index_;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return index_ != other.index_;
+        }
+
+    private:
+        const PostingList* postings_;
+        size_t index_;
+    };
+
+    PostingList() = default;
+
+    explicit PostingList(const allocator_type& allocator)
+        : document_ids_(allocator)
+        , ordinals_(allocator)
+        , term_freqs_(allocator)
+        , length_norms_(allocator)
+        , statuses_(allocator)
+        , blocks_(allocator)
+        , pending_(allocator) {
+    }
+
+    PostingList(const PostingList&) = delete;
+    PostingList& operator=(const PostingList&) = delete;
+
+    const_iterator begin() const {
+        MergePending();
+        return {this, SkipErased(0)};
+    }
+
+    const_iterator end() const {
+        MergePending();
+        return {this, document_ids_.size()};
+    }
+
+    /** Число документов, включая еще не влитые в массивы. Вливание его не меняет, поэтому size буфер не вливает */
+    size_t size() const {
+        return live_count_;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t count(int document_id) const {
+        const const_iterator it = find(document_id);
+        return it.Index() != document_ids_.size();
+    }
+
+    const_iterator find(int document_id) const {
+        MergePending();
+        const size_t index = LowerBound(document_id);
+        if (index == document_ids_.size() || document_ids_[index] != document_id || IsErased(index)) {
+            return {this, document_ids_.size()};
+        }
+        return {this, index};
+    }
+
+    /** Первая запись не раньше it с id документа >= document_id.
+     *  Сначала по последним id блоков находится нужный блок, поиск идет только внутри него */
+    const_iterator Seek(const_iterator it, int document_id) const {
+        const size_t index = it.Index();
+        if (index >= document_ids_.size() || document_ids_[index] >= document_id) {
+            return it;
+        }
+        const size_t block = SeekBlock(BlockOf(index), document_id);
+        if (block == blocks_.size()) {
+            return {this, document_ids_.size()};
+        }
+        const auto first = document_ids_.begin() + std::max(index, block * POSTING_BLOCK_SIZE);
+        const auto last = document_ids_.begin() + std::min(document_ids_.size(), (block + 1) * POSTING_BLOCK_SIZE);
+        return {this, SkipErased(static_cast<size_t>(std::lower_bound(first, last, document_id) - document_ids_.begin()))};
+    }
+
+    /** Первая запись не раньше it, статус которой входит в status_mask */
+    const_iterator SkipToStatus(const_iterator it, StatusMask status_mask) const {
+        if (status_mask == ALL_STATUSES_MASK) {
+            return it;
+        }
+        size_t index = it.Index();
+        while (index < statuses_.size()) {
+            const size_t block = BlockOf(index);
+            if ((blocks_[block].status_mask & status_mask) == 0) {
+                index = (block + 1) * POSTING_BLOCK_SIZE;
+                continue;
+            }
+            // бит ERASED_POSTING_STATUS в маску не входит, удаленные записи пропускаются здесь же
+            if (StatusBit(static_cast<DocumentStatus>(statuses_[index])) & status_mask) {
+                break;
+            }
+            ++index;
+        }
+        return {this, std::min(index, statuses_.size())};
+    }
+
+    /** Id документов подряд, для пересечения списков. Среди них есть id удаленных записей (IsErased),
+     *  длина массива - StoredSize */
+    const int* DocumentIds() const {
+        MergePending();
+        return document_ids_.data();
+    }
+
+    size_t StoredSize() const {
+        MergePending();
+        return document_ids_.size();
+    }
+
+    bool IsErased(size_t index) const {
+        return statuses_[index] == ERASED_POSTING_STATUS;
+    }
+
+    const_iterator At(size_t index) const {
+        return {this, index};
+    }
+
+    static size_t BlockOf(size_t index) {
+        return index / POSTING_BLOCK_SIZE;
+    }
+
+    const std::pmr::vector<Block>& GetBlocks() const {
+        MergePending();
+        return blocks_;
+    }
+
+    /** Номер первого блока, начиная с block, в котором может быть документ document_id (или blocks.size()) */
+    size_t SeekBlock(size_t block, int document_id) const {
+        while (block < blocks_.size() && blocks_[block].last_document_id < document_id) {
+            ++block;
+        }
+        return block;
+    }
+
+    /** Прибавляет частоту слова в документе, возвращает true, если документа в списке еще не было */
+    bool Add(int document_id, uint32_t ordinal, double term_freq, uint8_t length_norm, DocumentStatus status) {
+        if (document_ids_.empty() || document_ids_.back() < document_id) {
+            // основной случай - документы добавляются по возрастанию id
+            document_ids_.push_back(document_id);
+            ordinals_.push_back(ordinal);
+            term_freqs_.push_back(term_freq);
+            length_norms_.push_back(length_norm);
+            statuses_.push_back(static_cast<uint8_t>(status));
+            const size_t index = document_ids_.size() - 1;
+            if (index % POSTING_BLOCK_SIZE == 0) {
+                blocks_.push_back({document_id, length_norm, StatusBit(status), term_freq});
+            } else {
+                Block& block = blocks_.back();
+                block = {document_id, std::max(block.max_length_norm, length_norm),
+                         static_cast<StatusMask>(block.status_mask | StatusBit(status)), std::max(block.max_term_freq, term_freq)};
+            }
+            max_term_freq_.Add(term_freq);
+            max_length_norm_.Add(length_norm);
+            ++live_count_;
+            return true;
+        }
+        const size_t index = LowerBound(document_id);
+        if (document_ids_[index] == document_id && !IsErased(index)) {
+            // частота только растет: если старая была единственным максимумом, новая его превосходит
+            max_term_freq_.Remove(term_freqs_[index]);
+            term_freqs_[index] += term_freq;
+            max_term_freq_.Add(term_freqs_[index]);
+            Block& block = blocks_[BlockOf(index)];
+            block.max_term_freq = std::max(block.max_term_freq, term_freqs_[index]);
+            return false;
+        }
+        if (document_ids_[index] == document_id) {
+            // документ удаляли и добавляют снова (перезапись из контрольной точки): запись оживает на месте
+            ordinals_[index] = ordinal;
+            term_freqs_[index] = term_freq;
+            length_norms_[index] = length_norm;
+            statuses_[index] = static_cast<uint8_t>(status);
+            --erased_count_;
+            UpdateBlock(BlockOf(index));
+            max_term_freq_.Add(term_freq);
+            max_length_norm_.Add(length_norm);
+            ++live_count_;
+            return true;
+        }
+        const auto it_pending = std::lower_bound(pending_.begin(), pending_.end(), document_id, [](const PendingPosting& posting, int id) {
+            return posting.document_id < id;
+        });
+        if (it_pending != pending_.end() && it_pending->document_id == document_id) {
+            max_term_freq_.Remove(it_pending->term_freq);
+            it_pending->term_freq += term_freq;
+            max_term_freq_.Add(it_pending->term_freq);
+            return false;
+        }
+        max_term_freq_.Add(term_freq);
+        max_length_norm_.Add(length_norm);
+        ++live_count_;
+        pending_.insert(it_pending, {document_id, ordinal, term_freq, length_norm, static_cast<uint8_t>(status)});
+        // место под вливание резервируется сейчас, чтобы чтение, вливающее буфер, не меняло емкость массивов
+        Reserve(document_ids_.size() + pending_.size());
+        if (pending_.size() >= POSTING_BLOCK_SIZE && pending_.size() * pending_.size() >= document_ids_.size()) {
+            Rebuild();
+        } else {
+            has_pending_.store(true, std::memory_order_release);
+        }
+        return true;
+    }
+
+    void erase(int document_id) {
+        bool is_max_removed = false;
+        if (EraseDocument(document_id, is_max_removed)) {
+            CompactIfSparse();
+        }
+        if (is_max_removed) {
+            RecountMaximums();
+        }
+    }
+
+    /** Удаляет все документы из упорядоченного по возрастанию списка, возвращает число удаленных записей */
+    size_t EraseDocuments(const std::vector<int>& sorted_document_ids) {
+        size_t erased = 0;
+        bool is_max_removed = false;
+        for (int document_id : sorted_document_ids) {
+            erased += EraseDocument(document_id, is_max_removed) ? 1 : 0;
+        }
+        if (erased > 0) {
+            CompactIfSparse();
+        }
+        if (is_max_removed) {
+            RecountMaximums();
+        }
+        return erased;
+    }
+
+    /** Меняет статус документа, пересчитывается только маска его блока */
+    void SetStatus(int document_id, DocumentStatus status) {
+        const size_t index = LowerBound(document_id);
+        if (index < document_ids_.size() && document_ids_[index] == document_id && !IsErased(index)) {
+            statuses_[index] = static_cast<uint8_t>(status);
+            const size_t block = BlockOf(index);
+            blocks_[block].status_mask = BlockStatusMask(block);
+            return;
+        }
+        const auto it_pending = FindPending(document_id);
+        if (it_pending != pending_.end()) {
+            it_pending->status = static_cast<uint8_t>(status);
+        }
+    }
+
+    /** Верхние границы частоты и длины по всем документам списка, включая буфер */
+    double GetMaxTermFreq() const {
+        return max_term_freq_.Get();
+    }
+
+    uint8_t GetMaxLengthNorm() const {
+        return max_length_norm_.Get();
+    }
+
+    /** Байты, занятые массивами списка (по емкости) */
+    size_t CapacityBytes() const {
+        return document_ids_.capacity() * sizeof(int) + ordinals_.capacity() * sizeof(uint32_t)
+               + term_freqs_.capacity() * sizeof(double)
+               + length_norms_.capacity() * sizeof(uint8_t) + statuses_.capacity() * sizeof(uint8_t)
+               + blocks_.capacity() * sizeof(Block) + pending_.capacity() * sizeof(PendingPosting);
+    }
+
+    /** Байты, реально нужные списку из length записей */
+    static size_t UsedBytes(size_t length) {
+        return length * (sizeof(int) + sizeof(uint32_t) + sizeof(double) + 2 * sizeof(uint8_t)) + (length + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE * sizeof(Block);
+    }
+
+    /** То же с учетом округления и служебных данных malloc */
+    size_t AllocatedBytes() const {
+        return VectorAllocatedBytes(document_ids_) + VectorAllocatedBytes(ordinals_) + VectorAllocatedBytes(term_freqs_)
+               + VectorAllocatedBytes(length_norms_) + VectorAllocatedBytes(statuses_) + VectorAllocatedBytes(blocks_)
+               + VectorAllocatedBytes(pending_);
+    }
+
+private:
+    struct PendingPosting {
+        int document_id;
+        uint32_t ordinal;
+        double term_freq;
+        uint8_t length_norm;
+        uint8_t status;
+    };
+
+    std::pmr::vector<int> document_ids_;
+    std::pmr::vector<uint32_t> ordinals_;
+    std::pmr::vector<double> term_freqs_;
+    std::pmr::vector<uint8_t> length_norms_;
+    std::pmr::vector<uint8_t> statuses_;
+    std::pmr::vector<Block> blocks_;
+    size_t live_count_ = 0;
+    /** Записи с ERASED_POSTING_STATUS в массивах */
+    size_t erased_count_ = 0;
+    /** Документы, добавленные не по возрастанию id, по возрастанию id; все меньше последнего id массивов */
+    std::pmr::vector<PendingPosting> pending_;
+    /** !pending_.empty() для читающих потоков; merging_ - замок вливания буфера при чтении */
+    std::atomic<bool> has_pending_{false};
+    mutable std::atomic_flag merging_ = ATOMIC_FLAG_INIT;
+    CountedMaximum<double> max_term_freq_;
+    CountedMaximum<uint8_t> max_length_norm_;
+
+    template <typename T>
+    static size_t VectorAllocatedBytes(const std::pmr::vector<T>& vec) {
+        return vec.capacity() == 0 ? 0 : MallocChunkBytes(vec.capacity() * sizeof(T));
+    }
+
+    size_t LowerBound(int document_id) const {
+        return std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id) - document_ids_.begin();
+    }
+
+    size_t SkipErased(size_t index) const {
+        while (index < statuses_.size() && statuses_[index] == ERASED_POSTING_STATUS) {
+            ++index;
+        }
+        return index;
+    }
+
+    std::pmr::vector<PendingPosting>::iterator FindPending(int document_id) {
+        const auto it = std::lower_bound(pending_.begin(), pending_.end(), document_id, [](const PendingPosting& posting, int id) {
+            return posting.document_id < id;
+        });
+        return it != pending_.end() && it->document_id == document_id ? it : pending_.end();
+    }
+
+    /** Вливает буфер при чтении. Список без буфера - одно атомарное чтение; вливает первый читатель,
+     *  остальные ждут. Сам список не константный объект (он лежит в индексе), поэтому const_cast законен */
+    void MergePending() const {
+        if (!has_pending_.load(std::memory_order_acquire)) {
+            return;
+        }
+        while (merging_.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        if (has_pending_.load(std::memory_order_relaxed)) {
+            const_cast<PostingList*>(this)->Rebuild();
+        }
+        merging_.clear(std::memory_order_release);
+    }
+
+    /** Помечает запись удаленной, блок пересчитывается, массивы не сдвигаются */
+    bool EraseDocument(int document_id, bool& is_max_removed) {
+        const size_t index = LowerBound(document_id);
+        if (index < document_ids_.size() && document_ids_[index] == document_id && !IsErased(index)) {
+            is_max_removed = RemoveFromMaximums(term_freqs_[index], length_norms_[index]) || is_max_removed;
+            // нулевые частота и длина не влияют на максимумы блока
+            term_freqs_[index] = 0.0;
+            length_norms_[index] = 0;
+            statuses_[index] = ERASED_POSTING_STATUS;
+            ++erased_count_;
+            --live_count_;
+            UpdateBlock(BlockOf(index));
+            return true;
+        }
+        const auto it_pending = FindPending(document_id);
+        if (it_pending == pending_.end()) {
+            return false;
+        }
+        is_max_removed = RemoveFromMaximums(it_pending->term_freq, it_pending->length_norm) || is_max_removed;
+        pending_.erase(it_pending);
+        --live_count_;
+        has_pending_.store(!pending_.empty(), std::memory_order_release);
+        return true;
+    }
+
+    /** Уплотнение, когда удаленных записей больше четверти: каждое стоит O(длины), но случается
+     *  не чаще раза на четверть длины удалений */
+    void CompactIfSparse() {
+        if (erased_count_ >= POSTING_BLOCK_SIZE && erased_count_ * 4 >= document_ids_.size()) {
+            Rebuild();
+        }
+    }
+
+    /** Резерв с геометрическим ростом под count записей */
+    void Reserve(size_t count) {
+        if (document_ids_.capacity() >= count) {
+            return;
+        }
+        count = std::max(count, document_ids_.capacity() * 2);
+        document_ids_.reserve(count);
+        ordinals_.reserve(count);
+        term_freqs_.reserve(count);
+        length_norms_.reserve(count);
+        statuses_.reserve(count);
+        blocks_.reserve((count + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE);
+    }
+
+    /** Убирает удаленные записи и вливает буфер: уплотнение вперед, затем слияние с буфером с конца, на месте */
+    void Rebuild() {
+        size_t write = 0;
+        for (size_t read = 0; read < document_ids_.size(); ++read) {
+            if (IsErased(read)) {
+                continue;
+            }
+            document_ids_[write] = document_ids_[read];
+            ordinals_[write] = ordinals_[read];
+            term_freqs_[write] = term_freqs_[read];
+            length_norms_[write] = length_norms_[read];
+            statuses_[write] = statuses_[read];
+            ++write;
+        }
+        const size_t new_size = write + pending_.size();
+        document_ids_.resize(new_size);
+        ordinals_.resize(new_size);
+        term_freqs_.resize(new_size);
+        length_norms_.resize(new_size);
+        statuses_.resize(new_size);
+        size_t read = write;
+        for (size_t pending = pending_.size(), target = new_size; pending > 0;) {
+            --target;
+            if (read > 0 && document_ids_[read - 1] > pending_[pending - 1].document_id) {
+                --read;
+                document_ids_[target] = document_ids_[read];
+                ordinals_[target] = ordinals_[read];
+                term_freqs_[target] = term_freqs_[read];
+                length_norms_[target] = length_norms_[read];
+                statuses_[target] = statuses_[read];
+            } else {
+                const PendingPosting& posting = pending_[--pending];
+                document_ids_[target] = posting.document_id;
+                ordinals_[target] = posting.ordinal;
+                term_freqs_[target] = posting.term_freq;
+                length_norms_[target] = posting.length_norm;
+                statuses_[target] = posting.status;
+            }
+        }
+        pending_.clear();
+        erased_count_ = 0;
+        RebuildBlocks(0);
+        has_pending_.store(false, std::memory_order_release);
+    }
+
+    StatusMask BlockStatusMask(size_t block) const {
+        const size_t first = block * POSTING_BLOCK_SIZE;
+        const size_t last = std::min(statuses_.size(), first + POSTING_BLOCK_SIZE);
+        StatusMask mask = 0;
+        for (size_t index = first; index < last; ++index) {
+            if (!IsErased(index)) {
+                mask |= StatusBit(static_cast<DocumentStatus>(statuses_[index]));
+            }
+        }
+        return mask;
+    }
+
+    /** Убирает значения записи из максимумов списка, возвращает true, если какой-то из них надо пересчитать */
+    bool RemoveFromMaximums(double term_freq, uint8_t length_norm) {
+        const bool is_term_freq_removed = max_term_freq_.Remove(term_freq);
+        const bool is_length_norm_removed = max_length_norm_.Remove(length_norm);
+        return is_term_freq_removed || is_length_norm_removed;
+    }
+
+    /** Максимум по блокам и буферу, затем число равных ему значений - только в блоках с этим максимумом */
+    template <typename T>
+    CountedMaximum<T> CountMaximum(T Block::*block_maximum, const std::pmr::vector<T>& values, T PendingPosting::*pending_value) const {
+        CountedMaximum<T> maximum;
+        for (const Block& block : blocks_) {
+            maximum.Add(block.*block_maximum);
+        }
+        for (const PendingPosting& posting : pending_) {
+            maximum.Add(posting.*pending_value);
+        }
+        const T value = maximum.Get();
+        maximum.Reset();
+        for (size_t block = 0; block < blocks_.size(); ++block) {
+            if (blocks_[block].*block_maximum != value) {
+                continue;
+            }
+            const size_t first = block * POSTING_BLOCK_SIZE;
+            const size_t last = std::min(values.size(), first + POSTING_BLOCK_SIZE);
+            for (size_t index = first; index < last; ++index) {
+                if (values[index] == value && !IsErased(index)) {
+                    maximum.Add(value);
+                }
+            }
+        }
+        for (const PendingPosting& posting : pending_) {
+            if (posting.*pending_value == value) {
+                maximum.Add(value);
+            }
+        }
+        return maximum;
+    }
+
+    /** Пересчет максимумов списка по уже пересчитанным блокам */
+    void RecountMaximums() {
+        max_term_freq_ = CountMaximum(&Block::max_term_freq, term_freqs_, &PendingPosting::term_freq);
+        max_length_norm_ = CountMaximum(&Block::max_length_norm, length_norms_, &PendingPosting::length_norm);
+    }
+
+    /** Пересчет одного блока, O(POSTING_BLOCK_SIZE). У удаленных записей частота и длина нулевые,
+     *  а id остается: последний id блока по-прежнему ограничивает id блока сверху */
+    void UpdateBlock(size_t block) {
+        const size_t first = block * POSTING_BLOCK_SIZE;
+        const size_t last = std::min(document_ids_.size(), first + POSTING_BLOCK_SIZE);
+        blocks_[block] = {document_ids_[last - 1],
+                          *std::max_element(length_norms_.begin() + first, length_norms_.begin() + last),
+                          BlockStatusMask(block),
+                          *std::max_element(term_freqs_.begin() + first, term_freqs_.begin() + last)};
+    }
+
+    /** Пересчитывает блоки начиная с first_block, емкость массива блоков не уменьшается */
+    void RebuildBlocks(size_t first_block) {
+        const size_t block_count = (document_ids_.size() + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+        blocks_.resize(block_count);
+        for (size_t block = first_block; block < block_count; ++block) {
+            UpdateBlock(block);
+        }
+    }
+};
@@ -0,0 +1,56 @@
+#include "query_explain.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+vector<Document> QueryExplain::GetDocuments() const {
+    vector<Document> result;
+    result.reserve(documents.size());
+    for (const DocumentExplain& document : documents) {
+        result.push_back(document.document);
+    }
+    return result;
+}
+//-------------------------------------------------------------------------------------------------------------
+void PrintQueryExplain(ostream& out, const QueryExplain& explain) {
+    out << "terms:"s << endl;
+    for (const TermExplain& term : explain.terms) {
+        out << "  "s << (term.is_minus ? "-"s : ""s) << term.word
+            << " postings="s << term.posting_length;
+        if (term.is_minus) {
+            out << " rejected="s << term.documents_rejected_by_minus_words << endl;
+            continue;
+        }
+        out << " idf="s << term.inverse_document_freq
+            << " scored="s << term.documents_scored
+            << " rejected_by_predicate="s << term.documents_rejected_by_predicate
+            << " rejected_by_minus_words="s << term.documents_rejected_by_minus_words << endl;
+    }
+    out << "candidates="s << explain.candidate_count << " rejected_by_phrases="s << explain.rejected_by_phrases << endl;
+    out << "phases:"s;
+    for (size_t phase = 0; phase < QUERY_PHASE_COUNT; ++phase) {
+        out << ' ' << QueryPhaseName(static_cast<QueryPhase>(phase)) << '=' << explain.phase_ns[phase] << "ns"s;
+    }
+    out << endl;
+    out << "counters:"s;
+    if (!explain.counters.HasAny()) {
+        out << " unavailable"s;
+    }
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (explain.counters.available[i]) {
+            out << ' ' << PerfCounterName(static_cast<PerfCounter>(i)) << '=' << explain.counters.values[i];
+        }
+    }
+    if (explain.counters.Has(PerfCounter::CYCLES) && explain.counters.Has(PerfCounter::INSTRUCTIONS)) {
+        out << " ipc="s << explain.counters.InstructionsPerCycle();
+    }
+    out << endl;
+    for (const DocumentExplain& document : explain.documents) {
+        out << document.document << endl;
+        for (size_t i = 0; i < explain.terms.size(); ++i) {
+            if (!explain.terms[i].is_minus && document.term_relevances[i] != 0.0) {
+                out << "  "s << explain.terms[i].word << ' ' << document.term_relevances[i] << endl;
+            }
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "document.h"
+#include "latency_histogram.h"
+#include "perf_counters.h"
+
+//-------------------------------------------------------------------------------------------------------------
+/** Разбор одного слова запроса в ExplainTopDocuments. Шаблоны и нечеткие слова раскрыты,
+ *  каждое найденное слово словаря - отдельный разбор */
+struct TermExplain {
+    std::string word;
+    bool is_minus = false;
+    /** Длина списка документов слова, 0 - слова нет в словаре */
+    size_t posting_length = 0;
+    /** idf стратегии с учетом веса нечеткого поиска; у минус-слов 0 */
+    double inverse_document_freq = 0.0;
+    /** Плюс-слово: документы списка, получившие вклад слова */
+    size_t documents_scored = 0;
+    /** Плюс-слово: документы списка, не прошедшие предикат */
+    size_t documents_rejected_by_predicate = 0;
+    /** Плюс-слово: документы с вкладом слова, исключенные минус-словами.
+     *  Минус-слово: документы-кандидаты, исключенные этим словом (первым из минус-слов документа) */
+    size_t documents_rejected_by_minus_words = 0;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Документ выдачи и вклад каждого слова в его релевантность, по порядку QueryExplain::terms */
+struct DocumentExplain {
+    Document document;
+    std::vector<double> term_relevances;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Результат ExplainTopDocuments: та же выдача, что у FindTopDocuments, и откуда она взялась */
+struct QueryExplain {
+    std::vector<DocumentExplain> documents;
+    /** Сначала плюс-слова, затем минус-слова, в порядке разобранного запроса */
+    std::vector<TermExplain> terms;
+    /** Документы, получившие вклад хотя бы одного плюс-слова */
+    size_t candidate_count = 0;
+    /** Кандидаты без минус-слов, не содержащие фраз запроса */
+    size_t rejected_by_phrases = 0;
+    /** Длительность фаз в наносекундах, по номеру QueryPhase */
+    std::array<uint64_t, QUERY_PHASE_COUNT> phase_ns{};
+    /** Счетчики процессора за весь запрос, включая разбор; без доступа к perf_event_open пусты */
+    PerfCounterSample counters;
+
+    std::vector<Document> GetDocuments() const;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Таблица слов, фаз и вкладов слов в документы выдачи */
+void PrintQueryExplain(std::ostream& out, const QueryExplain& explain);
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "query_statistics.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+static QueryStatistics::Clock::duration ToClockDuration(chrono::seconds duration) {
+    return chrono::duration_cast<QueryStatistics::Clock::duration>(duration);
+}
+//-------------------------------------------------------------------------------------------------------------
+QueryStatistics::QueryStatistics()
+    : rings_{Ring{ToClockDuration(1s), 60, make_unique<Bucket[]>(60)},
+             Ring{ToClockDuration(1min), 60, make_unique<Bucket[]>(60)},
+             Ring{ToClockDuration(15min), 96, make_unique<Bucket[]>(96)}} {
+}
+//-------------------------------------------------------------------------------------------------------------
+void QueryStatistics::Record(Clock::duration latency, size_t result_count, Clock::time_point now) {
+    const uint64_t latency_ns = static_cast<uint64_t>(max<int64_t>(0, chrono::duration_cast<chrono::nanoseconds>(latency).count()));
+    const size_t latency_bin = LatencyBin(latency_ns);
+    for (Ring& ring : rings_) {
+        Bucket* bucket = AcquireBucket(ring, SlotOf(ring, now));
+        if (bucket == nullptr) {
+            continue;
+        }
+        bucket->request_count.fetch_add(1, memory_order_relaxed);
+        if (result_count == 0) {
+            bucket->zero_result_count.fetch_add(1, memory_order_relaxed);
+        }
+        bucket->latency_bins[latency_bin].fetch_add(1, memory_order_relaxed);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+QueryWindowStats QueryStatistics::Snapshot(StatisticsWindow window, Clock::time_point now) const {
+    const Ring& ring = rings_[static_cast<size_t>(window)];
+    const int64_t current_slot = SlotOf(ring, now);
+    const int64_t first_slot = current_slot - static_cast<int64_t>(ring.bucket_count) + 1;
+
+    QueryWindowStats stats;
+    array<uint64_t, LATENCY_BIN_COUNT> latency_bins{};
+    for (size_t i = 0; i < ring.bucket_count; ++i) {
+        const Bucket& bucket = ring.buckets[i];
+        const int64_t slot = bucket.slot.load(memory_order_acquire);
+        // пустые и обнуляемые корзины имеют отрицательный слот
+        if (slot < 0 || slot < first_slot || slot > current_slot) {
+            continue;
+        }
+        stats.request_count += bucket.request_count.load(memory_order_relaxed);
+        stats.zero_result_count += bucket.zero_result_count.load(memory_order_relaxed);
+        for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+            latency_bins[bin] += bucket.latency_bins[bin].load(memory_order_relaxed);
+        }
+    }
+
+    // счетчики корзины читаются не атомарно вместе, поэтому ранги берутся по сумме корзин латентности
+    uint64_t total = 0;
+    for (const uint64_t count : latency_bins) {
+        total += count;
+    }
+    if (total == 0) {
+        return stats;
+    }
+    const auto value_at_percentile = [&](double percentile) {
+        const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(percentile / 100.0 * total)));
+        uint64_t cumulative = 0;
+        for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+            cumulative += latency_bins[bin];
+            if (cumulative >= rank) {
+                return LatencyBinUpperValue(bin);
+            }
+        }
+        return LatencyBinUpperValue(LATENCY_BIN_COUNT - 1);
+    };
+    stats.p50_ns = value_at_percentile(50.0);
+    stats.p99_ns = value_at_percentile(99.0);
+    stats.p999_ns = value_at_percentile(99.9);
+    return stats;
+}
+//-------------------------------------------------------------------------------------------------------------
+QueryStatistics::Bucket* QueryStatistics::AcquireBucket(Ring& ring, int64_t slot) {
+    Bucket& bucket = ring.buckets[static_cast<size_t>(slot) % ring.bucket_count];
+    int64_t current = bucket.slot.load(memory_order_acquire);
+    while (current != slot) {
+        if (current == RESETTING_SLOT) {
+            this_thread::yield();
+            current = bucket.slot.load(memory_order_acquire);
+            continue;
+        }
+        if (current > slot) {
+            return nullptr;
+        }
+        // обнуляет корзину тот, кто первым пометил ее; неудачный CAS перечитывает current
+        if (bucket.slot.compare_exchange_weak(current, RESETTING_SLOT, memory_order_acquire)) {
+            bucket.request_count.store(0, memory_order_relaxed);
+            bucket.zero_result_count.store(0, memory_order_relaxed);
+            for (atomic<uint32_t>& count : bucket.latency_bins) {
+                count.store(0, memory_order_relaxed);
+            }
+            bucket.slot.store(slot, memory_order_release);
+            break;
+        }
+    }
+    return &bucket;
+}
+//-------------------------------------------------------------------------------------------------------------
+int64_t QueryStatistics::SlotOf(const Ring& ring, Clock::time_point now) {
+    return max<int64_t>(0, now.time_since_epoch() / ring.bucket_width);
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t QueryStatistics::LatencyBin(uint64_t latency_ns) {
+    if (latency_ns < SUB_BIN_COUNT) {
+        return static_cast<size_t>(latency_ns);
+    }
+#if defined(__GNUC__)
+    const int exponent = 63 - __builtin_clzll(latency_ns);
+#else
+    int exponent = 0;
+    while ((latency_ns >> exponent) > 1) {
+        ++exponent;
+    }
+#endif
+    if (exponent > MAX_EXPONENT) {
+        return LATENCY_BIN_COUNT - 1;
+    }
+    const uint64_t sub_bin = (latency_ns >> (exponent - SUB_BIN_BITS)) - SUB_BIN_COUNT;
+    return static_cast<size_t>((exponent - SUB_BIN_BITS + 1) * SUB_BIN_COUNT + sub_bin);
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t QueryStatistics::LatencyBinUpperValue(size_t bin) {
+    if (bin < SUB_BIN_COUNT) {
+        return bin;
+    }
+    const int exponent = static_cast<int>(bin / SUB_BIN_COUNT) + SUB_BIN_BITS - 1;
+    const uint64_t sub_bin = bin % SUB_BIN_COUNT + SUB_BIN_COUNT;
+    const int shift = exponent - SUB_BIN_BITS;
+    return (sub_bin << shift) + (uint64_t{1} << shift) - 1;
+}
+//-------------------------------------------------------------------------------------------------------------
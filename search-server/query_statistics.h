@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Скользящие окна статистики запросов */
+enum class StatisticsWindow {
+    MINUTE, // 60 корзин по секунде
+    HOUR,   // 60 корзин по минуте
+    DAY,    // 96 корзин по 15 минут
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Статистика запросов за окно. Окно - последние корзины кольца, включая текущую неполную,
+ *  поэтому реально покрывается время от (N - 1) до N ширин корзины */
+struct QueryWindowStats {
+    uint64_t request_count = 0;
+    uint64_t zero_result_count = 0;
+    /** Процентили задержки в наносекундах, с точностью до 1/8 */
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+
+    double ZeroResultRate() const {
+        return request_count == 0 ? 0.0 : static_cast<double>(zero_result_count) / request_count;
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Статистика запросов, в которую пишут без блокировок из любого числа потоков: счетчики корзин атомарные,
+ *  корзина, отставшая от текущего времени на целое кольцо, обнуляется первым записавшим в нее потоком
+ *  (остальные писатели этой корзины ждут только на время обнуления, раз за интервал).
+ *  Чтение окна - сумма фиксированного числа корзин, не зависит от числа запросов */
+class QueryStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    QueryStatistics();
+
+    void Record(Clock::duration latency, size_t result_count, Clock::time_point now = Clock::now());
+
+    QueryWindowStats Snapshot(StatisticsWindow window, Clock::time_point now = Clock::now()) const;
+
+private:
+    /** Латентность делится на корзины как в LatencyHistogram, но грубее: 8 корзин на степень двойки до 2^40 нс */
+    static constexpr int SUB_BIN_BITS = 3;
+    static constexpr uint64_t SUB_BIN_COUNT = uint64_t{1} << SUB_BIN_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr size_t LATENCY_BIN_COUNT = (MAX_EXPONENT - SUB_BIN_BITS + 2) * SUB_BIN_COUNT;
+    /** Слот корзины, в которую еще не писали, и корзины, которую сейчас обнуляет писатель */
+    static constexpr int64_t EMPTY_SLOT = -2;
+    static constexpr int64_t RESETTING_SLOT = -1;
+
+    struct Bucket {
+        /** Номер интервала времени, к которому относятся счетчики */
+        std::atomic<int64_t> slot{EMPTY_SLOT};
+        std::atomic<uint64_t> request_count{0};
+        std::atomic<uint64_t> zero_result_count{0};
+        std::array<std::atomic<uint32_t>, LATENCY_BIN_COUNT> latency_bins{};
+    };
+
+    struct Ring {
+        Clock::duration bucket_width;
+        size_t bucket_count;
+        std::unique_ptr<Bucket[]> buckets;
+    };
+
+    std::array<Ring, 3> rings_;
+
+    /** Корзина кольца для интервала slot, при смене интервала обнуленная; nullptr, если корзина
+     *  уже отдана более новому интервалу (запись опоздала на целое кольцо) */
+    static Bucket* AcquireBucket(Ring& ring, int64_t slot);
+
+    /** Номер интервала кольца, отсчитанный от начала эпохи часов */
+    static int64_t SlotOf(const Ring& ring, Clock::time_point now);
+
+    static size_t LatencyBin(uint64_t latency_ns);
+
+    static uint64_t LatencyBinUpperValue(size_t bin);
+};
+//-------------------------------------------------------------------------------------------------------------
@@ -1,23 +1,156 @@
-﻿#include "remove_duplicates.h"
-#include <set>
+﻿#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "remove_duplicates.h"
+#include "fingerprint.h"
 
 using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Идентификаторы слов документа (TermId) по возрастанию */
+static vector<uint64_t> DocumentTermIds(const SearchServer& search_server, int document_id) {
+    vector<uint64_t> term_ids;
+    const auto& word_freqs = search_server.GetWordFrequencies(document_id);
+    term_ids.reserve(word_freqs.size());
+    for (const auto& word_freq : word_freqs) {
+        term_ids.push_back(TermId(word_freq.first));
+    }
+    sort(term_ids.begin(), term_ids.end());
+    return term_ids;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Сходство Жаккара двух упорядоченных наборов */
+static double JaccardSimilarity(const vector<uint64_t>& lhs, const vector<uint64_t>& rhs) {
+    size_t common = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (*lhs_it < *rhs_it) {
+            ++lhs_it;
+        } else if (*rhs_it < *lhs_it) {
+            ++rhs_it;
+        } else {
+            ++common;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    const size_t united = lhs.size() + rhs.size() - common;
+    return united == 0 ? 1.0 : static_cast<double>(common) / united;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Число строк в полосе LSH. Пара с похожестью s попадает в общую корзину хотя бы одной из b полос
+ *  с вероятностью 1 - (1 - s^r)^b: берется самая длинная полоса, при которой пары на пороге
+ *  находятся с вероятностью не меньше LSH_MIN_RECALL. Ложные кандидаты отсеиваются точной проверкой */
+static size_t LshRowsPerBand(double jaccard_threshold) {
+    static const double LSH_MIN_RECALL = 0.99;
+    size_t best_rows = 1;
+    for (size_t rows = 2; rows <= MIN_HASH_COUNT; rows *= 2) {
+        const double bands = static_cast<double>(MIN_HASH_COUNT / rows);
+        if (1.0 - pow(1.0 - pow(jaccard_threshold, rows), bands) >= LSH_MIN_RECALL) {
+            best_rows = rows;
+        }
+    }
+    return best_rows;
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<int> RemoveDuplicates(SearchServer& search_server) {
+    // проход нужен при любой политике: дубликаты могли попасть в индекс до SetDuplicatePolicy
+    // или из контрольной точки, а отпечаток тот же, что у AddDocument
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    vector<Fingerprint128> fingerprints(document_ids.size());
+    transform(execution::par, document_ids.begin(), document_ids.end(), fingerprints.begin(),
+              [&search_server](int document_id) {
+                  return ComputeTermSetFingerprint(DocumentTermIds(search_server, document_id));
+              });
+
+    // упорядочиваем по (отпечаток, id): в каждой группе одинаковых отпечатков первым оказывается меньший id
+    vector<size_t> order(document_ids.size());
+    iota(order.begin(), order.end(), 0);
+    sort(execution::par, order.begin(), order.end(), [&fingerprints](size_t lhs, size_t rhs) {
+        return fingerprints[lhs] != fingerprints[rhs] ? fingerprints[lhs] < fingerprints[rhs] : lhs < rhs;
+    });
+    vector<int> duplicates;
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (fingerprints[order[i]] == fingerprints[order[i - 1]]) {
+            duplicates.push_back(document_ids[order[i]]);
+        }
+    }
+    sort(duplicates.begin(), duplicates.end());
+
+    search_server.RemoveDocuments(duplicates);
+    return duplicates;
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<int> RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold) {
+    if (!(jaccard_threshold > 0.0 && jaccard_threshold <= 1.0)) {
+        throw invalid_argument("Jaccard threshold must be in (0, 1]");
+    }
+    // точные дубликаты убираются по отпечаткам, чтобы не раздувать корзины LSH
+    vector<int> removed = RemoveDuplicates(search_server);
 
-void RemoveDuplicates(SearchServer& search_server){
-    vector<int> list_del;
-    set<set<string_view>> words_multiset;
-    for(int id : search_server){
-        set<string_view> temp;
-        for(const auto& [word, _] : search_server.GetWordFrequencies(id)){ // TODO как не получать warning unused variable _
-            temp.insert(word);
+    const vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t document_count = document_ids.size();
+    vector<vector<uint64_t>> term_ids(document_count);
+    vector<vector<uint64_t>> signatures(document_count);
+    vector<size_t> indexes(document_count);
+    iota(indexes.begin(), indexes.end(), 0);
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        term_ids[index] = DocumentTermIds(search_server, document_ids[index]);
+        signatures[index] = ComputeMinHash(term_ids[index], MIN_HASH_COUNT);
+    });
+
+    // документы, попавшие в одну корзину хотя бы одной полосы, - кандидаты в почти-дубликаты
+    const size_t rows = LshRowsPerBand(jaccard_threshold);
+    vector<vector<size_t>> candidates(document_count);
+    for (size_t band = 0; band < MIN_HASH_COUNT / rows; ++band) {
+        unordered_map<uint64_t, vector<size_t>> buckets;
+        for (size_t index = 0; index < document_count; ++index) {
+            uint64_t key = Mix64(band);
+            for (size_t row = band * rows; row < (band + 1) * rows; ++row) {
+                key = Mix64(key ^ signatures[index][row]);
+            }
+            buckets[key].push_back(index);
         }
-        const auto& [_, flag] = words_multiset.insert(temp);
-        if(flag == false){ // если вставка не удалась запоминаем id
-            list_del.push_back(id);
+        for (const auto& [_, bucket] : buckets) {
+            for (size_t i = 1; i < bucket.size(); ++i) {
+                for (size_t j = 0; j < i; ++j) {
+                    candidates[bucket[i]].push_back(bucket[j]);
+                }
+            }
         }
     }
-    for(int id : list_del){
-        search_server.RemoveDocument(id);
-        cout << "Found duplicate document id " << id << endl;
+
+    // документ удаляется, если похож на оставленный документ с меньшим id; проверка пар - параллельно
+    vector<vector<size_t>> similar(document_count);
+    for_each(execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        auto& others = candidates[index];
+        sort(others.begin(), others.end());
+        others.erase(unique(others.begin(), others.end()), others.end());
+        for (size_t other : others) {
+            if (JaccardSimilarity(term_ids[index], term_ids[other]) >= jaccard_threshold) {
+                similar[index].push_back(other);
+            }
+        }
+    });
+    vector<bool> kept(document_count, true);
+    vector<int> near_duplicates;
+    for (size_t index = 0; index < document_count; ++index) {
+        for (size_t other : similar[index]) {
+            if (kept[other]) {
+                kept[index] = false;
+                near_duplicates.push_back(document_ids[index]);
+                break;
+            }
+        }
     }
+    search_server.RemoveDocuments(near_duplicates);
+
+    removed.insert(removed.end(), near_duplicates.begin(), near_duplicates.end());
+    sort(removed.begin(), removed.end());
+    return removed;
 }
+//-------------------------------------------------------------------------------------------------------------
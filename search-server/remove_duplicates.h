@@ -1,5 +1,19 @@
 #pragma once
 
+#include <vector>
+
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
+/** Число хеш-функций MinHash сигнатуры документа */
+constexpr size_t MIN_HASH_COUNT = 128;
+
+/** Удаляет документы с тем же набором слов, что и у документа с меньшим id.
+ *  Отпечатки наборов слов считаются параллельно, дубликаты удаляются одной пачкой.
+ *  Возвращает удаленные id по возрастанию */
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
+
+/** Удаляет почти-дубликаты: документы, сходство Жаккара наборов слов которых с оставленным документом
+ *  с меньшим id не меньше jaccard_threshold (0 < jaccard_threshold <= 1).
+ *  Кандидаты ищутся MinHash + LSH, каждая пара проверяется точным сходством Жаккара.
+ *  Возвращает удаленные id по возрастанию */
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server, double jaccard_threshold);
@@ -7,15 +7,24 @@ RequestQueue::RequestQueue(const SearchServer& search_server)
     , current_time_(0) {
 }
 //-------------------------------------------------------------------------------------------------------------
+RequestQueue::RequestQueue(const SearchServer& search_server, QueryStatistics& statistics)
+    : search_server_(search_server)
+    , statistics_(&statistics)
+    , no_results_requests_(0)
+    , current_time_(0) {
+}
+//-------------------------------------------------------------------------------------------------------------
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
+    const auto start_time = QueryStatistics::Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(static_cast<int>(result.size()));
+    AddRequest(static_cast<int>(result.size()), start_time);
     return result;
 }
 //-------------------------------------------------------------------------------------------------------------
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+    const auto start_time = QueryStatistics::Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(static_cast<int>(result.size()));
+    AddRequest(static_cast<int>(result.size()), start_time);
     return result;
 }
 //-------------------------------------------------------------------------------------------------------------
@@ -23,7 +32,11 @@ int RequestQueue::GetNoResultRequests() const {
     return no_results_requests_;
 }
 //-------------------------------------------------------------------------------------------------------------
-void RequestQueue::AddRequest(int results_num) {
+void RequestQueue::AddRequest(int results_num, QueryStatistics::Clock::time_point start_time) {
+    if (statistics_ != nullptr) {
+        const auto now = QueryStatistics::Clock::now();
+        statistics_->Record(now - start_time, static_cast<size_t>(results_num), now);
+    }
     // новый запрос - новая секунда
     ++current_time_;
     // удаляем все результаты поиска, которые устарели
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "document.h"
+#include "query_statistics.h"
 #include "search_server.h"
 
 //-------------------------------------------------------------------------------------------------------------
@@ -12,6 +13,9 @@ class RequestQueue {
 public:
     explicit RequestQueue(const SearchServer& search_server);
 
+    /** Кроме собственного счета запросы пишутся в statistics; одну статистику могут делить очереди разных потоков */
+    RequestQueue(const SearchServer& search_server, QueryStatistics& statistics);
+
     // сделаем "обертки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
@@ -23,7 +27,7 @@ public:
     int GetNoResultRequests() const;
 
 private:
-    void AddRequest(int results_num);
+    void AddRequest(int results_num, QueryStatistics::Clock::time_point start_time);
 
     struct QueryResult {
         uint64_t timestamp = 0;
@@ -34,6 +38,8 @@ private:
 
     const SearchServer& search_server_;
 
+    QueryStatistics* statistics_ = nullptr;
+
     int no_results_requests_;
 
     uint64_t current_time_;
@@ -43,7 +49,8 @@ private:
 //-------------------------------------------------------------------------------------------------------------
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const auto start_time = QueryStatistics::Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    AddRequest(static_cast<int>(result.size()), start_time);
     return result;
 }
@@ -0,0 +1,51 @@
+#include <stdexcept>
+#include <string>
+
+#include "scorer.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+static const size_t EXACT_LENGTH_LIMIT = 128;
+static const int EXACT_LENGTH_BITS = 7;
+static const int MANTISSA_BITS = 4;
+//-------------------------------------------------------------------------------------------------------------
+uint8_t EncodeDocumentLength(size_t length) {
+    if (length < EXACT_LENGTH_LIMIT) {
+        return static_cast<uint8_t>(length);
+    }
+    int exponent = 0;
+    while ((length >> exponent) > 1) {
+        ++exponent;
+    }
+    const size_t code = EXACT_LENGTH_LIMIT + (exponent - EXACT_LENGTH_BITS) * (1 << MANTISSA_BITS)
+                        + ((length >> (exponent - MANTISSA_BITS)) & ((1 << MANTISSA_BITS) - 1));
+    return static_cast<uint8_t>(min<size_t>(code, 255));
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t DecodeDocumentLength(uint8_t length_norm) {
+    if (length_norm < EXACT_LENGTH_LIMIT) {
+        return length_norm;
+    }
+    const size_t code = length_norm - EXACT_LENGTH_LIMIT;
+    const int exponent = EXACT_LENGTH_BITS + static_cast<int>(code >> MANTISSA_BITS);
+    const size_t mantissa = (size_t{1} << MANTISSA_BITS) | (code & ((1 << MANTISSA_BITS) - 1));
+    return mantissa << (exponent - MANTISSA_BITS);
+}
+//-------------------------------------------------------------------------------------------------------------
+Bm25Scorer::Bm25Scorer(double k1, double b)
+    : k1_(k1)
+    , b_(b) {
+    if (k1 < 0.0 || b < 0.0 || b > 1.0) {
+        throw invalid_argument("BM25 requires k1 >= 0 and 0 <= b <= 1"s);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void Bm25Scorer::Prepare(const CorpusStats& stats, size_t) {
+    const double average_length = stats.average_document_length > 0.0 ? stats.average_document_length : 1.0;
+    for (size_t length_norm = 0; length_norm < length_norms_.size(); ++length_norm) {
+        // пустой документ не попадает ни в один список, длина 1 только защищает от деления на ноль
+        const double length = max<size_t>(1, DecodeDocumentLength(static_cast<uint8_t>(length_norm)));
+        length_norms_[length_norm] = k1_ * (1.0 - b_ + b_ * length / average_length) / length;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
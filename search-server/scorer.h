@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Длина документа (число слов без стоп-слов), сжатая в байт: до 127 точно, дальше 16 ступеней
+ *  на каждое удвоение (ошибка меньше 1/16), длины от 2^15 слов не различаются */
+uint8_t EncodeDocumentLength(size_t length);
+//-------------------------------------------------------------------------------------------------------------
+/** Наименьшая длина, которая сжимается в length_norm; неубывает по length_norm */
+size_t DecodeDocumentLength(uint8_t length_norm);
+//-------------------------------------------------------------------------------------------------------------
+/** Статистика коллекции, от которой зависит оценка слова */
+struct CorpusStats {
+    int document_count = 0;
+    double average_document_length = 0.0;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Стратегии оценки релевантности для FindTopDocuments. Вклад слова в документ - Score от idf слова,
+ *  частоты слова в документе (число вхождений / длина документа) и сжатой длины документа.
+ *  UpperBound должна быть не меньше Score для любой частоты <= max_term_freq и длины <= max_length_norm:
+ *  по ней FindTopDocuments отсекает документы и блоки списков.
+ *  Перед запросом стратегия копируется и получает Prepare со статистикой коллекции и числом плюс-слов запроса */
+//-------------------------------------------------------------------------------------------------------------
+/** TF-IDF: частота слова в документе, умноженная на log(N / df) */
+class TfIdfScorer {
+public:
+    void Prepare(const CorpusStats&, size_t) {
+    }
+
+    double InverseDocumentFreq(const CorpusStats& stats, size_t document_freq) const {
+        return std::log(stats.document_count * 1.0 / document_freq);
+    }
+
+    double Score(double inverse_document_freq, double term_freq, uint8_t) const {
+        return term_freq * inverse_document_freq;
+    }
+
+    double UpperBound(double inverse_document_freq, double max_term_freq, uint8_t) const {
+        return max_term_freq * inverse_document_freq;
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Okapi BM25: idf * tf * (k1 + 1) / (tf + k1 * (1 - b + b * |D| / avgdl)), tf - число вхождений.
+ *  Через частоту f = tf / |D| то же самое - idf * (k1 + 1) * f / (f + norm(|D|)), где
+ *  norm(|D|) = k1 * (1 - b + b * |D| / avgdl) / |D| считается в Prepare для всех 256 сжатых длин,
+ *  поэтому на запись списка приходится одно чтение таблицы и одно деление */
+class Bm25Scorer {
+public:
+    explicit Bm25Scorer(double k1 = 1.2, double b = 0.75);
+
+    void Prepare(const CorpusStats& stats, size_t term_count);
+
+    double InverseDocumentFreq(const CorpusStats& stats, size_t document_freq) const {
+        return std::log(1.0 + (stats.document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    double Score(double inverse_document_freq, double term_freq, uint8_t length_norm) const {
+        return inverse_document_freq * (k1_ + 1.0) * term_freq / (term_freq + length_norms_[length_norm]);
+    }
+
+    /** norm(|D|) убывает с длиной, поэтому граница берется по самому длинному документу */
+    double UpperBound(double inverse_document_freq, double max_term_freq, uint8_t max_length_norm) const {
+        return Score(inverse_document_freq, max_term_freq, max_length_norm);
+    }
+
+private:
+    double k1_;
+    double b_;
+    std::array<double, 256> length_norms_{};
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Адаптер стратегии: вклад слова квантуется в целое число квантов, суммы копятся в 32-битных целых.
+ *  Целая сумма не зависит от порядка сложения, поэтому последовательный и параллельный поиск дают
+ *  побитно одинаковую релевантность. Квант выбирается в Prepare так, чтобы наибольший возможный вклад
+ *  слова занимал (2^32 - 1) / (term_count + 1) квантов: сумма вкладов всех слов запроса и запас
+ *  отсечения не переполняются. Ошибка квантования - полкванта на слово, то есть не больше
+ *  (term_count + 1) / 2^33 от наибольшего вклада слова */
+template <typename Scorer>
+class QuantizedScorer {
+public:
+    explicit QuantizedScorer(Scorer scorer = Scorer{})
+        : scorer_(std::move(scorer)) {
+    }
+
+    void Prepare(const CorpusStats& stats, size_t term_count) {
+        scorer_.Prepare(stats, term_count);
+        // одна лишняя доля бюджета - под запас сравнений с порогом (ToScoreUnits)
+        max_impact_ = std::floor(MAX_SCORE_SUM / (static_cast<double>(term_count) + 1.0));
+        // idf наибольший у слова из одного документа, граница берется по обоим краям сжатых длин
+        const double max_inverse_document_freq = scorer_.InverseDocumentFreq(stats, 1);
+        const double max_score = std::max(scorer_.UpperBound(max_inverse_document_freq, 1.0, 0),
+                                          scorer_.UpperBound(max_inverse_document_freq, 1.0, 255));
+        scale_ = std::isfinite(max_score) && max_score > 0.0 ? max_impact_ / max_score : 1.0;
+    }
+
+    double InverseDocumentFreq(const CorpusStats& stats, size_t document_freq) const {
+        return scorer_.InverseDocumentFreq(stats, document_freq);
+    }
+
+    uint32_t Score(double inverse_document_freq, double term_freq, uint8_t length_norm) const {
+        return Quantize(scorer_.Score(inverse_document_freq, term_freq, length_norm));
+    }
+
+    /** Округление монотонно, поэтому квантованная граница не меньше квантованной оценки */
+    uint32_t UpperBound(double inverse_document_freq, double max_term_freq, uint8_t max_length_norm) const {
+        return Quantize(scorer_.UpperBound(inverse_document_freq, max_term_freq, max_length_norm));
+    }
+
+    double ToRelevance(uint32_t score) const {
+        return score / scale_;
+    }
+
+    /** Число квантов, покрывающее разницу релевантностей relevance, но не больше вклада одного слова */
+    uint32_t ToScoreUnits(double relevance) const {
+        return static_cast<uint32_t>(std::clamp(std::ceil(relevance * scale_), 0.0, max_impact_));
+    }
+
+private:
+    static constexpr double MAX_SCORE_SUM = std::numeric_limits<uint32_t>::max();
+
+    Scorer scorer_;
+    double scale_ = 1.0;
+    double max_impact_ = MAX_SCORE_SUM / 2.0;
+
+    uint32_t Quantize(double score) const {
+        return static_cast<uint32_t>(std::clamp(score * scale_ + 0.5, 0.0, max_impact_));
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Тип оценки стратегии: double или целое число квантов (QuantizedScorer) */
+template <typename Scorer>
+using ScoreType = decltype(std::declval<const Scorer&>().Score(0.0, 0.0, uint8_t{0}));
+//-------------------------------------------------------------------------------------------------------------
+/** Релевантность документа по сумме оценок его слов */
+template <typename Scorer>
+double ScoreToRelevance(const Scorer& scorer, ScoreType<Scorer> score) {
+    if constexpr (std::is_floating_point_v<ScoreType<Scorer>>) {
+        return score;
+    } else {
+        return scorer.ToRelevance(score);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Разница релевантностей relevance в единицах оценки стратегии */
+template <typename Scorer>
+ScoreType<Scorer> RelevanceToScoreUnits(const Scorer& scorer, double relevance) {
+    if constexpr (std::is_floating_point_v<ScoreType<Scorer>>) {
+        return relevance;
+    } else {
+        return scorer.ToScoreUnits(relevance);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,54 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "search_page.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+static const char HEX_DIGITS[] = "0123456789abcdef";
+//-------------------------------------------------------------------------------------------------------------
+static void AppendHex(string& out, uint64_t value, int digit_count) {
+    for (int shift = (digit_count - 1) * 4; shift >= 0; shift -= 4) {
+        out.push_back(HEX_DIGITS[(value >> shift) & 0xF]);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+static uint64_t ParseHex(string_view text) {
+    uint64_t value = 0;
+    for (char c : text) {
+        const char* digit = c == '\0' ? nullptr : strchr(HEX_DIGITS, c);
+        if (digit == nullptr) {
+            throw invalid_argument("malformed search cursor");
+        }
+        value = (value << 4) | static_cast<uint64_t>(digit - HEX_DIGITS);
+    }
+    return value;
+}
+//-------------------------------------------------------------------------------------------------------------
+string EncodeSearchCursor(const SearchCursor& cursor) {
+    uint64_t relevance_bits = 0;
+    memcpy(&relevance_bits, &cursor.relevance, sizeof(relevance_bits));
+    string text;
+    text.reserve(32);
+    AppendHex(text, relevance_bits, 16);
+    AppendHex(text, static_cast<uint32_t>(cursor.rating), 8);
+    AppendHex(text, static_cast<uint32_t>(cursor.document_id), 8);
+    return text;
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchCursor DecodeSearchCursor(string_view text) {
+    if (text.size() != 32) {
+        throw invalid_argument("malformed search cursor");
+    }
+    SearchCursor cursor;
+    const uint64_t relevance_bits = ParseHex(text.substr(0, 16));
+    memcpy(&cursor.relevance, &relevance_bits, sizeof(relevance_bits));
+    cursor.rating = static_cast<int32_t>(ParseHex(text.substr(16, 8)));
+    cursor.document_id = static_cast<int32_t>(ParseHex(text.substr(24, 8)));
+    if (cursor.document_id < 0) {
+        throw invalid_argument("malformed search cursor");
+    }
+    return cursor;
+}
+//-------------------------------------------------------------------------------------------------------------
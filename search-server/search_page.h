@@ -0,0 +1,43 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+//-------------------------------------------------------------------------------------------------------------
+/** Место в ранжированной выдаче: релевантность, рейтинг и id последнего документа предыдущей страницы.
+ *  Следующая страница начинается с документа, ранжированного ниже него */
+struct SearchCursor {
+    double relevance = 0.0;
+    int rating = 0;
+    int document_id = 0;
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Страница выдачи FindTopDocumentsPage. next_cursor есть, если страница заполнена целиком
+ *  и за ней могут быть еще документы. begin/end позволяют передавать страницу в Paginate */
+struct SearchPage {
+    std::vector<Document> documents;
+    std::optional<SearchCursor> next_cursor;
+
+    auto begin() const {
+        return documents.begin();
+    }
+
+    auto end() const {
+        return documents.end();
+    }
+
+    size_t size() const {
+        return documents.size();
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Непрозрачное строковое представление курсора для передачи клиенту (32 шестнадцатеричных символа) */
+std::string EncodeSearchCursor(const SearchCursor& cursor);
+//-------------------------------------------------------------------------------------------------------------
+/** Обратное EncodeSearchCursor, на испорченной строке бросает invalid_argument */
+SearchCursor DecodeSearchCursor(std::string_view text);
+//-------------------------------------------------------------------------------------------------------------
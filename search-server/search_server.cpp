@@ -1,10 +1,49 @@
 ﻿#include <cmath>
 #include <numeric>
+#include <istream>
+#include <ostream>
 
 #include "search_server.h"
 #include "string_processing.h"
+#include "levenshtein_automaton.h"
 
 using namespace std;
+
+/** Формат контрольных точек: сигнатура, версия, поколение, затем записи документов */
+static const uint32_t SNAPSHOT_MAGIC = 0x53535331; // "SSS1"
+static const uint32_t DELTA_MAGIC = 0x53534431;    // "SSD1"
+static const uint32_t CHECKPOINT_FORMAT_VERSION = 4;
+/** Ограничения на длины из файла: испорченное значение не должно приводить к огромным выделениям памяти */
+static const uint32_t MAX_CHECKPOINT_WORD_LENGTH = 1u << 16;
+static const uint64_t MAX_ENCODED_POSITION_BYTES = 5; // varint от uint32_t
+//-------------------------------------------------------------------------------------------------------------
+template <typename T>
+static void WriteValue(ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename T>
+static T ReadValue(istream& in) {
+    T value{};
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+        throw runtime_error("checkpoint is truncated"s);
+    }
+    return value;
+}
+//-------------------------------------------------------------------------------------------------------------
+static void WriteHeader(ostream& out, uint32_t magic, uint64_t generation) {
+    WriteValue(out, magic);
+    WriteValue(out, CHECKPOINT_FORMAT_VERSION);
+    WriteValue(out, generation);
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Проверяет сигнатуру и версию, возвращает поколение */
+static uint64_t ReadHeader(istream& in, uint32_t magic) {
+    if (ReadValue<uint32_t>(in) != magic || ReadValue<uint32_t>(in) != CHECKPOINT_FORMAT_VERSION) {
+        throw runtime_error("unknown checkpoint format"s);
+    }
+    return ReadValue<uint64_t>(in);
+}
 //-------------------------------------------------------------------------------------------------------------
 SearchServer::SearchServer(const string_view stop_words_text)
     : SearchServer(SplitIntoWords(stop_words_text))
@@ -16,34 +55,322 @@ SearchServer::SearchServer(const string& stop_words_text)
 {
 }
 //-------------------------------------------------------------------------------------------------------------
-void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
+SearchServer::SearchServer(const SearchServer& other)
+    : stop_words_(other.stop_words_)
+    , has_positional_index_(other.has_positional_index_)
+    , text_analyzer_(other.text_analyzer_)
+    , max_term_expansions_(other.max_term_expansions_)
+    , fuzzy_max_edits_(other.fuzzy_max_edits_)
+{
+    index_memory_->SetAllocation(other.GetIndexAllocation(), other.index_memory_->GetUpstream());
+    // документы переносятся по возрастанию id, как при загрузке контрольной точки:
+    // списки документов растут с конца, а ключи встают на строки словаря копии
+    for (const auto& [document_id, document_data] : other.documents_) {
+        const DocumentStatus status = other.attributes_.GetStatus(document_data.ordinal);
+        const uint32_t ordinal = attributes_.Add(other.attributes_.GetRating(document_data.ordinal), status);
+        const uint8_t length_norm = EncodeDocumentLength(document_data.length);
+        for (const auto& [word, term_freq] : other.documents_words_freqs_.at(document_id)) {
+            AddWordToIndex(document_id, ordinal, word, term_freq, length_norm, status);
+        }
+        const auto it_positions = other.documents_words_positions_.find(document_id);
+        if (it_positions != other.documents_words_positions_.end()) {
+            for (const auto& [word, encoded_positions] : it_positions->second) {
+                AddPositionsToIndex(document_id, word, encoded_positions.data(), encoded_positions.size());
+            }
+        }
+        documents_.emplace(document_id, DocumentData{ordinal, document_data.length});
+        document_ids_.insert(document_id);
+        total_document_length_ += document_data.length;
+    }
+    SetDuplicatePolicy(other.duplicate_policy_);
+    changed_document_ids_.insert(other.changed_document_ids_.begin(), other.changed_document_ids_.end());
+    removed_document_ids_.insert(other.removed_document_ids_.begin(), other.removed_document_ids_.end());
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchServer& SearchServer::operator=(const SearchServer& other) {
+    if (this != &other) {
+        *this = SearchServer(other);
+    }
+    return *this;
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchServer::SearchServer(SearchServer&& other)
+    : SearchServer(move(other), make_unique<IndexMemoryResource>())
+{
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchServer& SearchServer::operator=(SearchServer&& other) {
+    if (this == &other) {
+        return *this;
+    }
+    // аллокаторы контейнеров не переназначаются, поэтому сервер пересоздается на месте вместе с ресурсом.
+    // Версии растут, чтобы запросы, подготовленные по этому адресу раньше, не приняли новый индекс за свой
+    const uint64_t dictionary_version = max(dictionary_version_, other.dictionary_version_) + 1;
+    const uint64_t index_version = max(index_version_, other.index_version_) + 1;
+    unique_ptr<IndexMemoryResource> other_memory = make_unique<IndexMemoryResource>();
+    this->~SearchServer();
+    new (this) SearchServer(move(other), move(other_memory));
+    dictionary_version_ = dictionary_version;
+    index_version_ = index_version;
+    return *this;
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchServer::SearchServer(SearchServer&& other, unique_ptr<IndexMemoryResource> other_memory)
+    : index_memory_(move(other.index_memory_))
+    , stop_words_(move(other.stop_words_))
+    , words_(move(other.words_))
+    , word_to_document_freqs_(move(other.word_to_document_freqs_))
+    , documents_(move(other.documents_))
+    , attributes_(move(other.attributes_))
+    , document_ids_(move(other.document_ids_))
+    , documents_words_freqs_(move(other.documents_words_freqs_))
+    , total_document_length_(other.total_document_length_)
+    , has_positional_index_(other.has_positional_index_)
+    , text_analyzer_(other.text_analyzer_)
+    , max_term_expansions_(other.max_term_expansions_)
+    , fuzzy_max_edits_(other.fuzzy_max_edits_)
+    , dictionary_version_(other.dictionary_version_)
+    , index_version_(other.index_version_)
+    , duplicate_policy_(other.duplicate_policy_)
+    , fingerprint_documents_(move(other.fingerprint_documents_))
+    , documents_words_positions_(move(other.documents_words_positions_))
+    , changed_document_ids_(move(other.changed_document_ids_))
+    , removed_document_ids_(move(other.removed_document_ids_))
+    , words_heap_bytes_(other.words_heap_bytes_)
+    , words_heap_allocated_bytes_(other.words_heap_allocated_bytes_)
+    , dead_words_heap_allocated_bytes_(other.dead_words_heap_allocated_bytes_)
+    , posting_count_(other.posting_count_)
+    , posting_capacity_bytes_(other.posting_capacity_bytes_)
+    , posting_allocated_bytes_(other.posting_allocated_bytes_)
+    , posting_used_bytes_(other.posting_used_bytes_)
+    , positions_bytes_(other.positions_bytes_)
+    , positions_allocated_bytes_(other.positions_allocated_bytes_)
+    , posting_length_histogram_(other.posting_length_histogram_)
+{
+    // контейнеры исходного сервера пусты, но их аллокаторы указывают на ресурс, перешедший сюда:
+    // исходный сервер получает свой ресурс и контейнеры на нем
+    other.index_memory_ = move(other_memory);
+    other.stop_words_ = StopWordFilter{};
+    other.ResetIndex();
+}
+//-------------------------------------------------------------------------------------------------------------
+int SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status,
                                const std::vector<int>& ratings) {
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("(document_id < 0) || (documents_.count(document_id) > 0)"s);
     }
+    string analyzed_document;
+    document = AnalyzeText(text_analyzer_, document, analyzed_document);
     vector<string_view> words = SplitIntoWordsNoStop(document);
+    int duplicate_id = INVALID_DOCUMENT_ID;
+    Fingerprint128 fingerprint;
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        vector<uint64_t> term_ids(words.size());
+        transform(words.begin(), words.end(), term_ids.begin(), TermId);
+        fingerprint = ComputeTermSetFingerprint(move(term_ids));
+        const auto [first, last] = fingerprint_documents_.equal_range(fingerprint);
+        for (auto it = first; it != last; ++it) {
+            duplicate_id = duplicate_id == INVALID_DOCUMENT_ID ? it->second : min(duplicate_id, it->second);
+        }
+        if (duplicate_id != INVALID_DOCUMENT_ID && duplicate_policy_ == DuplicatePolicy::REJECT) {
+            return duplicate_id;
+        }
+        if (duplicate_id != INVALID_DOCUMENT_ID && duplicate_policy_ == DuplicatePolicy::REPLACE) {
+            vector<int> replaced_ids;
+            for (auto it = first; it != last; ++it) {
+                replaced_ids.push_back(it->second);
+            }
+            RemoveDocuments(move(replaced_ids));
+        }
+        fingerprint_documents_.emplace(fingerprint, document_id);
+    }
     const double inv_word_count = 1.0 / words.size();
+    const uint8_t length_norm = EncodeDocumentLength(words.size());
+    const uint32_t ordinal = attributes_.Add(ComputeAverageRating(ratings), status);
     for (string_view word : words) {
-        auto par = words_.insert(string(word));
-            word_to_document_freqs_[*par.first][document_id] += inv_word_count;
-            documents_words_freqs_[document_id][*par.first] += inv_word_count;
+        AddWordToIndex(document_id, ordinal, word, inv_word_count, length_norm, status);
+    }
+    if (has_positional_index_) {
+        // позиции считаются по всем словам текста, чтобы стоп-слово между словами разрывало фразу
+        map<string_view, vector<uint32_t>> word_positions;
+        uint32_t position = 0;
+        for (string_view word : SplitIntoWords(document)) {
+            if (!IsStopWord(word)) {
+                word_positions[word].push_back(position);
+            }
+            ++position;
+        }
+        for (const auto& [word, positions] : word_positions) {
+            const vector<uint8_t> encoded_positions = EncodePositions(positions);
+            AddPositionsToIndex(document_id, word, encoded_positions.data(), encoded_positions.size());
+        }
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
+    documents_.emplace(document_id, DocumentData{ordinal, static_cast<uint32_t>(words.size())});
     document_ids_.insert(document_id);
+    total_document_length_ += words.size();
+    changed_document_ids_.insert(document_id);
+    return duplicate_id;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::EnablePositionalIndex() {
+    if (!documents_.empty()) {
+        throw logic_error("positional index must be enabled before documents are added"s);
+    }
+    has_positional_index_ = true;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SetDuplicatePolicy(DuplicatePolicy policy) {
+    if (policy == DuplicatePolicy::ALLOW) {
+        fingerprint_documents_.clear();
+    } else if (duplicate_policy_ == DuplicatePolicy::ALLOW) {
+        fingerprint_documents_.reserve(document_ids_.size());
+        for (int document_id : document_ids_) {
+            fingerprint_documents_.emplace(DocumentFingerprint(document_id), document_id);
+        }
+    }
+    duplicate_policy_ = policy;
+}
+//-------------------------------------------------------------------------------------------------------------
+DuplicatePolicy SearchServer::GetDuplicatePolicy() const {
+    return duplicate_policy_;
+}
+//-------------------------------------------------------------------------------------------------------------
+bool SearchServer::HasPositionalIndex() const {
+    return has_positional_index_;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SetTextAnalyzer(TextAnalyzer analyzer) {
+    if (!documents_.empty()) {
+        throw logic_error("text analyzer must be set before documents are added"s);
+    }
+    set<string, less<>> stop_words;
+    for (const string& stop_word : stop_words_) {
+        string buffer;
+        for (string_view word : SplitIntoWords(AnalyzeText(analyzer, stop_word, buffer))) {
+            stop_words.emplace(word);
+        }
+    }
+    stop_words_ = StopWordFilter(stop_words);
+    text_analyzer_ = analyzer;
+    ++dictionary_version_;
+}
+//-------------------------------------------------------------------------------------------------------------
+TextAnalyzer SearchServer::GetTextAnalyzer() const {
+    return text_analyzer_;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SetIndexAllocation(IndexAllocation allocation, std::pmr::memory_resource* upstream) {
+    if (!documents_.empty()) {
+        throw logic_error("index allocation must be set before documents are added"s);
+    }
+    // словарь и списки удаленных документов держат память ресурса, сменить политику можно только без них.
+    // Удаления с последней контрольной точки переносятся через обычную кучу
+    const vector<int> removed_ids(removed_document_ids_.begin(), removed_document_ids_.end());
+    ResetIndex();
+    index_memory_->SetAllocation(allocation, upstream);
+    removed_document_ids_.insert(removed_ids.begin(), removed_ids.end());
+}
+//-------------------------------------------------------------------------------------------------------------
+IndexAllocation SearchServer::GetIndexAllocation() const {
+    return index_memory_->GetAllocation();
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::Clear() {
+    vector<int> removed_ids(removed_document_ids_.begin(), removed_document_ids_.end());
+    removed_ids.insert(removed_ids.end(), document_ids_.begin(), document_ids_.end());
+    if (index_memory_->GetAllocation() == IndexAllocation::MONOTONIC) {
+        // вся память индекса - в блоках арены: они отдаются разом, а контейнеры создаются заново поверх прежних
+        index_memory_->Release();
+        ResetIndex(false);
+    } else {
+        ResetIndex();
+    }
+    removed_document_ids_.insert(removed_ids.begin(), removed_ids.end());
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Пересоздает контейнер пустым на ресурсе resource. Прежние элементы возвращают память своему ресурсу,
+ *  а без destroy_container прежний контейнер не разрушается: его память уже освобождена целиком */
+template <typename Container>
+static void RebuildContainer(Container& container, pmr::memory_resource* resource, bool destroy_container) {
+    if (!destroy_container) {
+        new (&container) Container(resource);
+        return;
+    }
+    Container empty(resource);
+    container.~Container();
+    new (&container) Container(move(empty));
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::ResetIndex(bool destroy_containers) {
+    pmr::memory_resource* const resource = index_memory_.get();
+    // сначала контейнеры со string_view на words_, словарь последним
+    RebuildContainer(removed_document_ids_, resource, destroy_containers);
+    RebuildContainer(changed_document_ids_, resource, destroy_containers);
+    RebuildContainer(documents_words_positions_, resource, destroy_containers);
+    RebuildContainer(fingerprint_documents_, resource, destroy_containers);
+    RebuildContainer(documents_words_freqs_, resource, destroy_containers);
+    RebuildContainer(document_ids_, resource, destroy_containers);
+    RebuildContainer(documents_, resource, destroy_containers);
+    RebuildContainer(word_to_document_freqs_, resource, destroy_containers);
+    RebuildContainer(words_, resource, destroy_containers);
+    RebuildContainer(attributes_, resource, destroy_containers);
+    total_document_length_ = 0;
+    words_heap_bytes_ = 0;
+    words_heap_allocated_bytes_ = 0;
+    dead_words_heap_allocated_bytes_ = 0;
+    posting_count_ = 0;
+    posting_capacity_bytes_ = 0;
+    posting_allocated_bytes_ = 0;
+    posting_used_bytes_ = 0;
+    positions_bytes_ = 0;
+    positions_allocated_bytes_ = 0;
+    posting_length_histogram_.fill(0);
+    // подготовленные запросы ссылаются на прежние списки документов и должны разобраться заново
+    ++dictionary_version_;
+    ++index_version_;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SetMaxTermExpansions(size_t max_term_expansions) {
+    if (max_term_expansions == 0) {
+        throw invalid_argument("max_term_expansions == 0"s);
+    }
+    max_term_expansions_ = max_term_expansions;
+    ++dictionary_version_;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SetFuzzyMaxEdits(int max_edits) {
+    if (max_edits < 0 || max_edits > 2) {
+        throw invalid_argument("fuzzy max edits must be 0, 1 or 2"s);
+    }
+    fuzzy_max_edits_ = max_edits;
+    ++dictionary_version_;
 }
 //-------------------------------------------------------------------------------------------------------------
 std::vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const {
     return FindTopDocuments(std::execution::seq, raw_query, status);
 }
 //-------------------------------------------------------------------------------------------------------------
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const {
+    return FindTopDocuments(std::execution::seq, raw_query, filter);
+}
+//-------------------------------------------------------------------------------------------------------------
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const {
     return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 //-------------------------------------------------------------------------------------------------------------
+QueryExplain SearchServer::ExplainTopDocuments(const std::string_view raw_query) const {
+    return ExplainTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+//-------------------------------------------------------------------------------------------------------------
 int SearchServer::GetDocumentCount() const {
     return static_cast<int>(documents_.size());
 }
 //-------------------------------------------------------------------------------------------------------------
+// итераторы узловых контейнеров не зависят от аллокатора, поэтому pmr-контейнеры индекса
+// отдаются через итераторы обычных std::set и std::map
+static_assert(is_same_v<set<int>::const_iterator, pmr::set<int>::const_iterator>);
+static_assert(is_same_v<map<string_view, double>::const_iterator, pmr::map<string_view, double>::const_iterator>);
+//-------------------------------------------------------------------------------------------------------------
 std::set<int>::const_iterator SearchServer::begin() const {
     return document_ids_.cbegin();
 }
@@ -56,78 +383,182 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const std
     if(!document_ids_.count(document_id)){
         throw out_of_range("id fail");
     }
-    Query query = ParseQuery(raw_query);
-
-    for (string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return {{}, documents_.at(document_id).status};
+    return MatchQuery(ParseQuery(raw_query), document_id);
+}
+//-------------------------------------------------------------------------------------------------------------
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    if(!document_ids_.count(document_id)){
+        throw out_of_range("id fail");
+    }
+    Query reparsed;
+    return MatchQuery(GetPreparedQuery(query, reparsed), document_id);
+}
+//-------------------------------------------------------------------------------------------------------------
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchQuery(const Query& query, int document_id) const {
+    for (const PostingList* postings : query.minus_postings) {
+        if (postings != nullptr && postings->count(document_id)) {
+            return {vector<string_view>{}, GetDocumentStatus(document_id)};
         }
     }
+    if (!query.phrases.empty() && !MatchPhrases(document_id, query)) {
+        return {vector<string_view>{}, GetDocumentStatus(document_id)};
+    }
 
     vector<string_view> matched_words;
-    for (string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        if (query.plus_postings[i] != nullptr && query.plus_postings[i]->count(document_id)) {
+            matched_words.push_back(query.plus_words[i]);
         }
     }
+    if (query.is_conjunctive && matched_words.size() != query.plus_words.size()) {
+        matched_words.clear();
+    }
+    // слова запроса идут в порядке первых вхождений, найденные слова возвращаются по алфавиту
+    sort(matched_words.begin(), matched_words.end());
 
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, GetDocumentStatus(document_id)};
+}
+//-------------------------------------------------------------------------------------------------------------
+vector<DocumentMatch> SearchServer::MatchAllDocuments(const PreparedQuery& prepared) const {
+    Query reparsed;
+    const Query& query = GetPreparedQuery(prepared, reparsed);
+    vector<DocumentMatch> matches;
+    matches.reserve(documents_.size());
+    for (const auto& [document_id, document_data] : documents_) {
+        matches.push_back({document_id, {}, attributes_.GetStatus(document_data.ordinal)});
+    }
+    // списки и matches упорядочены по id: позиция следующего документа ищется от предыдущей
+    const auto for_each_match = [&matches](const PostingList* postings, const auto& action) {
+        if (postings == nullptr) {
+            return;
+        }
+        auto it_match = matches.begin();
+        for (const auto& [document_id, _] : *postings) {
+            it_match = lower_bound(it_match, matches.end(), document_id, [](const DocumentMatch& match, int id) {
+                return match.id < id;
+            });
+            action(*it_match);
+        }
+    };
+    vector<bool> is_excluded(matches.size(), false);
+    for (const PostingList* postings : query.minus_postings) {
+        for_each_match(postings, [&](const DocumentMatch& match) {
+            is_excluded[&match - matches.data()] = true;
+        });
+    }
+    // слова добавляются по алфавиту, как их возвращает MatchDocument
+    vector<size_t> word_order(query.plus_words.size());
+    iota(word_order.begin(), word_order.end(), 0);
+    sort(word_order.begin(), word_order.end(), [&query](size_t lhs, size_t rhs) {
+        return query.plus_words[lhs] < query.plus_words[rhs];
+    });
+    for (size_t i : word_order) {
+        for_each_match(query.plus_postings[i], [&](DocumentMatch& match) {
+            if (!is_excluded[&match - matches.data()]) {
+                match.words.push_back(query.plus_words[i]);
+            }
+        });
+    }
+    for (DocumentMatch& match : matches) {
+        if (query.is_conjunctive && match.words.size() != query.plus_words.size()) {
+            match.words.clear();
+        }
+        if (!query.phrases.empty() && !match.words.empty() && !MatchPhrases(match.id, query)) {
+            match.words.clear();
+        }
+    }
+    return matches;
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchServer::PreparedQuery SearchServer::PrepareQuery(std::string_view raw_query, QueryMode mode) const {
+    PreparedQuery prepared;
+    prepared.text_ = make_unique<const string>(raw_query);
+    prepared.query_ = ParseQuery(*prepared.text_, true, mode);
+    prepared.server_ = this;
+    prepared.dictionary_version_ = dictionary_version_;
+    prepared.index_version_ = index_version_;
+    return prepared;
+}
+//-------------------------------------------------------------------------------------------------------------
+const SearchServer::Query& SearchServer::GetPreparedQuery(const PreparedQuery& prepared, Query& reparsed) const {
+    if (prepared.server_ != this || !prepared.text_) {
+        throw invalid_argument("query is prepared by another server"s);
+    }
+    if (prepared.dictionary_version_ == dictionary_version_
+        && (!prepared.query_.has_expansions || prepared.index_version_ == index_version_)) {
+        return prepared.query_;
+    }
+    reparsed = ParseQuery(*prepared.text_, true, prepared.query_.is_conjunctive ? QueryMode::ALL : QueryMode::ANY);
+    return reparsed;
+}
+//-------------------------------------------------------------------------------------------------------------
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+    return FindTopDocuments(std::execution::seq, query);
+}
+//-------------------------------------------------------------------------------------------------------------
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, QueryMode mode) const {
+    return FindTopDocumentsForQuery(std::execution::seq, ParseQuery(raw_query, true, mode), DocumentStatusPredicate{DocumentStatus::ACTUAL},
+                                    TfIdfScorer{});
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view raw_query, size_t offset, size_t limit) const {
+    return FindTopDocumentsPage(std::execution::seq, raw_query, DocumentStatus::ACTUAL, offset, limit);
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchPage SearchServer::FindTopDocumentsPage(const std::string_view raw_query, const SearchCursor& after, size_t limit) const {
+    return FindTopDocumentsPage(std::execution::seq, raw_query, DocumentStatus::ACTUAL, after, limit);
+}
+//-------------------------------------------------------------------------------------------------------------
+SearchPage SearchServer::MakeSearchPage(std::vector<Document> documents, size_t limit) {
+    SearchPage page;
+    if (documents.size() == limit) {
+        const Document& last = documents.back();
+        page.next_cursor = SearchCursor{last.relevance, last.rating, last.id};
+    }
+    page.documents = move(documents);
+    return page;
 }
 //-------------------------------------------------------------------------------------------------------------
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::parallel_policy, const std::string_view raw_query, int document_id) const {
     if(!document_ids_.count(document_id)){
         throw std::out_of_range("id fail");
     }
+    // списки документов слов уже найдены при разборе запроса, как в MatchQuery
     Query query = ParseQuery(raw_query, false);
     bool is_was_minus = any_of( execution::par,
-                                query.minus_words.begin(), query.minus_words.end(),
-                                [this, document_id](const std::string_view& word){
-        if (word_to_document_freqs_.count(word) != 0) {
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                return true;
-            }
-        }
-        return false;
+                                query.minus_postings.begin(), query.minus_postings.end(),
+                                [document_id](const PostingList* postings){
+        return postings != nullptr && postings->count(document_id);
     } );
 
-    if(is_was_minus){
-        return {{}, documents_.at(document_id).status};
+    if(is_was_minus || (!query.phrases.empty() && !MatchPhrases(document_id, query))){
+        return {vector<string_view>{}, GetDocumentStatus(document_id)};
     }
+    // не найденное слово становится пустой строкой и отбрасывается
     std::vector<std::string_view> matched_words(query.plus_words.size());
-    std::vector<std::string_view>::iterator it_last_elem = std::copy_if(
-                 execution::par,
-                 query.plus_words.begin(), query.plus_words.end(),
-                 matched_words.begin(),
-                 [this, document_id](const std::string_view& word){
-        if (word_to_document_freqs_.count(word) != 0) {
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                return true;
-            }
-        }
-        return false;
+    std::transform(execution::par,
+                   query.plus_words.begin(), query.plus_words.end(), query.plus_postings.begin(),
+                   matched_words.begin(),
+                   [document_id](std::string_view word, const PostingList* postings){
+        return postings != nullptr && postings->count(document_id) ? word : std::string_view{};
     });
-    matched_words.erase(it_last_elem, matched_words.end());
+    matched_words.erase(remove(matched_words.begin(), matched_words.end(), std::string_view{}), matched_words.end());
     DelCopyElemVec(matched_words);
-    return {matched_words, documents_.at(document_id).status};
+    sort(matched_words.begin(), matched_words.end());
+    return {matched_words, GetDocumentStatus(document_id)};
 }
 //-------------------------------------------------------------------------------------------------------------
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(execution::sequenced_policy, const string_view raw_query, int document_id) const {
     return MatchDocument(raw_query, document_id);
 }
 //-------------------------------------------------------------------------------------------------------------
-const std::map<string_view, double> &SearchServer::GetWordFrequencies(int document_id) const
+WordFrequenciesView SearchServer::GetWordFrequencies(int document_id) const
 {
     if(!documents_words_freqs_.count(document_id)){ //документа с таким id нет
-        static std::map<std::string_view, double> empty;
-        return empty;
+        static const std::pmr::map<std::string_view, double> empty;
+        return WordFrequenciesView(empty);
     }
-    return documents_words_freqs_.at(document_id);
+    return WordFrequenciesView(documents_words_freqs_.at(document_id));
 }
 //-------------------------------------------------------------------------------------------------------------
 void SearchServer::RemoveDocument(int document_id)
@@ -136,15 +567,416 @@ void SearchServer::RemoveDocument(int document_id)
         return;
     }
     for(const auto& [word, _] : documents_words_freqs_.at(document_id)){
-        word_to_document_freqs_.at(word).erase(document_id);
+        auto& postings = word_to_document_freqs_.at(word);
+        postings.erase(document_id);
+        UpdatePostingLength(word, postings.size() + 1, postings.size());
     }
+    posting_count_ -= documents_words_freqs_.at(document_id).size();
+    total_document_length_ -= documents_.at(document_id).length;
+    attributes_.Remove(documents_.at(document_id).ordinal);
+    RemovePositionsFromIndex(document_id);
+    RemoveFingerprintFromIndex(document_id);
     documents_words_freqs_.erase(document_id);
     documents_.erase(document_id);
     document_ids_.erase(document_id);
+    changed_document_ids_.erase(document_id);
+    removed_document_ids_.insert(document_id);
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::RemoveDocuments(std::vector<int> document_ids)
+{
+    sort(document_ids.begin(), document_ids.end());
+    document_ids.erase(unique(document_ids.begin(), document_ids.end()), document_ids.end());
+    document_ids.erase(remove_if(document_ids.begin(), document_ids.end(),
+                                 [this](int document_id){ return !document_ids_.count(document_id); }),
+                       document_ids.end());
+    // id перебираются по возрастанию, поэтому списки удаляемых документов каждого слова уже упорядочены
+    map<string_view, vector<int>> word_documents;
+    for(int document_id : document_ids){
+        for(const auto& [word, _] : documents_words_freqs_.at(document_id)){
+            word_documents[word].push_back(document_id);
+        }
+        posting_count_ -= documents_words_freqs_.at(document_id).size();
+    }
+    for(const auto& [word, removed_ids] : word_documents){
+        auto& postings = word_to_document_freqs_.at(word);
+        const size_t old_length = postings.size();
+        postings.EraseDocuments(removed_ids);
+        UpdatePostingLength(word, old_length, postings.size());
+    }
+    for(int document_id : document_ids){
+        total_document_length_ -= documents_.at(document_id).length;
+        attributes_.Remove(documents_.at(document_id).ordinal);
+        RemovePositionsFromIndex(document_id);
+        RemoveFingerprintFromIndex(document_id);
+        documents_words_freqs_.erase(document_id);
+        documents_.erase(document_id);
+        document_ids_.erase(document_id);
+        changed_document_ids_.erase(document_id);
+        removed_document_ids_.insert(document_id);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SetDocumentStatus(int document_id, DocumentStatus status)
+{
+    const auto it_document = documents_.find(document_id);
+    if (it_document == documents_.end()) {
+        throw out_of_range("id fail");
+    }
+    if (attributes_.GetStatus(it_document->second.ordinal) == status) {
+        return;
+    }
+    attributes_.SetStatus(it_document->second.ordinal, status);
+    for (const auto& [word, _] : documents_words_freqs_.at(document_id)) {
+        word_to_document_freqs_.at(word).SetStatus(document_id, status);
+    }
+    changed_document_ids_.insert(document_id);
+}
+//-------------------------------------------------------------------------------------------------------------
+IndexMemoryStats SearchServer::MemoryStats() const
+{
+    using WordFreqs = std::pmr::map<std::string_view, double>;
+    constexpr size_t word_node = TreeNodeBytes<std::pmr::string>();
+    constexpr size_t term_node = TreeNodeBytes<std::pair<const std::string_view, PostingList>>();
+    constexpr size_t document_words_node = TreeNodeBytes<std::pair<const int, WordFreqs>>();
+    constexpr size_t word_freq_node = TreeNodeBytes<WordFreqs::value_type>();
+    constexpr size_t document_node = TreeNodeBytes<std::pair<const int, DocumentData>>();
+    constexpr size_t document_id_node = TreeNodeBytes<int>();
+
+    IndexMemoryStats stats;
+    stats.words.element_count = words_.size();
+    stats.words.payload_bytes = words_.size() * word_node + words_heap_bytes_;
+    stats.words.allocated_bytes = words_.size() * MallocChunkBytes(word_node) + words_heap_allocated_bytes_;
+
+    const size_t term_count = word_to_document_freqs_.size();
+    stats.word_to_document_freqs.element_count = term_count + posting_count_;
+    stats.word_to_document_freqs.payload_bytes = term_count * term_node + posting_capacity_bytes_;
+    stats.word_to_document_freqs.allocated_bytes = term_count * MallocChunkBytes(term_node) + posting_allocated_bytes_;
+
+    const size_t document_count = documents_words_freqs_.size();
+    stats.documents_words_freqs.element_count = document_count + posting_count_;
+    stats.documents_words_freqs.payload_bytes = document_count * document_words_node + posting_count_ * word_freq_node;
+    stats.documents_words_freqs.allocated_bytes = document_count * MallocChunkBytes(document_words_node)
+                                                  + posting_count_ * MallocChunkBytes(word_freq_node);
+
+    using WordPositions = std::pmr::map<std::string_view, std::pmr::vector<uint8_t>>;
+    constexpr size_t document_positions_node = TreeNodeBytes<std::pair<const int, WordPositions>>();
+    constexpr size_t word_positions_node = TreeNodeBytes<WordPositions::value_type>();
+    if (has_positional_index_) {
+        const size_t positions_document_count = documents_words_positions_.size();
+        stats.positions.element_count = positions_document_count + posting_count_;
+        stats.positions.payload_bytes = positions_document_count * document_positions_node
+                                        + posting_count_ * word_positions_node + positions_bytes_;
+        stats.positions.allocated_bytes = positions_document_count * MallocChunkBytes(document_positions_node)
+                                          + posting_count_ * MallocChunkBytes(word_positions_node) + positions_allocated_bytes_;
+    }
+
+    // узел хеш-таблицы отпечатков: указатель на следующий узел и пара (отпечаток, id)
+    constexpr size_t fingerprint_node = sizeof(void*) + sizeof(std::pair<const Fingerprint128, int>);
+    const size_t fingerprint_buckets = fingerprint_documents_.empty() ? 0 : fingerprint_documents_.bucket_count() * sizeof(void*);
+    stats.documents.element_count = documents_.size() + fingerprint_documents_.size();
+    stats.documents.payload_bytes = documents_.size() * document_node + attributes_.PayloadBytes()
+                                    + fingerprint_documents_.size() * fingerprint_node + fingerprint_buckets;
+    stats.documents.allocated_bytes = documents_.size() * MallocChunkBytes(document_node) + attributes_.AllocatedBytes()
+                                      + fingerprint_documents_.size() * MallocChunkBytes(fingerprint_node)
+                                      + (fingerprint_buckets == 0 ? 0 : MallocChunkBytes(fingerprint_buckets));
+
+    stats.document_ids.element_count = document_ids_.size();
+    stats.document_ids.payload_bytes = document_ids_.size() * document_id_node;
+    stats.document_ids.allocated_bytes = document_ids_.size() * MallocChunkBytes(document_id_node);
+
+    stats.term_count = term_count;
+    stats.posting_count = posting_count_;
+    stats.posting_length_histogram = posting_length_histogram_;
+    stats.dead_term_count = posting_length_histogram_[0];
+    stats.dead_bytes = stats.dead_term_count * (MallocChunkBytes(word_node) + MallocChunkBytes(term_node))
+                       + dead_words_heap_allocated_bytes_;
+    stats.posting_slack_bytes = posting_capacity_bytes_ - posting_used_bytes_;
+    stats.allocation = index_memory_->Stats();
+    return stats;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::UpdatePostingLength(std::string_view word, size_t old_length, size_t new_length)
+{
+    ++index_version_;
+    --posting_length_histogram_[PostingLengthBucket(old_length)];
+    ++posting_length_histogram_[PostingLengthBucket(new_length)];
+    posting_used_bytes_ += PostingList::UsedBytes(new_length);
+    posting_used_bytes_ -= PostingList::UsedBytes(old_length);
+    const size_t heap_bytes = StringHeapBytes(word.size());
+    if (heap_bytes == 0) {
+        return;
+    }
+    if (old_length == 0) {
+        dead_words_heap_allocated_bytes_ -= MallocChunkBytes(heap_bytes);
+    } else if (new_length == 0) {
+        dead_words_heap_allocated_bytes_ += MallocChunkBytes(heap_bytes);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::AddWordToIndex(int document_id, uint32_t ordinal, std::string_view word, double term_freq, uint8_t length_norm,
+                                  DocumentStatus status)
+{
+    auto par = words_.emplace(word);
+    if (par.second) {
+        const size_t heap_bytes = StringHeapBytes(word.size());
+        words_heap_bytes_ += heap_bytes;
+        if (heap_bytes > 0) {
+            words_heap_allocated_bytes_ += MallocChunkBytes(heap_bytes);
+            dead_words_heap_allocated_bytes_ += MallocChunkBytes(heap_bytes);
+        }
+        ++posting_length_histogram_[0];
+        ++dictionary_version_;
+    }
+    auto& postings = word_to_document_freqs_[*par.first];
+    posting_capacity_bytes_ -= postings.CapacityBytes();
+    posting_allocated_bytes_ -= postings.AllocatedBytes();
+    if (postings.Add(document_id, ordinal, term_freq, length_norm, status)) {
+        UpdatePostingLength(*par.first, postings.size() - 1, postings.size());
+        ++posting_count_;
+    }
+    posting_capacity_bytes_ += postings.CapacityBytes();
+    posting_allocated_bytes_ += postings.AllocatedBytes();
+    documents_words_freqs_[document_id][*par.first] += term_freq;
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::AddPositionsToIndex(int document_id, std::string_view word, const uint8_t* encoded_positions, size_t size)
+{
+    // ключ - string_view на строку из words_, а не на текст документа
+    pmr::vector<uint8_t>& stored = documents_words_positions_[document_id][word_to_document_freqs_.find(word)->first];
+    stored.assign(encoded_positions, encoded_positions + size);
+    positions_bytes_ += stored.capacity();
+    positions_allocated_bytes_ += stored.empty() ? 0 : MallocChunkBytes(stored.capacity());
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::RemovePositionsFromIndex(int document_id)
+{
+    const auto it = documents_words_positions_.find(document_id);
+    if (it == documents_words_positions_.end()) {
+        return;
+    }
+    for (const auto& [_, encoded_positions] : it->second) {
+        positions_bytes_ -= encoded_positions.capacity();
+        positions_allocated_bytes_ -= encoded_positions.empty() ? 0 : MallocChunkBytes(encoded_positions.capacity());
+    }
+    documents_words_positions_.erase(it);
+}
+//-------------------------------------------------------------------------------------------------------------
+Fingerprint128 SearchServer::DocumentFingerprint(int document_id) const
+{
+    vector<uint64_t> term_ids;
+    for (const auto& word_freq : documents_words_freqs_.at(document_id)) {
+        term_ids.push_back(TermId(word_freq.first));
+    }
+    return ComputeTermSetFingerprint(move(term_ids));
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::RemoveFingerprintFromIndex(int document_id)
+{
+    if (duplicate_policy_ == DuplicatePolicy::ALLOW) {
+        return;
+    }
+    const auto [first, last] = fingerprint_documents_.equal_range(DocumentFingerprint(document_id));
+    for (auto it = first; it != last; ++it) {
+        if (it->second == document_id) {
+            fingerprint_documents_.erase(it);
+            return;
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SaveSnapshot(ostream& out, uint64_t generation) const
+{
+    WriteHeader(out, SNAPSHOT_MAGIC, generation);
+    WriteValue(out, static_cast<uint64_t>(document_ids_.size()));
+    for (int document_id : document_ids_) {
+        WriteDocument(out, document_id);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::SaveDelta(ostream& out, uint64_t generation) const
+{
+    WriteHeader(out, DELTA_MAGIC, generation);
+    WriteValue(out, static_cast<uint64_t>(removed_document_ids_.size()));
+    for (int document_id : removed_document_ids_) {
+        WriteValue(out, document_id);
+    }
+    WriteValue(out, static_cast<uint64_t>(changed_document_ids_.size()));
+    for (int document_id : changed_document_ids_) {
+        WriteDocument(out, document_id);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t SearchServer::LoadSnapshot(istream& in)
+{
+    if (!documents_.empty()) {
+        throw logic_error("snapshot can be loaded only into an empty server"s);
+    }
+    const uint64_t generation = ReadHeader(in, SNAPSHOT_MAGIC);
+    for (uint64_t count = ReadValue<uint64_t>(in); count > 0; --count) {
+        ReadDocument(in);
+    }
+    ResetChangeTracking();
+    return generation;
+}
+//-------------------------------------------------------------------------------------------------------------
+bool SearchServer::ApplyDelta(istream& in, uint64_t generation)
+{
+    if (ReadHeader(in, DELTA_MAGIC) != generation) {
+        return false;
+    }
+    for (uint64_t count = ReadValue<uint64_t>(in); count > 0; --count) {
+        RemoveDocument(ReadValue<int>(in));
+    }
+    for (uint64_t count = ReadValue<uint64_t>(in); count > 0; --count) {
+        ReadDocument(in);
+    }
+    ResetChangeTracking();
+    return true;
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t SearchServer::ReadSnapshotGeneration(istream& in)
+{
+    return ReadHeader(in, SNAPSHOT_MAGIC);
+}
+//-------------------------------------------------------------------------------------------------------------
+bool SearchServer::HasChanges() const
+{
+    return !changed_document_ids_.empty() || !removed_document_ids_.empty();
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::ResetChangeTracking()
+{
+    changed_document_ids_.clear();
+    removed_document_ids_.clear();
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::WriteDocument(ostream& out, int document_id) const
+{
+    const DocumentData& document_data = documents_.at(document_id);
+    WriteValue(out, document_id);
+    WriteValue(out, static_cast<int32_t>(attributes_.GetStatus(document_data.ordinal)));
+    WriteValue(out, static_cast<int>(attributes_.GetRating(document_data.ordinal)));
+    WriteValue(out, document_data.length);
+    const auto& word_freqs = GetWordFrequencies(document_id);
+    const auto it_positions = documents_words_positions_.find(document_id);
+    WriteValue(out, static_cast<uint32_t>(word_freqs.size()));
+    for (const auto& [word, term_freq] : word_freqs) {
+        WriteValue(out, static_cast<uint32_t>(word.size()));
+        out.write(word.data(), word.size());
+        WriteValue(out, term_freq);
+        // позиции пишутся, только если у сервера есть позиционный индекс, иначе длина 0
+        const pmr::vector<uint8_t>* encoded_positions = nullptr;
+        if (it_positions != documents_words_positions_.end()) {
+            encoded_positions = &it_positions->second.at(word);
+        }
+        WriteValue(out, static_cast<uint32_t>(encoded_positions ? encoded_positions->size() : 0));
+        if (encoded_positions) {
+            out.write(reinterpret_cast<const char*>(encoded_positions->data()), encoded_positions->size());
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Число позиций в сжатом блоке из контрольной точки. Блок должен раскодироваться без ошибок,
+ *  а позиции - строго возрастать, иначе runtime_error */
+static size_t CountCheckpointPositions(const vector<uint8_t>& encoded_positions) {
+    vector<uint32_t> positions;
+    try {
+        positions = DecodePositions(encoded_positions);
+    } catch (const invalid_argument&) {
+        throw runtime_error("checkpoint contains malformed positions"s);
+    }
+    if (adjacent_find(positions.begin(), positions.end(), greater_equal<uint32_t>()) != positions.end()) {
+        throw runtime_error("checkpoint positions are not increasing"s);
+    }
+    return positions.size();
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::ReadDocument(istream& in)
+{
+    // запись сначала читается и проверяется целиком, индекс меняется только после этого:
+    // на поврежденном или обрезанном файле сервер остается в прежнем состоянии
+    struct WordRecord {
+        string word;
+        double term_freq;
+        vector<uint8_t> encoded_positions;
+    };
+    const int document_id = ReadValue<int>(in);
+    const int32_t raw_status = ReadValue<int32_t>(in);
+    const int rating = ReadValue<int>(in);
+    const uint32_t length = ReadValue<uint32_t>(in);
+    if (document_id < 0) {
+        throw runtime_error("checkpoint contains negative document id"s);
+    }
+    if (raw_status < static_cast<int32_t>(DocumentStatus::ACTUAL) || raw_status > static_cast<int32_t>(DocumentStatus::REMOVED)) {
+        throw runtime_error("checkpoint contains unknown document status"s);
+    }
+    // различных слов не больше, чем слов в документе
+    const uint32_t word_count = ReadValue<uint32_t>(in);
+    if (word_count > length) {
+        throw runtime_error("checkpoint word count exceeds document length"s);
+    }
+    vector<WordRecord> records;
+    uint64_t position_count = 0;
+    for (uint32_t i = 0; i < word_count; ++i) {
+        WordRecord record;
+        const uint32_t word_length = ReadValue<uint32_t>(in);
+        if (word_length == 0 || word_length > MAX_CHECKPOINT_WORD_LENGTH) {
+            throw runtime_error("checkpoint contains invalid word length"s);
+        }
+        record.word.resize(word_length);
+        if (!in.read(record.word.data(), record.word.size())) {
+            throw runtime_error("checkpoint is truncated"s);
+        }
+        // WriteDocument пишет слова по возрастанию, повтор или нарушение порядка - признак порчи
+        if (!records.empty() && records.back().word >= record.word) {
+            throw runtime_error("checkpoint words are not sorted"s);
+        }
+        record.term_freq = ReadValue<double>(in);
+        if (!isfinite(record.term_freq) || record.term_freq <= 0.0) {
+            throw runtime_error("checkpoint contains invalid term frequency"s);
+        }
+        // на позицию уходит не больше MAX_ENCODED_POSITION_BYTES байт, позиций не больше длины документа
+        const uint32_t positions_size = ReadValue<uint32_t>(in);
+        if (positions_size > uint64_t{length} * MAX_ENCODED_POSITION_BYTES) {
+            throw runtime_error("checkpoint contains invalid positions size"s);
+        }
+        if (has_positional_index_ && positions_size == 0) {
+            throw runtime_error("checkpoint has no positions for positional index"s);
+        }
+        record.encoded_positions.resize(positions_size);
+        if (!in.read(reinterpret_cast<char*>(record.encoded_positions.data()), positions_size)) {
+            throw runtime_error("checkpoint is truncated"s);
+        }
+        position_count += CountCheckpointPositions(record.encoded_positions);
+        // вхождений всех слов не больше длины документа. Сами позиции считаются и по стоп-словам,
+        // поэтому длиной документа они не ограничены
+        if (position_count > length) {
+            throw runtime_error("checkpoint contains more positions than document words"s);
+        }
+        records.push_back(move(record));
+    }
+
+    const auto status = static_cast<DocumentStatus>(raw_status);
+    const uint8_t length_norm = EncodeDocumentLength(length);
+    RemoveDocument(document_id);
+    const uint32_t ordinal = attributes_.Add(rating, status);
+    for (WordRecord& record : records) {
+        AddWordToIndex(document_id, ordinal, record.word, record.term_freq, length_norm, status);
+        if (has_positional_index_) {
+            AddPositionsToIndex(document_id, record.word, record.encoded_positions.data(), record.encoded_positions.size());
+        }
+    }
+    documents_.emplace(document_id, DocumentData{ordinal, length});
+    document_ids_.insert(document_id);
+    total_document_length_ += length;
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        fingerprint_documents_.emplace(DocumentFingerprint(document_id), document_id);
+    }
 }
 //-------------------------------------------------------------------------------------------------------------
 bool SearchServer::IsStopWord(string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_.Contains(word);
 }
 //-------------------------------------------------------------------------------------------------------------
 bool SearchServer::IsValidWord(string_view word) {
@@ -189,33 +1021,260 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
     return QueryWord{text, is_minus, IsStopWord(text)};
 }
 //-------------------------------------------------------------------------------------------------------------
-SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool is_del_copy) const {
+SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool is_del_copy, QueryMode mode) const {
+    PROFILE_QUERY_PHASE(QueryPhase::PARSE);
     Query result = {};
-    vector <string_view> vec_uniq(SplitIntoWords(text));
+    result.is_conjunctive = mode == QueryMode::ALL;
+    string analyzed_text;
+    if (const string_view analyzed = AnalyzeText(text_analyzer_, text, analyzed_text); analyzed.data() != text.data()) {
+        result.analyzed_text = make_shared<const string>(move(analyzed_text));
+        text = *result.analyzed_text;
+    }
+    vector <string_view> vec_uniq;
+    // фразы в кавычках разбираются отдельно, остальной текст - как обычные слова
+    while (true) {
+        const size_t quote = text.find('"');
+        for (string_view word : SplitIntoWords(text.substr(0, quote))) {
+            vec_uniq.push_back(word);
+        }
+        if (quote == text.npos) {
+            break;
+        }
+        const size_t closing_quote = text.find('"', quote + 1);
+        if (closing_quote == text.npos) {
+            throw invalid_argument("unpaired quote in query");
+        }
+        ParsePhrase(text.substr(quote + 1, closing_quote - quote - 1), result);
+        text.remove_prefix(closing_quote + 1);
+    }
     if(is_del_copy){
         DelCopyElemVec(vec_uniq);
     }
+    bool has_expansions = false;
+    map<string_view, double> fuzzy_weights;
     for (string_view word : vec_uniq) {
         QueryWord query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+            vector<string_view>& words = query_word.is_minus ? result.minus_words : result.plus_words;
+            if (IsWildcardPattern(query_word.data)) {
+                if (result.is_conjunctive) {
+                    throw invalid_argument("wildcard in conjunctive query"s);
+                }
+                ExpandWildcard(query_word.data, words);
+                has_expansions = true;
+            } else if (fuzzy_max_edits_ > 0 && !query_word.is_minus && !result.is_conjunctive) {
+                ExpandFuzzy(query_word.data, fuzzy_weights);
             } else {
-                result.plus_words.push_back(query_word.data);
+                words.push_back(query_word.data);
             }
         }
     }
+    if (!fuzzy_weights.empty()) {
+        // слова, попавшие в запрос точно (фразы, шаблоны), сохраняют вес 1
+        const size_t exact_word_count = result.plus_words.size();
+        for (const auto& [word, weight] : fuzzy_weights) {
+            result.plus_words.push_back(word);
+            if (weight < 1.0) {
+                result.word_weights.emplace(word, weight);
+            }
+        }
+        for (size_t i = 0; i < exact_word_count; ++i) {
+            result.word_weights.erase(result.plus_words[i]);
+        }
+        has_expansions = true;
+    }
+    if (is_del_copy && (has_expansions || !result.phrases.empty())) {
+        DelCopyElemVec(result.plus_words);
+        DelCopyElemVec(result.minus_words);
+    }
+    result.has_expansions = has_expansions;
+    ResolveQuery(result);
     return result;
 }
 //-------------------------------------------------------------------------------------------------------------
+void SearchServer::ResolveQuery(Query& query) const {
+    // найденное слово заменяется строкой словаря: слова, которые вернет MatchDocument, не зависят от текста запроса
+    const auto find_postings = [this](string_view& word) -> const PostingList* {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end()) {
+            return nullptr;
+        }
+        word = it->first;
+        return &it->second;
+    };
+    query.plus_postings.resize(query.plus_words.size());
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        query.plus_postings[i] = find_postings(query.plus_words[i]);
+    }
+    query.minus_postings.resize(query.minus_words.size());
+    for (size_t i = 0; i < query.minus_words.size(); ++i) {
+        query.minus_postings[i] = find_postings(query.minus_words[i]);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::ParsePhrase(std::string_view text, Query& query) const {
+    vector<PhraseWord> phrase;
+    uint32_t offset = 0;
+    for (string_view word : SplitIntoWords(text)) {
+        QueryWord query_word = ParseQueryWord(word);
+        if (query_word.is_minus || IsWildcardPattern(query_word.data)) {
+            throw invalid_argument("minus word or wildcard inside phrase");
+        }
+        if (!query_word.is_stop) {
+            phrase.push_back({query_word.data, offset});
+            query.plus_words.push_back(query_word.data);
+        }
+        ++offset;
+    }
+    if (phrase.size() > 1 && !has_positional_index_) {
+        throw invalid_argument("phrase query requires positional index");
+    }
+    if (!phrase.empty()) {
+        query.phrases.push_back(move(phrase));
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::ExpandWildcard(std::string_view pattern, std::vector<std::string_view>& words) const {
+    const string_view prefix = pattern.substr(0, pattern.find_first_of("*?"sv));
+    const string_view rest = pattern.substr(prefix.size());
+    // шаблон вида prefix* подходит под весь диапазон, остальные проверяются по остатку
+    const bool is_prefix_only = rest == "*"sv;
+    vector<pair<size_t, string_view>> expansions;
+    for (auto it = word_to_document_freqs_.lower_bound(prefix);
+         it != word_to_document_freqs_.end() && it->first.substr(0, prefix.size()) == prefix; ++it) {
+        if (it->second.empty()) {
+            continue;
+        }
+        if (is_prefix_only || MatchWildcard(rest, it->first.substr(prefix.size()))) {
+            expansions.push_back({it->second.size(), it->first});
+        }
+    }
+    if (expansions.size() > max_term_expansions_) {
+        nth_element(expansions.begin(), expansions.begin() + max_term_expansions_, expansions.end(),
+                    [](const auto& lhs, const auto& rhs) {
+                        return lhs.first > rhs.first;
+                    });
+        expansions.resize(max_term_expansions_);
+    }
+    for (const auto& [_, word] : expansions) {
+        words.push_back(word);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void SearchServer::ExpandFuzzy(std::string_view word, std::map<std::string_view, double>& weights) const {
+    const LevenshteinAutomaton automaton(word, fuzzy_max_edits_);
+    // states[i] - состояние после первых i байт prefix
+    vector<LevenshteinAutomaton::State> states{automaton.Start()};
+    string prefix;
+    vector<tuple<int, size_t, string_view>> expansions;
+    auto it = word_to_document_freqs_.begin();
+    while (it != word_to_document_freqs_.end()) {
+        const string_view term = it->first;
+        size_t common = 0;
+        while (common < prefix.size() && common < term.size() && prefix[common] == term[common]) {
+            ++common;
+        }
+        prefix.resize(common);
+        states.resize(common + 1);
+        bool is_dead = false;
+        while (prefix.size() < term.size()) {
+            prefix.push_back(term[prefix.size()]);
+            states.push_back(automaton.StepByte(states.back(), prefix));
+            if (!automaton.CanMatch(states.back())) {
+                is_dead = true;
+                break;
+            }
+        }
+        if (is_dead) {
+            const string next = automaton.NextCandidate(prefix, states);
+            if (next.empty()) {
+                break;
+            }
+            it = word_to_document_freqs_.lower_bound(next);
+            continue;
+        }
+        if (!it->second.empty() && automaton.IsMatch(states.back())) {
+            expansions.push_back({automaton.Distance(states.back()), it->second.size(), term});
+        }
+        ++it;
+    }
+    // при превышении лимита остаются ближайшие слова, среди равных - самые частые
+    if (expansions.size() > max_term_expansions_) {
+        nth_element(expansions.begin(), expansions.begin() + max_term_expansions_, expansions.end(),
+                    [](const auto& lhs, const auto& rhs) {
+                        return get<0>(lhs) != get<0>(rhs) ? get<0>(lhs) < get<0>(rhs) : get<1>(lhs) > get<1>(rhs);
+                    });
+        expansions.resize(max_term_expansions_);
+    }
+    for (const auto& [distance, _, term] : expansions) {
+        const double weight = pow(FUZZY_EDIT_PENALTY, distance);
+        auto [it_weight, is_inserted] = weights.emplace(term, weight);
+        if (!is_inserted) {
+            it_weight->second = max(it_weight->second, weight);
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+bool SearchServer::MatchPhrases(int document_id, const Query& query) const {
+    for (const vector<PhraseWord>& phrase : query.phrases) {
+        if (phrase.size() == 1) {
+            const auto it_word = word_to_document_freqs_.find(phrase[0].data);
+            if (it_word == word_to_document_freqs_.end() || !it_word->second.count(document_id)) {
+                return false;
+            }
+            continue;
+        }
+        const auto it_document = documents_words_positions_.find(document_id);
+        if (it_document == documents_words_positions_.end()) {
+            return false;
+        }
+        // начала фразы: позиции первого слова, затем пересечение с позициями остальных слов за вычетом смещения
+        vector<uint32_t> starts;
+        for (size_t i = 0; i < phrase.size(); ++i) {
+            const auto it_positions = it_document->second.find(phrase[i].data);
+            if (it_positions == it_document->second.end()) {
+                return false;
+            }
+            const vector<uint32_t> positions = DecodePositions(it_positions->second.data(), it_positions->second.size());
+            if (i == 0) {
+                starts = positions;
+                continue;
+            }
+            vector<uint32_t> next_starts;
+            auto it_position = positions.begin();
+            for (uint32_t start : starts) {
+                it_position = lower_bound(it_position, positions.end(), start + phrase[i].offset);
+                if (it_position == positions.end()) {
+                    break;
+                }
+                if (*it_position == start + phrase[i].offset) {
+                    next_starts.push_back(start);
+                }
+            }
+            starts = move(next_starts);
+            if (starts.empty()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+//-------------------------------------------------------------------------------------------------------------
 void SearchServer::DelCopyElemVec(vector<string_view> &vec) const
 {
-    sort(vec.begin(), vec.end());
-    auto last = unique(vec.begin(), vec.end());
-    vec.erase(last, vec.end());
+    RemoveDuplicateWords(vec);
+}
+//-------------------------------------------------------------------------------------------------------------
+DocumentStatus SearchServer::GetDocumentStatus(int document_id) const {
+    return attributes_.GetStatus(documents_.at(document_id).ordinal);
 }
 //-------------------------------------------------------------------------------------------------------------
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+CorpusStats SearchServer::GetCorpusStats() const {
+    CorpusStats stats;
+    stats.document_count = GetDocumentCount();
+    if (!documents_.empty()) {
+        stats.average_document_length = total_document_length_ * 1.0 / documents_.size();
+    }
+    return stats;
 }
 //-------------------------------------------------------------------------------------------------------------
@@ -8,21 +8,138 @@
 #include <set>
 #include <utility>
 #include <algorithm>
+#include <numeric>
 #include <optional>
 #include <execution>
 #include <cassert>
 #include <functional>
 #include <type_traits>
+#include <array>
+#include <queue>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <chrono>
+#include <cmath>
 
 #include "document.h"
 #include "log_duration.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "memory_stats.h"
+#include "scorer.h"
+#include "document_attributes.h"
+#include "document_filter.h"
+#include "fingerprint.h"
+#include "index_memory_resource.h"
+#include "latency_histogram.h"
+#include "posting_list.h"
+#include "posting_intersection.h"
+#include "query_explain.h"
+#include "search_page.h"
+#include "stop_word_filter.h"
+#include "text_analyzer.h"
+#include "position_encoding.h"
 
 using namespace std::string_literals;
 
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
 constexpr double EPSILON = 1e-6;
+/** Сколько слов словаря по умолчанию может дать один шаблон запроса (cat*, c?t) */
+constexpr size_t MAX_TERM_EXPANSION_COUNT = 64;
+/** Множитель релевантности слова, найденного нечетким поиском, за каждую правку */
+constexpr double FUZZY_EDIT_PENALTY = 0.5;
+//-------------------------------------------------------------------------------------------------------------
+/** Что делает AddDocument с документом, набор слов которого совпадает с набором слов уже добавленного документа */
+enum class DuplicatePolicy {
+    ALLOW,   // дубликаты не ищутся
+    REJECT,  // новый документ не добавляется
+    REPLACE, // старый документ удаляется, новый добавляется
+    REPORT,  // новый документ добавляется, AddDocument сообщает id старого
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Как сочетаются плюс-слова запроса */
+enum class QueryMode {
+    ANY, // документ содержит хотя бы одно плюс-слово
+    ALL, // документ содержит все плюс-слова
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Предикат "статус документа равен status". FindTopDocuments распознает его по типу и проверяет статус
+ *  по флагам в списках документов, пропуская блоки без документов этого статуса */
+struct DocumentStatusPredicate {
+    DocumentStatus status;
+
+    bool operator()(int, DocumentStatus document_status, int) const {
+        return document_status == status;
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Предикат "документ есть в битовой карте DocumentFilter", проверяется по порядковому номеру из записи списка */
+struct FilterBitmapPredicate {
+    const FilterBitmap* bitmap;
+
+    bool Contains(uint32_t ordinal) const {
+        return bitmap->Contains(ordinal);
+    }
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Предикаты, которые FindTopDocuments проверяет по самой записи списка документов */
+template <typename DocumentPredicate>
+inline constexpr bool IS_POSTING_FILTER = std::is_same_v<DocumentPredicate, DocumentStatusPredicate>
+                                          || std::is_same_v<DocumentPredicate, FilterBitmapPredicate>;
+//-------------------------------------------------------------------------------------------------------------
+/** Частоты слов документа для GetWordFrequencies: смотрит прямо в индекс сервера, без копирования,
+ *  и действителен, пока документ не изменен и не удален. Итераторы те же, что у std::map<std::string_view, double> */
+class WordFrequenciesView {
+public:
+    using const_iterator = std::map<std::string_view, double>::const_iterator;
+    using value_type = std::map<std::string_view, double>::value_type;
+
+    explicit WordFrequenciesView(const std::pmr::map<std::string_view, double>& word_freqs)
+        : word_freqs_(&word_freqs) {
+    }
+
+    const_iterator begin() const {
+        return word_freqs_->begin();
+    }
+
+    const_iterator end() const {
+        return word_freqs_->end();
+    }
+
+    size_t size() const {
+        return word_freqs_->size();
+    }
+
+    bool empty() const {
+        return word_freqs_->empty();
+    }
+
+    const_iterator find(std::string_view word) const {
+        return word_freqs_->find(word);
+    }
+
+    size_t count(std::string_view word) const {
+        return word_freqs_->count(word);
+    }
+
+    /** Частота слова word, out_of_range - если слова в документе нет */
+    double at(std::string_view word) const {
+        return word_freqs_->at(word);
+    }
+
+    bool operator==(const WordFrequenciesView& other) const {
+        return size() == other.size() && std::equal(begin(), end(), other.begin());
+    }
+
+    bool operator!=(const WordFrequenciesView& other) const {
+        return !(*this == other);
+    }
+
+private:
+    const std::pmr::map<std::string_view, double>* word_freqs_;
+};
 //-------------------------------------------------------------------------------------------------------------
 class SearchServer {
 public:
@@ -35,9 +152,63 @@ public:
 
     explicit SearchServer(const std::string_view stop_words_text);
 
-    void AddDocument(int document_id, const std::string_view document, DocumentStatus status,
+    /** Аллокаторы контейнеров ссылаются на ресурс памяти сервера, а ключи - на строки его словаря, поэтому
+     *  копия строит индекс заново на своем ресурсе с той же политикой (в словарь копии попадают только слова
+     *  документов). Перемещение переносит ресурс вместе с контейнерами, а исходный сервер получает новый ресурс
+     *  и пустой индекс без стоп-слов: его можно уничтожить или наполнить заново.
+     *  Присваивание пересоздает сервер на месте, запросы, подготовленные им раньше, разбираются заново */
+    SearchServer(const SearchServer& other);
+    SearchServer& operator=(const SearchServer& other);
+    SearchServer(SearchServer&& other);
+    SearchServer& operator=(SearchServer&& other);
+
+    /** Возвращает id документа с тем же набором слов или INVALID_DOCUMENT_ID, если дубликата нет
+     *  (или политика DuplicatePolicy::ALLOW) */
+    int AddDocument(int document_id, const std::string_view document, DocumentStatus status,
                                    const std::vector<int>& ratings);
 
+    /** Политика обработки дубликатов в AddDocument. Все политики, кроме ALLOW, поддерживают индекс отпечатков
+     *  наборов слов документов: проверка нового документа - один поиск в хеш-таблице.
+     *  При включении индекс строится по уже добавленным документам */
+    void SetDuplicatePolicy(DuplicatePolicy policy);
+
+    DuplicatePolicy GetDuplicatePolicy() const;
+
+    /** Включает позиционный индекс: для каждого слова документа запоминаются его позиции,
+     *  что позволяет искать фразы в кавычках: "curly cat". Включать нужно до добавления документов */
+    void EnablePositionalIndex();
+
+    bool HasPositionalIndex() const;
+
+    /** Анализатор, которым разбираются и документы, и запросы: с TextAnalyzer::UTF8 "Кот" и "кот" - одно слово.
+     *  Стоп-слова приводятся тем же анализатором. Менять нужно до добавления документов */
+    void SetTextAnalyzer(TextAnalyzer analyzer);
+
+    TextAnalyzer GetTextAnalyzer() const;
+
+    /** Политика памяти контейнеров индекса: IndexAllocation::MONOTONIC строит индекс в арене без поузловых
+     *  malloc/free, а память возвращается блоками при уничтожении сервера или Clear; удаленные документы место
+     *  в арене не освобождают. upstream - откуда берется память (для арены - ее блоки).
+     *  Менять можно, пока в индексе нет документов (словарь удаленных документов при этом сбрасывается),
+     *  иначе logic_error */
+    void SetIndexAllocation(IndexAllocation allocation, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    IndexAllocation GetIndexAllocation() const;
+
+    /** Удаляет все документы вместе со словарем и возвращает память индекса. Арена отдает свои блоки разом,
+     *  не обходя узлы и массивы индекса. Настройки и стоп-слова сохраняются, удаленные документы попадут
+     *  в следующую дельту */
+    void Clear();
+
+    /** Ограничение на число слов словаря, в которые раскрывается один шаблон запроса.
+     *  Если подходящих слов больше, берутся встречающиеся в наибольшем числе документов */
+    void SetMaxTermExpansions(size_t max_term_expansions);
+
+    /** Нечеткий поиск: плюс-слово запроса раскрывается в слова словаря на расстоянии Левенштейна
+     *  не больше max_edits (1 или 2), 0 - выключить. Вклад слова умножается на FUZZY_EDIT_PENALTY
+     *  в степени расстояния. Фразы, шаблоны и минус-слова ищутся точно */
+    void SetFuzzyMaxEdits(int max_edits);
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
 
@@ -54,6 +225,63 @@ public:
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const std::string_view raw_query) const;
 
+    /** Ранжирование стратегией scorer (TfIdfScorer, Bm25Scorer или своей с тем же интерфейсом),
+     *  перегрузки без scorer ранжируют TfIdfScorer */
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const std::string_view raw_query, DocumentPredicate document_predicate,
+                                           const Scorer& scorer) const;
+
+    template <typename ExecutionPolicy, typename Scorer>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const std::string_view raw_query, DocumentStatus status,
+                                           const Scorer& scorer) const;
+
+    /** Отбор документов по атрибутам: фильтр вычисляется по столбцам атрибутов в битовую карту до ранжирования */
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const std::string_view raw_query, const DocumentFilter& filter) const;
+
+    template <typename ExecutionPolicy, typename Scorer>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const std::string_view raw_query, const DocumentFilter& filter,
+                                           const Scorer& scorer) const;
+
+    class PreparedQuery;
+
+    /** Разбирает запрос один раз: слова дедуплицированы, шаблоны и нечеткие слова раскрыты,
+     *  для каждого слова найден его список документов. Запрос хранит свою копию текста
+     *  и может выполняться многократно, в том числе из разных потоков */
+    PreparedQuery PrepareQuery(std::string_view raw_query, QueryMode mode = QueryMode::ANY) const;
+
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+
+    /** В режиме QueryMode::ALL списки документов плюс-слов пересекаются начиная с самого короткого,
+     *  релевантность считается только для пересечения. Шаблоны в этом режиме запрещены, нечеткий поиск не применяется */
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, QueryMode mode) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const PreparedQuery& query) const;
+
+    /** document_predicate - предикат, DocumentStatus или DocumentFilter */
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& , const PreparedQuery& query, DocumentPredicate document_predicate,
+                                           const Scorer& scorer) const;
+
+    /** Та же выдача, что у последовательного FindTopDocuments, с разбором по словам: длины списков, idf,
+     *  сколько документов получили вклад слова и сколько отсеяли предикат и минус-слова, длительность фаз
+     *  и вклад каждого слова в релевантность документов выдачи, счетчики процессора за запрос.
+     *  Документы перебираются полностью, без отсечения, поэтому explain медленнее обычного поиска */
+    QueryExplain ExplainTopDocuments(const std::string_view raw_query) const;
+
+    /** document_predicate - предикат, DocumentStatus или DocumentFilter */
+    template <typename DocumentPredicate>
+    QueryExplain ExplainTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <typename DocumentPredicate, typename Scorer>
+    QueryExplain ExplainTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, const Scorer& scorer) const;
+
     int GetDocumentCount() const;
 
     std::set<int>::const_iterator begin() const;
@@ -66,25 +294,148 @@ public:
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy, const std::string_view raw_query, int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const PreparedQuery& query, int document_id) const;
+
+    /** Страница выдачи без ограничения MAX_RESULT_DOCUMENT_COUNT: документы с offset по offset + limit - 1
+     *  в порядке ранжирования. Считаются только первые offset + limit документов, а не вся выдача */
+    SearchPage FindTopDocumentsPage(const std::string_view raw_query, size_t offset, size_t limit) const;
+
+    /** Страница из limit документов, ранжированных ниже курсора after (next_cursor предыдущей страницы) */
+    SearchPage FindTopDocumentsPage(const std::string_view raw_query, const SearchCursor& after, size_t limit) const;
+
+    /** document_predicate - предикат, DocumentStatus или DocumentFilter */
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchPage FindTopDocumentsPage(ExecutionPolicy&& , const std::string_view raw_query, DocumentPredicate document_predicate,
+                                    size_t offset, size_t limit) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate>
+    SearchPage FindTopDocumentsPage(ExecutionPolicy&& , const std::string_view raw_query, DocumentPredicate document_predicate,
+                                    const SearchCursor& after, size_t limit) const;
+
+    /** MatchDocument для всех документов по возрастанию id за один проход по спискам документов слов запроса */
+    std::vector<DocumentMatch> MatchAllDocuments(const PreparedQuery& query) const;
+
+    WordFrequenciesView GetWordFrequencies(int document_id) const;
 
     void RemoveDocument(int document_id);
 
+    /** Удаляет группу документов: список документов каждого слова уплотняется один раз,
+     *  а не по разу на каждый удаляемый документ. Несуществующие id пропускаются */
+    void RemoveDocuments(std::vector<int> document_ids);
+
+    /** Меняет статус документа: флаги статуса в списках документов его слов обновляются на месте */
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+
     template <typename ExecutPolic>
     void RemoveDocument(ExecutPolic execut_polic, int document_id);
 
+    /** Память, занимаемая внутренними структурами. Считается по счетчикам за O(1),
+     *  поэтому годится для периодического опроса из потока мониторинга */
+    IndexMemoryStats MemoryStats() const;
+
+    /** Полный снимок индекса: все документы со словами и частотами. Стоп-слова в снимок не входят,
+     *  восстанавливать нужно в сервер, созданный с теми же стоп-словами.
+     *  generation - поколение цепочки: дельты поверх снимка пишутся с тем же поколением */
+    void SaveSnapshot(std::ostream& out, uint64_t generation = 0) const;
+
+    /** Только документы, добавленные и удаленные после последнего ResetChangeTracking */
+    void SaveDelta(std::ostream& out, uint64_t generation = 0) const;
+
+    /** Загружает полный снимок в пустой сервер, возвращает его поколение */
+    uint64_t LoadSnapshot(std::istream& in);
+
+    /** Применяет дельту поверх ранее загруженного состояния. Дельту другого поколения (оставшуюся
+     *  от прежнего снимка) не применяет и возвращает false */
+    bool ApplyDelta(std::istream& in, uint64_t generation = 0);
+
+    /** Поколение снимка по заголовку, без чтения документов */
+    static uint64_t ReadSnapshotGeneration(std::istream& in);
+
+    bool HasChanges() const;
+
+    void ResetChangeTracking();
+
 private:
+    /** Рейтинг и статус документа лежат в attributes_ по порядковому номеру ordinal */
     struct DocumentData {
-        int rating;
-        DocumentStatus status;
+        uint32_t ordinal;
+        /** Число слов документа без стоп-слов */
+        uint32_t length;
     };
-    const std::set<std::string, std::less<>> stop_words_;
+    /** Память всех pmr-контейнеров ниже. Объявлен раньше них, чтобы пережить их, и лежит в куче,
+     *  чтобы при перемещении сервера адрес ресурса в аллокаторах контейнеров оставался верным.
+     *  Новый член нужно перенести в перемещающем и копирующем конструкторах, TestServerCopyAndMove
+     *  проверяет каждый контейнер */
+    std::unique_ptr<IndexMemoryResource> index_memory_ = std::make_unique<IndexMemoryResource>();
+    StopWordFilter stop_words_;
     /** Хранит string, все осталные контейнеры используют string_view на эти string */
-    std::set<std::string> words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
-    std::map<int, std::map<std::string_view, double>> documents_words_freqs_;
+    std::pmr::set<std::pmr::string> words_{index_memory_.get()};
+    std::pmr::map<std::string_view, PostingList> word_to_document_freqs_{index_memory_.get()};
+    std::pmr::map<int, DocumentData> documents_{index_memory_.get()};
+    DocumentAttributeStore attributes_{index_memory_.get()};
+    std::pmr::set<int> document_ids_{index_memory_.get()};
+    std::pmr::map<int, std::pmr::map<std::string_view, double>> documents_words_freqs_{index_memory_.get()};
+    /** Сумма длин всех документов, для средней длины в BM25 */
+    size_t total_document_length_ = 0;
+    /** Позиции слов в документах, сжатые EncodePositions. Заполняется, только если включен позиционный индекс */
+    bool has_positional_index_ = false;
+    TextAnalyzer text_analyzer_ = TextAnalyzer::LEGACY;
+    size_t max_term_expansions_ = MAX_TERM_EXPANSION_COUNT;
+    int fuzzy_max_edits_ = 0;
+    /** Версии для PreparedQuery: словарь меняется при появлении нового слова и настроек разбора запроса,
+     *  индекс - при любом изменении длины списка документов */
+    uint64_t dictionary_version_ = 0;
+    uint64_t index_version_ = 0;
+    DuplicatePolicy duplicate_policy_ = DuplicatePolicy::ALLOW;
+    /** Отпечатки наборов слов документов, заполняется только при политике дубликатов, отличной от ALLOW.
+     *  При REPORT у одного отпечатка может быть несколько документов */
+    std::pmr::unordered_multimap<Fingerprint128, int, Fingerprint128Hasher> fingerprint_documents_{index_memory_.get()};
+    std::pmr::map<int, std::pmr::map<std::string_view, std::pmr::vector<uint8_t>>> documents_words_positions_{index_memory_.get()};
+
+    /** Изменения с последней контрольной точки: документ, удаленный и добавленный заново, есть в обоих */
+    std::pmr::set<int> changed_document_ids_{index_memory_.get()};
+    std::pmr::set<int> removed_document_ids_{index_memory_.get()};
+
+    /** Счетчики для MemoryStats, обновляются при добавлении и удалении документов */
+    size_t words_heap_bytes_ = 0;
+    size_t words_heap_allocated_bytes_ = 0;
+    size_t dead_words_heap_allocated_bytes_ = 0;
+    size_t posting_count_ = 0;
+    size_t posting_capacity_bytes_ = 0;
+    size_t posting_allocated_bytes_ = 0;
+    size_t posting_used_bytes_ = 0;
+    size_t positions_bytes_ = 0;
+    size_t positions_allocated_bytes_ = 0;
+    std::array<size_t, POSTING_LENGTH_BUCKET_COUNT> posting_length_histogram_{};
+
+    /** Перемещение с ресурсом для исходного сервера, выделенным заранее: присваивание выделяет его
+     *  до разрушения прежнего содержимого */
+    SearchServer(SearchServer&& other, std::unique_ptr<IndexMemoryResource> other_memory);
+
+    void UpdatePostingLength(std::string_view word, size_t old_length, size_t new_length);
+
+    /** Пустые контейнеры индекса на текущем index_memory_, счетчики памяти и атрибуты - в начальное состояние.
+     *  Без destroy_containers прежние контейнеры не разрушаются: их память уже отдана вместе с блоками арены */
+    void ResetIndex(bool destroy_containers = true);
+
+    void AddWordToIndex(int document_id, uint32_t ordinal, std::string_view word, double term_freq, uint8_t length_norm,
+                        DocumentStatus status);
+
+    DocumentStatus GetDocumentStatus(int document_id) const;
+
+    void WriteDocument(std::ostream& out, int document_id) const;
+
+    void ReadDocument(std::istream& in);
+
+    /** Копирует сжатые позиции слова документа в память индекса */
+    void AddPositionsToIndex(int document_id, std::string_view word, const uint8_t* encoded_positions, size_t size);
+
+    void RemovePositionsFromIndex(int document_id);
+
+    /** Отпечаток набора слов уже добавленного документа */
+    Fingerprint128 DocumentFingerprint(int document_id) const;
+
+    void RemoveFingerprintFromIndex(int document_id);
 
     bool IsStopWord(std::string_view word) const;
 
@@ -102,20 +453,131 @@ private:
 
     QueryWord ParseQueryWord(std::string_view text) const;
 
+    /** Слово фразы и его смещение от начала фразы (стоп-слова тоже занимают позицию) */
+    struct PhraseWord {
+        std::string_view data;
+        uint32_t offset;
+    };
+
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        /** Фразы в кавычках: документ должен содержать каждую, слова фраз входят и в plus_words */
+        std::vector<std::vector<PhraseWord>> phrases;
+        /** Веса слов, найденных нечетким поиском с правками, у остальных слов вес 1 */
+        std::map<std::string_view, double> word_weights;
+        /** Списки документов слов в порядке plus_words и minus_words, nullptr - слова нет в словаре */
+        std::vector<const PostingList*> plus_postings;
+        std::vector<const PostingList*> minus_postings;
+        /** Запрос раскрывал шаблоны или нечеткие слова: набор слов зависит от длин списков документов */
+        bool has_expansions = false;
+        /** QueryMode::ALL: документ должен содержать все плюс-слова */
+        bool is_conjunctive = false;
+        /** Текст запроса после анализатора, если он отличается от исходного: на него ссылаются слова запроса,
+         *  которых нет в словаре (слова из словаря ResolveQuery заменяет на строки словаря) */
+        std::shared_ptr<const std::string> analyzed_text;
+
+        double WordWeight(std::string_view word) const {
+            const auto it = word_weights.find(word);
+            return it == word_weights.end() ? 1.0 : it->second;
+        }
+    };
+
+public:
+    class PreparedQuery {
+    public:
+        std::string_view GetText() const {
+            return *text_;
+        }
+
+    private:
+        friend class SearchServer;
+
+        /** Текст в куче: слова запроса ссылаются на него и не ломаются при перемещении PreparedQuery */
+        std::unique_ptr<const std::string> text_;
+        Query query_;
+        const SearchServer* server_ = nullptr;
+        uint64_t dictionary_version_ = 0;
+        uint64_t index_version_ = 0;
     };
 
-    Query ParseQuery( std::string_view text, bool is_del_copy = true) const;
+private:
+    Query ParseQuery( std::string_view text, bool is_del_copy = true, QueryMode mode = QueryMode::ANY) const;
+
+    /** Находит списки документов слов запроса */
+    void ResolveQuery(Query& query) const;
+
+    /** Разобранный запрос PreparedQuery. Если с момента подготовки изменился словарь
+     *  (или длины списков для запросов с раскрытием), запрос разбирается заново в reparsed */
+    const Query& GetPreparedQuery(const PreparedQuery& prepared, Query& reparsed) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchQuery(const Query& query, int document_id) const;
+
+    void ParsePhrase(std::string_view text, Query& query) const;
+
+    /** Добавляет в words слова словаря, подходящие под шаблон: диапазон отсортированного словаря
+     *  по префиксу до первого '*' или '?', затем проверка остатка шаблона */
+    void ExpandWildcard(std::string_view pattern, std::vector<std::string_view>& words) const;
+
+    /** Добавляет в weights слова словаря на расстоянии не больше fuzzy_max_edits_ от word с весом по расстоянию.
+     *  Автомат Левенштейна идет по отсортированному словарю: состояния общих префиксов соседних слов
+     *  не пересчитываются, а от префикса, из которого автомат не может прийти в принимающее состояние,
+     *  один lower_bound ведет сразу к следующему префиксу, который автомат еще может принять */
+    void ExpandFuzzy(std::string_view word, std::map<std::string_view, double>& weights) const;
 
-    /** Удаляет повторяющиеся элементы из вектора, вектор получается отсортированным */
+    /** Содержит ли документ все фразы запроса: пересечение списков позиций слов фразы */
+    bool MatchPhrases(int document_id, const Query& query) const;
+
+    /** Удаляет повторяющиеся элементы из вектора, порядок первых вхождений сохраняется (RemoveDuplicateWords) */
     void DelCopyElemVec(std::vector<std::string_view>& vec) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string_view &word) const;
+    CorpusStats GetCorpusStats() const;
 
-    template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy&&, const Query& query, DocumentPredicate document_predicate) const;
+    /** Проходит ли запись списка документов предикат. Произвольный предикат получает рейтинг и статус
+     *  из столбцов атрибутов по порядковому номеру записи */
+    template <typename DocumentPredicate>
+    bool IsPostingAccepted(const DocumentPredicate& document_predicate, PostingList::const_iterator it) const;
+
+    /** Первая запись не раньше it, проходящая предикат, проверяемый по записи (IS_POSTING_FILTER);
+     *  произвольный предикат не проверяется - это дороже, чем отсечь документ по релевантности */
+    template <typename DocumentPredicate>
+    PostingList::const_iterator SkipRejectedPostings(const PostingList& postings, PostingList::const_iterator it,
+                                                     const DocumentPredicate& document_predicate) const;
+
+    /** Вызывает function с предикатом, который понимают движки: DocumentStatus и DocumentFilter
+     *  превращаются в предикаты, проверяемые по записям списков документов */
+    template <typename DocumentPredicate, typename Function>
+    auto CallWithPredicate(const DocumentPredicate& document_predicate, Function function) const;
+
+    /** Оставляет top_count лучших документов по порядку ранжирования: частичная сортировка вместо полной */
+    template <typename ExecutionPolicy>
+    static void SelectTopDocuments(ExecutionPolicy&& execpolicy, std::vector<Document>& documents, size_t top_count);
+
+    static SearchPage MakeSearchPage(std::vector<Document> documents, size_t limit);
+
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocumentsForQuery(ExecutionPolicy&&, const Query& query, DocumentPredicate document_predicate,
+                                                   const Scorer& scorer) const;
+
+    template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindAllDocuments(ExecutionPolicy&&, const Query& query, DocumentPredicate document_predicate,
+                                           const Scorer& scorer) const;
+
+    /** Документы, содержащие все плюс-слова: кандидаты из самого короткого списка пересекаются
+     *  со следующими по длине списками (IntersectSorted), затем отбрасываются документы с минус-словами */
+    template <typename DocumentPredicate, typename Scorer>
+    QueryExplain ExplainQuery(const Query& query, DocumentPredicate document_predicate, const Scorer& scorer) const;
+
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindConjunctiveDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                   const Scorer& scorer) const;
+
+    /** Документ за документом по спискам плюс-слов с отсечением MaxScore: документы, чья верхняя граница
+     *  релевантности заведомо ниже top_count-го результата, не досчитываются. Результат совпадает с полным перебором.
+     *  Если задан after, отбираются только документы, ранжированные ниже него (следующая страница выдачи) */
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopDocumentsPruned(const Query& query, DocumentPredicate document_predicate, size_t top_count,
+                                                 const Scorer& scorer, const Document* after = nullptr) const;
 };
 //----------------------------------------------------------------------------
 template <typename StringContainer>
@@ -128,27 +590,155 @@ SearchServer::SearchServer(const StringContainer& stop_words)
     }
 }
 //-------------------------------------------------------------------------------------------------------------
+/** Релевантность, округленная до EPSILON. Равенство ключей, в отличие от "разница меньше EPSILON", транзитивно */
+inline int64_t RelevanceRankKey(double relevance) {
+    return std::llround(relevance / EPSILON);
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Порядок выдачи: релевантность, округленная до EPSILON, при равной - рейтинг, затем меньший id.
+ *  Это строгий порядок без равных элементов, поэтому страницы выдачи не пересекаются
+ *  и не теряют документы с одинаковой релевантностью */
+inline bool IsDocumentRankedHigher(const Document& lhs, const Document& rhs) {
+    const int64_t lhs_key = RelevanceRankKey(lhs.relevance);
+    const int64_t rhs_key = RelevanceRankKey(rhs.relevance);
+    if (lhs_key != rhs_key) {
+        return lhs_key > rhs_key;
+    }
+    return lhs.rating != rhs.rating ? lhs.rating > rhs.rating : lhs.id < rhs.id;
+}
+//-------------------------------------------------------------------------------------------------------------
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const std::string_view raw_query, DocumentPredicate document_predicate) const {
-    auto matched_documents = FindAllDocuments(execpolicy, ParseQuery(raw_query), document_predicate);
-    std::sort(execpolicy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
+    return FindTopDocuments(execpolicy, raw_query, document_predicate, TfIdfScorer{});
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     const Scorer& scorer) const {
+    return FindTopDocumentsForQuery(execpolicy, ParseQuery(raw_query), document_predicate, scorer);
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const PreparedQuery& query) const {
+    return FindTopDocuments(execpolicy, query, DocumentStatus::ACTUAL);
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const PreparedQuery& query,
+                                                     DocumentPredicate document_predicate) const {
+    return FindTopDocuments(execpolicy, query, document_predicate, TfIdfScorer{});
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const PreparedQuery& query,
+                                                     DocumentPredicate document_predicate, const Scorer& scorer) const {
+    Query reparsed;
+    const Query& parsed = GetPreparedQuery(query, reparsed);
+    return CallWithPredicate(document_predicate, [&](const auto& predicate) {
+        return FindTopDocumentsForQuery(execpolicy, parsed, predicate, scorer);
+    });
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate, typename Function>
+auto SearchServer::CallWithPredicate(const DocumentPredicate& document_predicate, Function function) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentStatus>) {
+        return function(DocumentStatusPredicate{document_predicate});
+    } else if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+        const FilterBitmap bitmap = document_predicate.Evaluate(attributes_);
+        return function(FilterBitmapPredicate{&bitmap});
+    } else {
+        return function(document_predicate);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy>
+void SearchServer::SelectTopDocuments(ExecutionPolicy&& execpolicy, std::vector<Document>& documents, size_t top_count) {
+    top_count = std::min(top_count, documents.size());
+    std::partial_sort(execpolicy, documents.begin(), documents.begin() + top_count, documents.end(), IsDocumentRankedHigher);
+    documents.resize(top_count);
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchPage SearchServer::FindTopDocumentsPage(ExecutionPolicy&& execpolicy, const std::string_view raw_query,
+                                              DocumentPredicate document_predicate, size_t offset, size_t limit) const {
+    if (limit == 0) {
+        throw std::invalid_argument("limit == 0"s);
+    }
+    if (offset > std::numeric_limits<size_t>::max() - limit) {
+        throw std::invalid_argument("offset + limit overflow"s);
+    }
+    const Query query = ParseQuery(raw_query);
+    return CallWithPredicate(document_predicate, [&](const auto& predicate) {
+        TfIdfScorer scorer;
+        scorer.Prepare(GetCorpusStats(), query.plus_words.size());
+        std::vector<Document> documents;
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            documents = FindTopDocumentsPruned(query, predicate, offset + limit, scorer);
         } else {
-            return lhs.relevance > rhs.relevance;
+            documents = FindAllDocuments(execpolicy, query, predicate, scorer);
+            SelectTopDocuments(execpolicy, documents, offset + limit);
         }
+        documents.erase(documents.begin(), documents.begin() + std::min(offset, documents.size()));
+        return MakeSearchPage(std::move(documents), limit);
     });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchPage SearchServer::FindTopDocumentsPage(ExecutionPolicy&& execpolicy, const std::string_view raw_query,
+                                              DocumentPredicate document_predicate, const SearchCursor& after, size_t limit) const {
+    if (limit == 0) {
+        throw std::invalid_argument("limit == 0"s);
+    }
+    const Query query = ParseQuery(raw_query);
+    return CallWithPredicate(document_predicate, [&](const auto& predicate) {
+        TfIdfScorer scorer;
+        scorer.Prepare(GetCorpusStats(), query.plus_words.size());
+        // документы выше курсора отбрасываются до выбора, среди остальных выбираются limit лучших
+        const Document last{after.document_id, after.relevance, after.rating};
+        std::vector<Document> documents;
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+            documents = FindTopDocumentsPruned(query, predicate, limit, scorer, &last);
+        } else {
+            documents = FindAllDocuments(execpolicy, query, predicate, scorer);
+            documents.erase(std::remove_if(documents.begin(), documents.end(), [&last](const Document& document) {
+                                return !IsDocumentRankedHigher(last, document);
+                            }),
+                            documents.end());
+            SelectTopDocuments(execpolicy, documents, limit);
+        }
+        return MakeSearchPage(std::move(documents), limit);
+    });
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindTopDocumentsForQuery(ExecutionPolicy&& execpolicy, const Query& query,
+                                                             DocumentPredicate document_predicate, const Scorer& scorer) const {
+    Scorer prepared_scorer = scorer;
+    prepared_scorer.Prepare(GetCorpusStats(), query.plus_words.size());
+    if (query.is_conjunctive) {
+        std::vector<Document> matched_documents;
+        {
+            PROFILE_QUERY_PHASE(QueryPhase::POSTINGS);
+            matched_documents = FindConjunctiveDocuments(query, document_predicate, prepared_scorer);
+        }
+        PROFILE_QUERY_PHASE(QueryPhase::TOP_K);
+        SelectTopDocuments(std::execution::seq, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+        return matched_documents;
+    }
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        // фазы проход по спискам, минус-слова и отбор лучших замеряются внутри отсечения MaxScore
+        return FindTopDocumentsPruned(query, document_predicate, MAX_RESULT_DOCUMENT_COUNT, prepared_scorer);
+    } else {
+        auto matched_documents = FindAllDocuments(execpolicy, query, document_predicate, prepared_scorer);
+        PROFILE_QUERY_PHASE(QueryPhase::TOP_K);
+        SelectTopDocuments(execpolicy, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+        return matched_documents;
     }
-    return matched_documents;
 }
 //-------------------------------------------------------------------------------------------------------------
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(execpolicy, raw_query,
-                            [status](int, DocumentStatus document_status, int) {
-                                return document_status == status;} );
+    return FindTopDocuments(execpolicy, raw_query, DocumentStatusPredicate{status});
 }
 //-------------------------------------------------------------------------------------------------------------
 template <typename ExecutionPolicy>
@@ -156,56 +746,563 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolic
     return FindTopDocuments(execpolicy, raw_query, DocumentStatus::ACTUAL);
 }
 //-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename Scorer>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const std::string_view raw_query, DocumentStatus status,
+                                                     const Scorer& scorer) const {
+    return FindTopDocuments(execpolicy, raw_query, DocumentStatusPredicate{status}, scorer);
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const std::string_view raw_query, const DocumentFilter& filter) const {
+    return FindTopDocuments(execpolicy, raw_query, filter, TfIdfScorer{});
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename ExecutionPolicy, typename Scorer>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& execpolicy, const std::string_view raw_query, const DocumentFilter& filter,
+                                                     const Scorer& scorer) const {
+    const FilterBitmap bitmap = filter.Evaluate(attributes_);
+    return FindTopDocuments(execpolicy, raw_query, FilterBitmapPredicate{&bitmap}, scorer);
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate>
+bool SearchServer::IsPostingAccepted(const DocumentPredicate& document_predicate, PostingList::const_iterator it) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+        return it.Status() == document_predicate.status;
+    } else if constexpr (std::is_same_v<DocumentPredicate, FilterBitmapPredicate>) {
+        return document_predicate.Contains(it.Ordinal());
+    } else {
+        const uint32_t ordinal = it.Ordinal();
+        return document_predicate(it.DocumentId(), attributes_.GetStatus(ordinal), attributes_.GetRating(ordinal));
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate>
+PostingList::const_iterator SearchServer::SkipRejectedPostings(const PostingList& postings, PostingList::const_iterator it,
+                                                               const DocumentPredicate& document_predicate) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+        return postings.SkipToStatus(it, StatusBit(document_predicate.status));
+    } else if constexpr (std::is_same_v<DocumentPredicate, FilterBitmapPredicate>) {
+        while (it != postings.end() && !document_predicate.Contains(it.Ordinal())) {
+            ++it;
+        }
+        return it;
+    } else {
+        return it;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
     return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
 }
 //-------------------------------------------------------------------------------------------------------------
-template<typename ExecutionPolicy,typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& execpolicy, const Query &query, DocumentPredicate document_predicate) const
+template<typename ExecutionPolicy,typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& execpolicy, const Query &query, DocumentPredicate document_predicate,
+                                                     const Scorer& scorer) const
 {
+    const CorpusStats corpus_stats = GetCorpusStats();
     const bool is_excpolicy_par = std::is_same_v <std::decay_t<ExecutionPolicy>, std::execution::parallel_policy>;
     size_t bucket_count = 1;
     if constexpr ( is_excpolicy_par ){
         bucket_count = 64;
     }
-    ConcurrentMap<int, double> document_to_relevance(bucket_count);
-    for_each(execpolicy,
-             query.plus_words.begin(), query.plus_words.end(),
-             [document_predicate, &document_to_relevance, this](std::string_view word)
-        {
-            if (word_to_document_freqs_.count(word) == 0) {
-                return;
-            }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+    // квантованные оценки (QuantizedScorer) копятся в целых, и сумма не зависит от порядка потоков
+    ConcurrentMap<int, ScoreType<Scorer>> document_to_relevance(bucket_count);
+    // параллельный for_each может передавать копии элементов, поэтому идем по номерам слов, а не по ссылкам на них
+    std::vector<size_t> word_indexes(std::max(query.plus_words.size(), query.minus_words.size()));
+    std::iota(word_indexes.begin(), word_indexes.end(), 0);
+    {
+        PROFILE_QUERY_PHASE(QueryPhase::POSTINGS);
+        for_each(execpolicy,
+                 word_indexes.begin(), word_indexes.begin() + query.plus_words.size(),
+                 [&document_predicate, &document_to_relevance, &query, &scorer, &corpus_stats, this](size_t word_index)
+            {
+                const PostingList* word_postings = query.plus_postings[word_index];
+                if (word_postings == nullptr) {
+                    return;
+                }
+                const PostingList& postings = *word_postings;
+                const double inverse_document_freq = scorer.InverseDocumentFreq(corpus_stats, postings.size())
+                                                     * query.WordWeight(query.plus_words[word_index]);
+                for (auto it = SkipRejectedPostings(postings, postings.begin(), document_predicate); it != postings.end();
+                     it = SkipRejectedPostings(postings, ++it, document_predicate)) {
+                    if constexpr (!IS_POSTING_FILTER<DocumentPredicate>) {
+                        if (!IsPostingAccepted(document_predicate, it)) {
+                            continue;
+                        }
+                    }
+                    document_to_relevance[it.DocumentId()].ref_to_value += scorer.Score(inverse_document_freq, it.TermFreq(), it.LengthNorm());
+                }
+            }
+        );
+    }
+
+    {
+        PROFILE_QUERY_PHASE(QueryPhase::MINUS_WORDS);
+        for_each(execpolicy,
+                 word_indexes.begin(), word_indexes.begin() + query.minus_words.size(),
+                 [&document_to_relevance, &query](size_t word_index)
+            {
+                const PostingList* word_postings = query.minus_postings[word_index];
+                if (word_postings == nullptr) {
+                    return;
+                }
+                for (const auto& [document_id, _] : *word_postings) {
+                    document_to_relevance.erase(document_id);
                 }
             }
+        );
+    }
+    std::vector<Document> matched_documents;
+    for (const auto& [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+        if (!query.phrases.empty() && !MatchPhrases(document_id, query)) {
+            continue;
         }
-    );
+        matched_documents.push_back({document_id, ScoreToRelevance(scorer, relevance), attributes_.GetRating(documents_.at(document_id).ordinal)});
+    }
+    return matched_documents;
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate>
+QueryExplain SearchServer::ExplainTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return ExplainTopDocuments(raw_query, document_predicate, TfIdfScorer{});
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate, typename Scorer>
+QueryExplain SearchServer::ExplainTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate,
+                                               const Scorer& scorer) const {
+    const PerfCounterSample start_counters = ThreadPerfCounters().Read();
+    const auto parse_start = std::chrono::steady_clock::now();
+    const Query query = ParseQuery(raw_query);
+    const auto parse_duration = std::chrono::steady_clock::now() - parse_start;
+    QueryExplain explain = CallWithPredicate(document_predicate, [&](const auto& predicate) {
+        return ExplainQuery(query, predicate, scorer);
+    });
+    explain.phase_ns[static_cast<size_t>(QueryPhase::PARSE)] =
+        static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(parse_duration).count());
+    explain.counters = ThreadPerfCounters().Read() - start_counters;
+    return explain;
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate, typename Scorer>
+QueryExplain SearchServer::ExplainQuery(const Query& query, DocumentPredicate document_predicate, const Scorer& scorer) const {
+    using Score = ScoreType<Scorer>;
+    auto phase_start = std::chrono::steady_clock::now();
+    QueryExplain explain;
+    const auto finish_phase = [&explain, &phase_start](QueryPhase phase) {
+        const auto now = std::chrono::steady_clock::now();
+        explain.phase_ns[static_cast<size_t>(phase)] =
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start).count());
+        phase_start = now;
+    };
 
-    for_each(execpolicy,
-             query.minus_words.begin(), query.minus_words.end(),
-             [&document_to_relevance, this](std::string_view word)
-        {
-            if (word_to_document_freqs_.count(word) == 0) {
-                return;
+    Scorer prepared_scorer = scorer;
+    const CorpusStats corpus_stats = GetCorpusStats();
+    prepared_scorer.Prepare(corpus_stats, query.plus_words.size());
+    const size_t term_count = query.plus_words.size() + query.minus_words.size();
+    explain.terms.resize(term_count);
+
+    // вклады плюс-слов по документам; matched отличает нулевой вклад от отсутствия слова в документе
+    struct Candidate {
+        std::vector<Score> contributions;
+        std::vector<bool> matched;
+    };
+    std::map<int, Candidate> candidates;
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        TermExplain& term = explain.terms[i];
+        term.word = std::string(query.plus_words[i]);
+        if (query.plus_postings[i] == nullptr) {
+            continue;
+        }
+        const PostingList& postings = *query.plus_postings[i];
+        term.posting_length = postings.size();
+        term.inverse_document_freq = prepared_scorer.InverseDocumentFreq(corpus_stats, postings.size()) * query.WordWeight(query.plus_words[i]);
+        for (auto it = postings.begin(); it != postings.end(); ++it) {
+            if (!IsPostingAccepted(document_predicate, it)) {
+                ++term.documents_rejected_by_predicate;
+                continue;
             }
-            for (const auto& [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+            ++term.documents_scored;
+            Candidate& candidate = candidates[it.DocumentId()];
+            if (candidate.contributions.empty()) {
+                candidate.contributions.resize(query.plus_words.size(), Score{});
+                candidate.matched.resize(query.plus_words.size(), false);
             }
+            candidate.contributions[i] = prepared_scorer.Score(term.inverse_document_freq, it.TermFreq(), it.LengthNorm());
+            candidate.matched[i] = true;
         }
-    );
+    }
+    explain.candidate_count = candidates.size();
+    finish_phase(QueryPhase::POSTINGS);
+
+    for (size_t j = 0; j < query.minus_words.size(); ++j) {
+        TermExplain& term = explain.terms[query.plus_words.size() + j];
+        term.word = std::string(query.minus_words[j]);
+        term.is_minus = true;
+        if (query.minus_postings[j] == nullptr) {
+            continue;
+        }
+        term.posting_length = query.minus_postings[j]->size();
+        for (const auto& [document_id, _] : *query.minus_postings[j]) {
+            const auto candidate = candidates.find(document_id);
+            if (candidate == candidates.end()) {
+                continue;
+            }
+            ++term.documents_rejected_by_minus_words;
+            for (size_t i = 0; i < query.plus_words.size(); ++i) {
+                if (candidate->second.matched[i]) {
+                    ++explain.terms[i].documents_rejected_by_minus_words;
+                }
+            }
+            candidates.erase(candidate);
+        }
+    }
+    if (!query.phrases.empty()) {
+        for (auto it = candidates.begin(); it != candidates.end();) {
+            if (MatchPhrases(it->first, query)) {
+                ++it;
+            } else {
+                ++explain.rejected_by_phrases;
+                it = candidates.erase(it);
+            }
+        }
+    }
+    finish_phase(QueryPhase::MINUS_WORDS);
+
+    // суммируем в порядке слов запроса, как движки FindTopDocuments, чтобы релевантность совпадала побитно
     std::vector<Document> matched_documents;
-    for (const auto& [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    matched_documents.reserve(candidates.size());
+    for (const auto& [document_id, candidate] : candidates) {
+        Score relevance{};
+        for (const Score contribution : candidate.contributions) {
+            relevance += contribution;
+        }
+        matched_documents.push_back({document_id, ScoreToRelevance(prepared_scorer, relevance), attributes_.GetRating(documents_.at(document_id).ordinal)});
+    }
+    SelectTopDocuments(std::execution::seq, matched_documents, MAX_RESULT_DOCUMENT_COUNT);
+    for (const Document& document : matched_documents) {
+        const Candidate& candidate = candidates.at(document.id);
+        DocumentExplain& document_explain = explain.documents.emplace_back();
+        document_explain.document = document;
+        document_explain.term_relevances.resize(term_count, 0.0);
+        for (size_t i = 0; i < query.plus_words.size(); ++i) {
+            document_explain.term_relevances[i] = ScoreToRelevance(prepared_scorer, candidate.contributions[i]);
+        }
+    }
+    finish_phase(QueryPhase::TOP_K);
+    return explain;
+}
+//-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindConjunctiveDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                             const Scorer& scorer) const
+{
+    struct Term {
+        const PostingList* postings;
+        size_t query_index;
+    };
+    std::vector<Term> terms;
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        if (query.plus_postings[i] == nullptr || query.plus_postings[i]->empty()) {
+            return {};
+        }
+        terms.push_back({query.plus_postings[i], i});
+    }
+    if (terms.empty()) {
+        return {};
+    }
+    std::sort(terms.begin(), terms.end(), [](const Term& lhs, const Term& rhs) {
+        return lhs.postings->size() < rhs.postings->size();
+    });
+
+    // кандидаты - документы самого короткого списка, прошедшие отбор по записи;
+    // positions[t][k] - индекс k-го кандидата в списке слова terms[t]
+    const PostingList& rarest = *terms[0].postings;
+    std::vector<int> candidate_ids;
+    std::vector<std::vector<uint32_t>> positions(terms.size());
+    for (auto it = SkipRejectedPostings(rarest, rarest.begin(), document_predicate); it != rarest.end();
+         it = SkipRejectedPostings(rarest, ++it, document_predicate)) {
+        candidate_ids.push_back(it.DocumentId());
+        positions[0].push_back(static_cast<uint32_t>(it.Index()));
+    }
+    std::vector<uint32_t> kept(candidate_ids.size());
+    for (size_t t = 1; t < terms.size() && !candidate_ids.empty(); ++t) {
+        const PostingList& postings = *terms[t].postings;
+        positions[t].resize(candidate_ids.size());
+        size_t match_count = IntersectSorted(candidate_ids.data(), candidate_ids.size(), postings.DocumentIds(), postings.StoredSize(),
+                                             {kept.data(), positions[t].data()});
+        // совпадения с удаленными записями списка отбрасываются
+        size_t live_count = 0;
+        for (size_t k = 0; k < match_count; ++k) {
+            if (postings.IsErased(positions[t][k])) {
+                continue;
+            }
+            candidate_ids[live_count] = candidate_ids[kept[k]];
+            positions[t][live_count] = positions[t][k];
+            for (size_t previous = 0; previous < t; ++previous) {
+                positions[previous][live_count] = positions[previous][kept[k]];
+            }
+            ++live_count;
+        }
+        match_count = live_count;
+        candidate_ids.resize(match_count);
+        for (size_t previous = 0; previous <= t; ++previous) {
+            positions[previous].resize(match_count);
+        }
+    }
+
+    const CorpusStats corpus_stats = GetCorpusStats();
+    std::vector<double> inverse_document_freqs(terms.size());
+    for (size_t t = 0; t < terms.size(); ++t) {
+        inverse_document_freqs[t] = scorer.InverseDocumentFreq(corpus_stats, terms[t].postings->size())
+                                    * query.WordWeight(query.plus_words[terms[t].query_index]);
+    }
+    std::vector<std::pair<const PostingList*, PostingList::const_iterator>> minus_cursors;
+    for (const PostingList* postings : query.minus_postings) {
+        if (postings != nullptr && !postings->empty()) {
+            minus_cursors.push_back({postings, postings->begin()});
+        }
+    }
+    std::vector<Document> matched_documents;
+    std::vector<ScoreType<Scorer>> contributions(query.plus_words.size());
+    for (size_t k = 0; k < candidate_ids.size(); ++k) {
+        const int document_id = candidate_ids[k];
+        const PostingList::const_iterator document_posting = rarest.At(positions[0][k]);
+        if constexpr (!IS_POSTING_FILTER<DocumentPredicate>) {
+            if (!IsPostingAccepted(document_predicate, document_posting)) {
+                continue;
+            }
+        }
+        bool has_minus_word = false;
+        for (auto& [postings, it] : minus_cursors) {
+            it = postings->Seek(it, document_id);
+            if (it != postings->end() && it.DocumentId() == document_id) {
+                has_minus_word = true;
+                break;
+            }
+        }
+        if (has_minus_word || (!query.phrases.empty() && !MatchPhrases(document_id, query))) {
+            continue;
+        }
+        // суммируем в порядке слов запроса, как остальные движки
+        for (size_t t = 0; t < terms.size(); ++t) {
+            const PostingList::const_iterator it = terms[t].postings->At(positions[t][k]);
+            contributions[terms[t].query_index] = scorer.Score(inverse_document_freqs[t], it.TermFreq(), it.LengthNorm());
+        }
+        ScoreType<Scorer> relevance{};
+        for (const ScoreType<Scorer> contribution : contributions) {
+            relevance += contribution;
+        }
+        matched_documents.push_back({document_id, ScoreToRelevance(scorer, relevance), attributes_.GetRating(document_posting.Ordinal())});
     }
     return matched_documents;
 }
 //-------------------------------------------------------------------------------------------------------------
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindTopDocumentsPruned(const Query& query, DocumentPredicate document_predicate, size_t top_count,
+                                                           const Scorer& scorer, const Document* after) const
+{
+    // проверка минус-слов чередуется с проходом по спискам: отрезки фаз суммируются, запись - одна на запрос
+    PROFILE_QUERY_PHASES(phase_clock, QueryPhase::POSTINGS, QueryPhase::MINUS_WORDS, QueryPhase::TOP_K);
+    using Score = ScoreType<Scorer>;
+    struct TermCursor {
+        const PostingList* postings;
+        PostingList::const_iterator it;
+        size_t block;
+        double inverse_document_freq;
+        Score max_score;
+        size_t query_index;
+
+        bool IsAt(int document_id) const {
+            return it != postings->end() && it.DocumentId() == document_id;
+        }
+
+        Score BlockMaxScore(const Scorer& scorer) const {
+            if (block >= postings->GetBlocks().size()) {
+                return Score{};
+            }
+            const PostingList::Block& posting_block = postings->GetBlocks()[block];
+            return scorer.UpperBound(inverse_document_freq, posting_block.max_term_freq, posting_block.max_length_norm);
+        }
+    };
+    const CorpusStats corpus_stats = GetCorpusStats();
+    // при отборе по статусу или фильтру обязательные курсоры стоят только на подходящих документах
+    std::vector<TermCursor> cursors;
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        if (query.plus_postings[i] == nullptr || query.plus_postings[i]->empty()) {
+            continue;
+        }
+        const PostingList& postings = *query.plus_postings[i];
+        const double inverse_document_freq = scorer.InverseDocumentFreq(corpus_stats, postings.size()) * query.WordWeight(query.plus_words[i]);
+        cursors.push_back({&postings, SkipRejectedPostings(postings, postings.begin(), document_predicate), 0, inverse_document_freq,
+                           scorer.UpperBound(inverse_document_freq, postings.GetMaxTermFreq(), postings.GetMaxLengthNorm()), i});
+    }
+    std::vector<std::pair<const PostingList*, PostingList::const_iterator>> minus_cursors;
+    for (const PostingList* postings : query.minus_postings) {
+        if (postings != nullptr && !postings->empty()) {
+            minus_cursors.push_back({postings, postings->begin()});
+        }
+    }
+
+    // слова по возрастанию верхней границы: префикс "не обязательных" слов сам по себе до порога не дотягивает
+    std::sort(cursors.begin(), cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+        return lhs.max_score < rhs.max_score;
+    });
+    std::vector<Score> prefix_bounds(cursors.size());
+    Score bound_sum{};
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        bound_sum += cursors[i].max_score;
+        prefix_bounds[i] = bound_sum;
+    }
+
+    // документ еще может сравняться с порогом (и обойти его по рейтингу), пока его граница не ниже порога - EPSILON,
+    // второй EPSILON - запас на погрешность суммирования границ в другом порядке.
+    // Сравнения записаны как bound + slack < threshold: для целых оценок вычитание ушло бы ниже нуля
+    const Score slack = RelevanceToScoreUnits(scorer, 2 * EPSILON);
+    std::priority_queue<Score, std::vector<Score>, std::greater<Score>> top_relevances;
+    Score threshold = std::numeric_limits<Score>::has_infinity ? -std::numeric_limits<Score>::infinity()
+                                                               : std::numeric_limits<Score>::lowest();
+    size_t first_essential = 0;
+    std::vector<Document> candidates;
+    std::vector<Score> contributions(query.plus_words.size(), Score{});
+    std::vector<Score> block_prefix_bounds(cursors.size());
+
+    while (true) {
+        int document_id = std::numeric_limits<int>::max();
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            if (cursors[i].it != cursors[i].postings->end()) {
+                document_id = std::min(document_id, cursors[i].it.DocumentId());
+            }
+        }
+        if (document_id == std::numeric_limits<int>::max()) {
+            break;
+        }
+
+        if (top_relevances.size() == top_count) {
+            // все документы до конца самого короткого из текущих блоков обязательных слов
+            // ограничены суммой максимумов этих блоков - если она мала, блоки пропускаются целиком
+            Score range_bound = first_essential > 0 ? prefix_bounds[first_essential - 1] : Score{};
+            int range_last_document_id = std::numeric_limits<int>::max();
+            for (size_t i = first_essential; i < cursors.size(); ++i) {
+                TermCursor& cursor = cursors[i];
+                if (cursor.it == cursor.postings->end()) {
+                    continue;
+                }
+                cursor.block = PostingList::BlockOf(cursor.it.Index());
+                range_bound += cursor.BlockMaxScore(scorer);
+                range_last_document_id = std::min(range_last_document_id, cursor.postings->GetBlocks()[cursor.block].last_document_id);
+            }
+            if (range_bound + slack < threshold) {
+                if (range_last_document_id == std::numeric_limits<int>::max()) {
+                    break;
+                }
+                for (size_t i = first_essential; i < cursors.size(); ++i) {
+                    const PostingList& postings = *cursors[i].postings;
+                    cursors[i].it = SkipRejectedPostings(postings, postings.Seek(cursors[i].it, range_last_document_id + 1), document_predicate);
+                }
+                continue;
+            }
+        }
+
+        std::fill(contributions.begin(), contributions.end(), Score{});
+        Score partial_score{};
+        PostingList::const_iterator document_posting = cursors[first_essential].it;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            TermCursor& cursor = cursors[i];
+            if (cursor.IsAt(document_id)) {
+                document_posting = cursor.it;
+                contributions[cursor.query_index] = scorer.Score(cursor.inverse_document_freq, cursor.it.TermFreq(), cursor.it.LengthNorm());
+                partial_score += contributions[cursor.query_index];
+                cursor.it = SkipRejectedPostings(*cursor.postings, ++cursor.it, document_predicate);
+            }
+        }
+        // границы необязательных слов уточняются максимумом блока, где мог бы лежать документ
+        Score block_bound_sum{};
+        for (size_t i = 0; i < first_essential; ++i) {
+            TermCursor& cursor = cursors[i];
+            cursor.block = cursor.postings->SeekBlock(cursor.block, document_id);
+            block_bound_sum += cursor.BlockMaxScore(scorer);
+            block_prefix_bounds[i] = block_bound_sum;
+        }
+        bool is_pruned = false;
+        for (size_t i = first_essential; i-- > 0;) {
+            if (partial_score + block_prefix_bounds[i] + slack < threshold) {
+                is_pruned = true;
+                break;
+            }
+            TermCursor& cursor = cursors[i];
+            cursor.it = cursor.postings->Seek(cursor.it, document_id);
+            if (cursor.IsAt(document_id)) {
+                contributions[cursor.query_index] = scorer.Score(cursor.inverse_document_freq, cursor.it.TermFreq(), cursor.it.LengthNorm());
+                partial_score += contributions[cursor.query_index];
+            }
+        }
+        if (is_pruned || partial_score + slack < threshold) {
+            continue;
+        }
+
+        bool has_minus_word = false;
+        if (!minus_cursors.empty()) {
+            PROFILE_QUERY_PHASE_SWITCH(phase_clock, QueryPhase::MINUS_WORDS);
+            for (auto& [postings, it] : minus_cursors) {
+                it = postings->Seek(it, document_id);
+                if (it != postings->end() && it.DocumentId() == document_id) {
+                    has_minus_word = true;
+                    break;
+                }
+            }
+            PROFILE_QUERY_PHASE_SWITCH(phase_clock, QueryPhase::POSTINGS);
+        }
+        if (has_minus_word) {
+            continue;
+        }
+        if (!query.phrases.empty() && !MatchPhrases(document_id, query)) {
+            continue;
+        }
+        if constexpr (!IS_POSTING_FILTER<DocumentPredicate>) {
+            if (!IsPostingAccepted(document_predicate, document_posting)) {
+                continue;
+            }
+        }
+
+        // суммируем в порядке слов запроса, как полный перебор, чтобы релевантность совпадала побитно
+        Score relevance{};
+        for (const Score contribution : contributions) {
+            relevance += contribution;
+        }
+        const Document document{document_id, ScoreToRelevance(scorer, relevance), attributes_.GetRating(document_posting.Ordinal())};
+        // документы предыдущих страниц не участвуют и в пороге: он строится только по документам ниже курсора
+        if (after != nullptr && !IsDocumentRankedHigher(*after, document)) {
+            continue;
+        }
+        candidates.push_back(document);
+        if (top_relevances.size() < top_count) {
+            top_relevances.push(relevance);
+        } else if (relevance > top_relevances.top()) {
+            top_relevances.pop();
+            top_relevances.push(relevance);
+        }
+        if (top_relevances.size() == top_count && top_relevances.top() > threshold) {
+            threshold = top_relevances.top();
+            while (first_essential < cursors.size() && prefix_bounds[first_essential] + slack < threshold) {
+                ++first_essential;
+            }
+        }
+    }
+
+    PROFILE_QUERY_PHASE_SWITCH(phase_clock, QueryPhase::TOP_K);
+    const double threshold_relevance = ScoreToRelevance(scorer, threshold);
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [threshold_relevance](const Document& document) {
+                         return document.relevance < threshold_relevance - EPSILON;
+                     }),
+                     candidates.end());
+    std::sort(candidates.begin(), candidates.end(), IsDocumentRankedHigher);
+    if (candidates.size() > top_count) {
+        candidates.resize(top_count);
+    }
+    return candidates;
+}
+//-------------------------------------------------------------------------------------------------------------
 template <typename ExecutPolyc>
 void SearchServer::RemoveDocument(ExecutPolyc execut, int document_id){
     if(!document_ids_.count(document_id)){
@@ -228,8 +1325,20 @@ void SearchServer::RemoveDocument(ExecutPolyc execut, int document_id){
                       word_to_document_freqs_[*str_v].erase(document_id);
     });
 
+    for (const std::string_view* str_v : words_to_delete) {
+        const size_t length = word_to_document_freqs_.at(*str_v).size();
+        UpdatePostingLength(*str_v, length + 1, length);
+    }
+    posting_count_ -= words_to_delete.size();
+    total_document_length_ -= documents_.at(document_id).length;
+    attributes_.Remove(documents_.at(document_id).ordinal);
+    RemovePositionsFromIndex(document_id);
+    RemoveFingerprintFromIndex(document_id);
+
     documents_words_freqs_.erase(document_id);
     documents_.erase(document_id);
     document_ids_.erase(document_id);
+    changed_document_ids_.erase(document_id);
+    removed_document_ids_.insert(document_id);
 }
 //-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <functional>
+
+#include "stop_word_filter.h"
+#include "fingerprint.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Сколько seed перебирается для одной корзины, прежде чем начать заново с таблицей на ячейку больше */
+static const uint32_t MAX_SEED_ATTEMPTS = 1u << 20;
+//-------------------------------------------------------------------------------------------------------------
+StopWordFilter::StopWordFilter(const set<string, less<>>& words) {
+    if (words.empty()) {
+        return;
+    }
+    vector<uint64_t> hashes;
+    hashes.reserve(words.size());
+    for (const string& word : words) {
+        hashes.push_back(HashWord(word));
+        length_mask_ |= uint64_t{1} << min<size_t>(word.size(), 63);
+        const auto first_byte = static_cast<unsigned char>(word[0]);
+        first_byte_mask_[first_byte / 64] |= uint64_t{1} << (first_byte % 64);
+    }
+    words_.assign(words.begin(), words.end());
+
+    // ячеек столько же, сколько слов; если какой-то корзине не нашлось seed, таблица увеличивается на ячейку
+    for (size_t slot_count = words.size();; ++slot_count) {
+        bucket_seeds_.assign(words.size(), 0);
+        vector<vector<size_t>> buckets(bucket_seeds_.size());
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            buckets[Bucket(hashes[i])].push_back(i);
+        }
+        // большие корзины размещаются первыми, пока свободных ячеек много
+        vector<size_t> bucket_order(buckets.size());
+        for (size_t i = 0; i < bucket_order.size(); ++i) {
+            bucket_order[i] = i;
+        }
+        stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](size_t lhs, size_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        vector<int64_t> slot_word_indexes(slot_count, -1);
+        bool is_placed = true;
+        vector<size_t> slots;
+        for (size_t bucket : bucket_order) {
+            if (buckets[bucket].empty()) {
+                break;
+            }
+            uint32_t seed = 0;
+            for (; seed < MAX_SEED_ATTEMPTS; ++seed) {
+                slots.clear();
+                for (size_t word_index : buckets[bucket]) {
+                    const size_t slot = Slot(hashes[word_index], seed, slot_count);
+                    if (slot_word_indexes[slot] != -1 || find(slots.begin(), slots.end(), slot) != slots.end()) {
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (slots.size() == buckets[bucket].size()) {
+                    break;
+                }
+            }
+            if (seed == MAX_SEED_ATTEMPTS) {
+                is_placed = false;
+                break;
+            }
+            bucket_seeds_[bucket] = seed;
+            for (size_t i = 0; i < slots.size(); ++i) {
+                slot_word_indexes[slots[i]] = static_cast<int64_t>(buckets[bucket][i]);
+            }
+        }
+        if (!is_placed) {
+            continue;
+        }
+        // лишние ячейки (если таблицу пришлось увеличить) остаются пустыми, пустое слово никогда не ищется
+        slot_words_.assign(slot_count, string{});
+        for (size_t slot = 0; slot < slot_count; ++slot) {
+            if (slot_word_indexes[slot] != -1) {
+                slot_words_[slot] = words_[slot_word_indexes[slot]];
+            }
+        }
+        return;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+bool StopWordFilter::Contains(string_view word) const {
+    if (word.empty() || (length_mask_ >> min<size_t>(word.size(), 63) & 1) == 0) {
+        return false;
+    }
+    const auto first_byte = static_cast<unsigned char>(word[0]);
+    if ((first_byte_mask_[first_byte / 64] >> (first_byte % 64) & 1) == 0) {
+        return false;
+    }
+    const uint64_t hash = HashWord(word);
+    return slot_words_[Slot(hash, bucket_seeds_[Bucket(hash)], slot_words_.size())] == word;
+}
+//-------------------------------------------------------------------------------------------------------------
+uint64_t StopWordFilter::HashWord(string_view word) {
+    return hash<string_view>{}(word);
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t StopWordFilter::Slot(uint64_t hash, uint32_t seed, size_t slot_count) {
+    return Mix64(hash ^ (0x9E3779B97F4A7C15ull * (seed + 1))) % slot_count;
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t StopWordFilter::Bucket(uint64_t hash) const {
+    return Mix64(hash) % bucket_seeds_.size();
+}
+//-------------------------------------------------------------------------------------------------------------
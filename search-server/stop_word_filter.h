@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** Множество стоп-слов, собранное при создании в минимальную совершенную хеш-функцию (hash and displace):
+ *  слово i-й корзины лежит в ячейке Mix64(hash ^ seed_корзины) % size, все ячейки заняты ровно одним словом.
+ *  Проверка - фильтр по длине и первому байту, затем один хеш строки и одно сравнение */
+class StopWordFilter {
+public:
+    StopWordFilter() = default;
+
+    explicit StopWordFilter(const std::set<std::string, std::less<>>& words);
+
+    bool Contains(std::string_view word) const;
+
+    size_t size() const {
+        return words_.size();
+    }
+
+    bool empty() const {
+        return words_.empty();
+    }
+
+    std::vector<std::string>::const_iterator begin() const {
+        return words_.begin();
+    }
+
+    std::vector<std::string>::const_iterator end() const {
+        return words_.end();
+    }
+
+private:
+    /** Слова по возрастанию */
+    std::vector<std::string> words_;
+    /** Слова в порядке ячеек совершенной хеш-функции */
+    std::vector<std::string> slot_words_;
+    std::vector<uint32_t> bucket_seeds_;
+    /** Бит min(длина, 63): есть стоп-слово такой длины */
+    uint64_t length_mask_ = 0;
+    /** Бит первого байта стоп-слова */
+    std::array<uint64_t, 4> first_byte_mask_{};
+
+    static uint64_t HashWord(std::string_view word);
+
+    static size_t Slot(uint64_t hash, uint32_t seed, size_t slot_count);
+
+    size_t Bucket(uint64_t hash) const;
+};
@@ -1,4 +1,6 @@
 ﻿#include <algorithm>
+#include <array>
+#include <functional>
 #include "string_processing.h"
 using namespace std;
 //-------------------------------------------------------------------------------------------------------------
@@ -17,3 +19,136 @@ std::vector<std::string_view> SplitIntoWords(std::string_view str) {
     return result;
 }
 //-------------------------------------------------------------------------------------------------------------
+bool IsWildcardPattern(std::string_view word) {
+    return word.find_first_of("*?"sv) != word.npos;
+}
+//-------------------------------------------------------------------------------------------------------------
+bool MatchWildcard(std::string_view pattern, std::string_view word) {
+    // жадный разбор с откатом к последней '*'
+    size_t pattern_pos = 0;
+    size_t word_pos = 0;
+    size_t star_pos = pattern.npos;
+    size_t star_word_pos = 0;
+    while (word_pos < word.size()) {
+        if (pattern_pos < pattern.size() && (pattern[pattern_pos] == '?' || pattern[pattern_pos] == word[word_pos])) {
+            ++pattern_pos;
+            ++word_pos;
+        } else if (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+            star_pos = pattern_pos++;
+            star_word_pos = word_pos;
+        } else if (star_pos != pattern.npos) {
+            pattern_pos = star_pos + 1;
+            word_pos = ++star_word_pos;
+        } else {
+            return false;
+        }
+    }
+    while (pattern_pos < pattern.size() && pattern[pattern_pos] == '*') {
+        ++pattern_pos;
+    }
+    return pattern_pos == pattern.size();
+}
+//-------------------------------------------------------------------------------------------------------------
+size_t Utf8SequenceLength(char lead) {
+    const auto byte = static_cast<unsigned char>(lead);
+    if (byte >= 0xF0 && byte < 0xF8) {
+        return 4;
+    }
+    if (byte >= 0xE0 && byte < 0xF0) {
+        return 3;
+    }
+    if (byte >= 0xC0 && byte < 0xE0) {
+        return 2;
+    }
+    return 1;
+}
+//-------------------------------------------------------------------------------------------------------------
+std::u32string DecodeUtf8(std::string_view str) {
+    u32string result;
+    result.reserve(str.size());
+    while (!str.empty()) {
+        const size_t length = Utf8SequenceLength(str[0]);
+        const auto lead = static_cast<unsigned char>(str[0]);
+        if (length == 1 || length > str.size()) {
+            result.push_back(lead);
+            str.remove_prefix(1);
+            continue;
+        }
+        char32_t code_point = lead & (0x7F >> length);
+        for (size_t i = 1; i < length; ++i) {
+            code_point = (code_point << 6) | (static_cast<unsigned char>(str[i]) & 0x3F);
+        }
+        result.push_back(code_point);
+        str.remove_prefix(length);
+    }
+    return result;
+}
+//-------------------------------------------------------------------------------------------------------------
+void AppendUtf8(char32_t code_point, std::string& out) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+std::string EncodeUtf8(char32_t code_point) {
+    string result;
+    AppendUtf8(code_point, result);
+    return result;
+}
+//-------------------------------------------------------------------------------------------------------------
+void RemoveDuplicateWords(std::vector<std::string_view>& words) {
+    if (words.size() < 2) {
+        return;
+    }
+    // таблица индексов в words, заполнена не больше чем наполовину; для коротких запросов - на стеке
+    constexpr size_t STACK_TABLE_SIZE = 256;
+    size_t table_size = 4;
+    while (table_size < words.size() * 2) {
+        table_size *= 2;
+    }
+    std::array<uint32_t, STACK_TABLE_SIZE> stack_table;
+    std::vector<uint32_t> heap_table;
+    uint32_t* table = stack_table.data();
+    if (table_size > STACK_TABLE_SIZE) {
+        heap_table.resize(table_size);
+        table = heap_table.data();
+    }
+    constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+    std::fill(table, table + table_size, EMPTY_SLOT);
+    std::vector<size_t> hashes;
+    hashes.reserve(words.size());
+
+    size_t unique_count = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        const size_t hash = std::hash<std::string_view>{}(words[i]);
+        size_t slot = hash & (table_size - 1);
+        bool is_duplicate = false;
+        while (table[slot] != EMPTY_SLOT) {
+            if (hashes[table[slot]] == hash && words[table[slot]] == words[i]) {
+                is_duplicate = true;
+                break;
+            }
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (is_duplicate) {
+            continue;
+        }
+        table[slot] = static_cast<uint32_t>(unique_count);
+        hashes.push_back(hash);
+        words[unique_count++] = words[i];
+    }
+    words.resize(unique_count);
+}
+//-------------------------------------------------------------------------------------------------------------
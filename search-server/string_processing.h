@@ -7,6 +7,26 @@
 //-------------------------------------------------------------------------------------------------------------
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 //-------------------------------------------------------------------------------------------------------------
+/** Шаблон слова: '*' - любая последовательность символов, '?' - ровно один символ */
+bool IsWildcardPattern(std::string_view word);
+//-------------------------------------------------------------------------------------------------------------
+bool MatchWildcard(std::string_view pattern, std::string_view word);
+//-------------------------------------------------------------------------------------------------------------
+/** Длина UTF-8 последовательности по первому байту; для байта продолжения и неверного байта - 1 */
+size_t Utf8SequenceLength(char lead);
+//-------------------------------------------------------------------------------------------------------------
+/** Кодовые точки UTF-8 строки, неверные байты передаются как есть (по одному на кодовую точку) */
+std::u32string DecodeUtf8(std::string_view str);
+//-------------------------------------------------------------------------------------------------------------
+/** Дописывает кодовую точку в UTF-8 в конец out, без отдельной строки на каждый символ */
+void AppendUtf8(char32_t code_point, std::string& out);
+//-------------------------------------------------------------------------------------------------------------
+std::string EncodeUtf8(char32_t code_point);
+//-------------------------------------------------------------------------------------------------------------
+/** Удаляет повторы слов, сохраняя порядок первых вхождений. Повторы ищутся в маленькой хеш-таблице
+ *  с открытой адресацией, строки сравниваются только при совпадении хешей */
+void RemoveDuplicateWords(std::vector<std::string_view>& words);
+//-------------------------------------------------------------------------------------------------------------
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
     std::set<std::string, std::less<>> non_empty_strings;
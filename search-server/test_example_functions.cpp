@@ -1,8 +1,23 @@
 ﻿#include <iterator>
 #include <execution>
+#include <filesystem>
+#include <random>
+#include <sstream>
+#include <thread>
 #include "test_example_functions.h"
 #include "remove_duplicates.h"
 #include "search_server.h"
+#include "index_checkpoint.h"
+#include "corpus_generator.h"
+#include "latency_histogram.h"
+#include "levenshtein_automaton.h"
+#include "paginator.h"
+#include "perf_counters.h"
+#include "posting_intersection.h"
+#include "query_statistics.h"
+#include "request_queue.h"
+#include "stop_word_filter.h"
+#include "text_analyzer.h"
 //-------------------------------------------------------------------------------------------------------------
 void AssertImpl(bool value, const std::string& expr_str, const std::string& file, const std::string& func, unsigned line,
                 const std::string& hint) {
@@ -84,6 +99,13 @@ void TestMatchDocuments() {
         const auto& [vec, _] = server.MatchDocument("dog"s, doc_id);
         ASSERT(vec.empty());
     }
+    // параллельная версия находит те же слова, повторы и отсутствующие в словаре слова отбрасываются
+    {
+        const auto& [vec, _] = server.MatchDocument(std::execution::par, "dog city cat city"s, doc_id);
+        ASSERT(vec == std::vector<std::string_view>({"cat", "city"}));
+        const auto& [minus_vec, __] = server.MatchDocument(std::execution::par, "cat -dog -city"s, doc_id);
+        ASSERT(minus_vec.empty());
+    }
 }
 //-------------------------------------------------------------------------------------------------------------
 void TestSortRelevancsDocument() {
@@ -296,7 +318,7 @@ void TestRemoveDuplicat() {
        server.AddDocument(doc_id5, content4, DocumentStatus::ACTUAL, ratings);
 
        ASSERT(server.GetDocumentCount() == 5);
-       RemoveDuplicates(server);
+       ASSERT(RemoveDuplicates(server) == std::vector<int>({doc_id4, doc_id5}));
        ASSERT(server.GetDocumentCount() == 3);
    }
 }
@@ -335,6 +357,1493 @@ SearchServer search_server("and with"s);
     ASSERT(search_server.FindTopDocuments(query).size() == 1);
 }
 //-------------------------------------------------------------------------------------------------------------
+void TestMemoryStats() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    {
+        const IndexMemoryStats stats = server.MemoryStats();
+        ASSERT_EQUAL(stats.term_count, 6u);
+        ASSERT_EQUAL(stats.posting_count, 7u);
+        ASSERT_EQUAL(stats.words.element_count, 6u);
+        ASSERT_EQUAL(stats.documents.element_count, 2u);
+        ASSERT_EQUAL(stats.document_ids.element_count, 2u);
+        // curly - 2 документа, остальные по одному
+        ASSERT_EQUAL(stats.posting_length_histogram[PostingLengthBucket(1)], 5u);
+        ASSERT_EQUAL(stats.posting_length_histogram[PostingLengthBucket(2)], 1u);
+        ASSERT_EQUAL(stats.dead_term_count, 0u);
+        ASSERT(stats.TotalAllocatedBytes() >= stats.TotalPayloadBytes());
+    }
+    server.RemoveDocument(std::execution::par, 2);
+    {
+        const IndexMemoryStats stats = server.MemoryStats();
+        ASSERT_EQUAL(stats.posting_count, 3u);
+        // dog, fancy, collar остались без документов
+        ASSERT_EQUAL(stats.dead_term_count, 3u);
+        ASSERT(stats.dead_bytes > 0);
+        ASSERT(stats.posting_slack_bytes > 0);
+        ASSERT_EQUAL(stats.documents.element_count, 1u);
+    }
+    server.AddDocument(3, "fancy dog"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.MemoryStats().dead_term_count, 1u);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestIndexCheckpoint() {
+    const std::string path_prefix = (std::filesystem::temp_directory_path() / "search_server_test_checkpoint").string();
+    SearchServer server("and with"s);
+    IndexCheckpointer checkpointer(server, path_prefix, 2);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::BANNED, {3});
+    checkpointer.Checkpoint(); // первый раз всегда полный снимок
+    ASSERT_EQUAL(checkpointer.GetDeltaCount(), 0);
+    ASSERT(!server.HasChanges());
+
+    server.AddDocument(3, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {5});
+    server.RemoveDocument(1);
+    checkpointer.Checkpoint();
+    ASSERT_EQUAL(checkpointer.GetDeltaCount(), 1);
+
+    server.AddDocument(1, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {4});
+    checkpointer.Checkpoint();
+    ASSERT_EQUAL(checkpointer.GetDeltaCount(), 2);
+
+    {
+        SearchServer restored("and with"s);
+        IndexCheckpointer restorer(restored, path_prefix, 2);
+        restorer.Restore();
+        ASSERT_EQUAL(restorer.GetDeltaCount(), 2);
+        ASSERT_EQUAL(restored.GetDocumentCount(), 3);
+        for (int id : server) {
+            ASSERT(restored.GetWordFrequencies(id) == server.GetWordFrequencies(id));
+        }
+        const auto expected = server.FindTopDocuments("curly rat"s);
+        const auto found = restored.FindTopDocuments("curly rat"s);
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].rating, expected[i].rating);
+        }
+        ASSERT_EQUAL(restored.FindTopDocuments("curly"s, DocumentStatus::BANNED).size(), SINGL_RSLT);
+    }
+
+    // после deltas_per_snapshot дельт цепочка сворачивается в снимок
+    const std::string stale_delta_path = path_prefix + ".stale"s;
+    std::filesystem::copy_file(path_prefix + ".delta.1"s, stale_delta_path,
+                               std::filesystem::copy_options::overwrite_existing);
+    server.RemoveDocument(2);
+    checkpointer.Checkpoint();
+    ASSERT_EQUAL(checkpointer.GetDeltaCount(), 0);
+    ASSERT(!std::filesystem::exists(path_prefix + ".delta.1"s));
+    {
+        SearchServer restored("and with"s);
+        IndexCheckpointer restorer(restored, path_prefix);
+        restorer.Restore();
+        ASSERT_EQUAL(restored.GetDocumentCount(), 2);
+        ASSERT(restored.FindTopDocuments("curly"s, DocumentStatus::BANNED).empty());
+    }
+
+    // сбой между подменой снимка и удалением дельт: дельта прежнего поколения не применяется
+    std::filesystem::copy_file(stale_delta_path, path_prefix + ".delta.1"s);
+    {
+        SearchServer restored("and with"s);
+        IndexCheckpointer restorer(restored, path_prefix);
+        restorer.Restore();
+        ASSERT_EQUAL(restorer.GetDeltaCount(), 0);
+        ASSERT_EQUAL(restored.GetDocumentCount(), 2);
+        ASSERT(restored.FindTopDocuments("funny"s).empty());
+    }
+
+    // новый объект без Restore пишет снимок следующего поколения и удаляет все старые дельты
+    std::filesystem::copy_file(stale_delta_path, path_prefix + ".delta.2"s);
+    {
+        IndexCheckpointer fresh(server, path_prefix);
+        fresh.Checkpoint();
+        ASSERT(!std::filesystem::exists(path_prefix + ".delta.1"s));
+        ASSERT(!std::filesystem::exists(path_prefix + ".delta.2"s));
+        server.AddDocument(4, "funny rat"s, DocumentStatus::ACTUAL, {1});
+        fresh.Checkpoint();
+        ASSERT_EQUAL(fresh.GetDeltaCount(), 1);
+
+        SearchServer restored("and with"s);
+        IndexCheckpointer restorer(restored, path_prefix);
+        restorer.Restore();
+        ASSERT_EQUAL(restorer.GetDeltaCount(), 1);
+        ASSERT_EQUAL(restored.GetDocumentCount(), 3);
+    }
+    std::filesystem::remove(stale_delta_path);
+    std::filesystem::remove(path_prefix + ".delta.1"s);
+    std::filesystem::remove(path_prefix + ".snapshot"s);
+
+    // обрезанный снимок: недочитанный документ не попадает в индекс даже частично
+    {
+        SearchServer source("and with"s);
+        source.AddDocument(1, "funny pet"s, DocumentStatus::ACTUAL, {1});
+        source.AddDocument(2, "curly hair zebra"s, DocumentStatus::ACTUAL, {2});
+        std::stringstream snapshot;
+        source.SaveSnapshot(snapshot);
+        std::string truncated = snapshot.str();
+        truncated.pop_back();
+        std::istringstream truncated_snapshot(truncated);
+        SearchServer restored("and with"s);
+        try {
+            restored.LoadSnapshot(truncated_snapshot);
+            ASSERT_HINT(false, "truncated snapshot must throw"s);
+        } catch (const std::runtime_error&) {
+        }
+        ASSERT_EQUAL(restored.GetDocumentCount(), 1);
+        ASSERT(restored.FindTopDocuments("curly hair"s).empty());
+        ASSERT_EQUAL(restored.FindTopDocuments("funny"s).size(), SINGL_RSLT);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestPrunedTopDocuments() {
+    std::mt19937 generator(7);
+    std::vector<std::string> dictionary;
+    for (int i = 0; i < 60; ++i) {
+        dictionary.push_back("w"s + std::to_string(i));
+    }
+    // частые слова в начале словаря, чтобы у слов были и длинные, и короткие списки
+    auto random_word = [&]() -> const std::string& {
+        const int a = std::uniform_int_distribution<int>(0, dictionary.size() - 1)(generator);
+        const int b = std::uniform_int_distribution<int>(0, dictionary.size() - 1)(generator);
+        return dictionary[std::min(a, b)];
+    };
+    SearchServer server("w1"s);
+    for (int id = 0; id < 2000; ++id) {
+        std::string text;
+        const int word_count = std::uniform_int_distribution<int>(1, 12)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        const auto status = static_cast<DocumentStatus>(std::uniform_int_distribution<int>(0, 3)(generator));
+        server.AddDocument(id * 3, text, status, {std::uniform_int_distribution<int>(-5, 5)(generator)});
+    }
+    for (int q = 0; q < 200; ++q) {
+        std::string query;
+        const int word_count = std::uniform_int_distribution<int>(1, 8)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            query += (std::uniform_int_distribution<int>(0, 9)(generator) == 0 ? "-"s : ""s) + random_word() + " "s;
+        }
+        const auto check = [](const std::vector<Document>& found, const std::vector<Document>& expected) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT(std::abs(found[i].relevance - expected[i].relevance) < EPSILON);
+                ASSERT_EQUAL(found[i].rating, expected[i].rating);
+            }
+        };
+        check(server.FindTopDocuments(query), server.FindTopDocuments(std::execution::par, query));
+        const auto predicate = [](int document_id, DocumentStatus status, int rating) {
+            return document_id % 2 == 0 && status != DocumentStatus::BANNED && rating > -3;
+        };
+        check(server.FindTopDocuments(query, predicate), server.FindTopDocuments(std::execution::par, query, predicate));
+        const Bm25Scorer bm25(1.5, 0.6);
+        check(server.FindTopDocuments(std::execution::seq, query, predicate, bm25),
+              server.FindTopDocuments(std::execution::par, query, predicate, bm25));
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestPostingListBlocks() {
+    PostingList postings;
+    // четные id по возрастанию, затем нечетные вставками в середину
+    for (int id = 0; id < 400; id += 2) {
+        postings.Add(id, id, 0.25, 1, DocumentStatus::ACTUAL);
+    }
+    for (int id = 399; id > 0; id -= 2) {
+        postings.Add(id, id, id == 201 ? 0.75 : 0.5, 1, DocumentStatus::ACTUAL);
+    }
+    postings.Add(10, 10, 0.5, 1, DocumentStatus::ACTUAL);
+    ASSERT_EQUAL(postings.size(), 400u);
+    ASSERT_EQUAL(postings.GetBlocks().size(), (400 + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE);
+    ASSERT_EQUAL(postings.GetMaxTermFreq(), 0.75);
+    ASSERT_EQUAL(postings.find(10).TermFreq(), 0.75);
+    for (size_t block = 0; block < postings.GetBlocks().size(); ++block) {
+        const size_t last = std::min(postings.size(), (block + 1) * POSTING_BLOCK_SIZE) - 1;
+        ASSERT_EQUAL(postings.GetBlocks()[block].last_document_id, static_cast<int>(last));
+    }
+
+    auto it = postings.Seek(postings.begin(), 150);
+    ASSERT_EQUAL(it.DocumentId(), 150);
+    ASSERT(postings.Seek(it, 1000) == postings.end());
+
+    postings.erase(201);
+    postings.erase(10);
+    ASSERT_EQUAL(postings.size(), 398u);
+    ASSERT_EQUAL(postings.GetMaxTermFreq(), 0.5);
+    ASSERT(postings.find(201) == postings.end());
+    ASSERT_EQUAL(postings.Seek(postings.begin(), 201).DocumentId(), 202);
+    int previous = -1;
+    for (const auto& [document_id, _] : postings) {
+        ASSERT(document_id > previous);
+        previous = document_id;
+    }
+
+    // удаленная запись оживает при повторном добавлении, пачка удалений уплотняет массивы
+    postings.Add(201, 201, 0.25, 1, DocumentStatus::BANNED);
+    ASSERT_EQUAL(postings.size(), 399u);
+    ASSERT(postings.find(201).Status() == DocumentStatus::BANNED);
+    std::vector<int> even_ids;
+    for (int id = 0; id < 400; id += 2) {
+        even_ids.push_back(id);
+    }
+    ASSERT_EQUAL(postings.EraseDocuments(even_ids), 199u);
+    ASSERT_EQUAL(postings.StoredSize(), postings.size());
+    ASSERT_EQUAL(postings.SkipToStatus(postings.begin(), StatusBit(DocumentStatus::BANNED)).DocumentId(), 201);
+
+    // документы по убыванию id и удаления вперемешку с поиском
+    SearchServer server(""s);
+    for (int id = 200; id > 0; --id) {
+        server.AddDocument(id, id % 2 == 1 ? "cat dog"s : "cat"s, DocumentStatus::ACTUAL, {1});
+    }
+    for (int id = 1; id <= 200; id += 4) {
+        server.RemoveDocument(id);
+    }
+    const auto found = server.FindTopDocuments("cat dog"s, QueryMode::ALL);
+    ASSERT_EQUAL(found.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    for (const Document& document : found) {
+        ASSERT(document.id % 4 == 3);
+    }
+    server.AddDocument(5, "dog"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("cat dog"s, 5)).size(), 1u);
+
+    // максимум держится, пока в списке есть хоть одна равная ему частота
+    PostingList ties;
+    ties.Add(1, 1, 0.5, 3, DocumentStatus::ACTUAL);
+    ties.Add(2, 2, 0.5, 1, DocumentStatus::ACTUAL);
+    ties.Add(3, 3, 0.25, 7, DocumentStatus::ACTUAL);
+    ties.erase(1);
+    ASSERT_EQUAL(ties.GetMaxTermFreq(), 0.5);
+    ASSERT_EQUAL(static_cast<int>(ties.GetMaxLengthNorm()), 7);
+    ties.erase(2);
+    ASSERT_EQUAL(ties.GetMaxTermFreq(), 0.25);
+    ties.EraseDocuments({3});
+    ASSERT_EQUAL(ties.GetMaxTermFreq(), 0.0);
+    ASSERT_EQUAL(static_cast<int>(ties.GetMaxLengthNorm()), 0);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestPhraseQuery() {
+    SearchServer server("and in"s);
+    server.EnablePositionalIndex();
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(2, "cat curly dog"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(3, "curly and cat"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "big cat"s, DocumentStatus::ACTUAL, {1});
+    {
+        const auto found_docs = server.FindTopDocuments("\"curly cat\""s);
+        ASSERT_EQUAL(found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(found_docs[0].id, 1);
+        const auto par_found_docs = server.FindTopDocuments(std::execution::par, "\"curly cat\""s);
+        ASSERT_EQUAL(par_found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(par_found_docs[0].id, 1);
+    }
+    {
+        // фраза - обязательное условие, остальные слова влияют только на релевантность
+        const auto found_docs = server.FindTopDocuments("dog \"curly cat\" big"s);
+        ASSERT_EQUAL(found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(found_docs[0].id, 1);
+        ASSERT(found_docs[0].relevance > 0);
+    }
+    {
+        // стоп-слово внутри фразы занимает позицию
+        const auto found_docs = server.FindTopDocuments("\"curly and cat\""s);
+        ASSERT_EQUAL(found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(found_docs[0].id, 3);
+        ASSERT(server.FindTopDocuments("\"cat curly\" -dog"s).size() == SINGL_RSLT);
+    }
+    {
+        const auto& [words, _] = server.MatchDocument("\"curly cat\""s, 2);
+        ASSERT(words.empty());
+        const auto& [words1, _1] = server.MatchDocument(std::execution::par, "\"curly cat\" tail"s, 1);
+        ASSERT_EQUAL(words1.size(), 3u);
+    }
+    {
+        std::stringstream snapshot;
+        server.SaveSnapshot(snapshot);
+        SearchServer restored("and in"s);
+        restored.EnablePositionalIndex();
+        restored.LoadSnapshot(snapshot);
+        ASSERT_EQUAL(restored.FindTopDocuments("\"curly and cat\""s).size(), SINGL_RSLT);
+        ASSERT(restored.MemoryStats().positions.element_count > 0);
+    }
+    {
+        const std::vector<uint32_t> positions = {0, 1, 300, 70000, 4294967295u};
+        ASSERT(DecodePositions(EncodePositions(positions)) == positions);
+        // varint длиннее 32 бит и оборванный varint не раскодируются
+        for (const std::vector<uint8_t>& malformed : {std::vector<uint8_t>{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01},
+                                                      std::vector<uint8_t>{0x05, 0x80}}) {
+            try {
+                DecodePositions(malformed);
+                ASSERT_HINT(false, "malformed positions must be rejected"s);
+            } catch (const std::invalid_argument&) {
+            }
+        }
+        // такой же блок в контрольной точке отвергается при загрузке, до изменения индекса
+        SearchServer source(""s);
+        source.EnablePositionalIndex();
+        source.AddDocument(1, "cat cat cat cat cat cat cat cat"s, DocumentStatus::ACTUAL, {1});
+        std::stringstream snapshot;
+        source.SaveSnapshot(snapshot);
+        std::string corrupted = snapshot.str();
+        // запись кончается размером блока позиций (4 байта) и самим блоком (8 байт)
+        corrupted.resize(corrupted.size() - 12);
+        const uint32_t corrupted_size = 7;
+        corrupted.append(reinterpret_cast<const char*>(&corrupted_size), sizeof(corrupted_size));
+        corrupted.append("\xFF\xFF\xFF\xFF\xFF\xFF\x01"s);
+        std::istringstream corrupted_snapshot(corrupted);
+        SearchServer restored(""s);
+        restored.EnablePositionalIndex();
+        try {
+            restored.LoadSnapshot(corrupted_snapshot);
+            ASSERT_HINT(false, "malformed positions in checkpoint must be rejected"s);
+        } catch (const std::runtime_error&) {
+        }
+        ASSERT_EQUAL(restored.GetDocumentCount(), 0);
+    }
+    SearchServer plain(""s);
+    plain.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    try {
+        plain.FindTopDocuments("\"curly cat\""s);
+        ASSERT_HINT(false, "phrase without positional index"s);
+    } catch (const std::invalid_argument&) {
+    }
+    ASSERT_EQUAL(plain.FindTopDocuments("\"cat\""s).size(), SINGL_RSLT);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestWildcardQuery() {
+    ASSERT(MatchWildcard("c*t"s, "cart"s));
+    ASSERT(MatchWildcard("c?t*"s, "cats"s));
+    ASSERT(!MatchWildcard("c?t"s, "cart"s));
+    ASSERT(MatchWildcard("*"s, ""s));
+
+    SearchServer server(""s);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "catalog"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "category cat"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "cart"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "dog"s, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL(server.FindTopDocuments("cat*"s).size(), 3u);
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "cat*"s).size(), 3u);
+    ASSERT_EQUAL(server.FindTopDocuments("c*t"s).size(), 3u);
+    {
+        const auto found_docs = server.FindTopDocuments("ca?t"s);
+        ASSERT_EQUAL(found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(found_docs[0].id, 4);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("c* -cat*"s).size(), SINGL_RSLT);
+    {
+        const auto& [words, _] = server.MatchDocument("cat* dog"s, 3);
+        ASSERT_EQUAL(words.size(), 2u);
+    }
+    // при ограничении остается слово, встречающееся в наибольшем числе документов
+    server.SetMaxTermExpansions(1);
+    {
+        const auto found_docs = server.FindTopDocuments("cat*"s);
+        ASSERT_EQUAL(found_docs.size(), 2u);
+        ASSERT(found_docs[0].id == 1 || found_docs[0].id == 3);
+    }
+    server.RemoveDocument(2);
+    ASSERT(server.FindTopDocuments("catal*"s).empty());
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestFuzzyQuery() {
+    {
+        const LevenshteinAutomaton automaton("кошка"s, 1);
+        auto state = automaton.Start();
+        const std::string word = "кощка"s;
+        for (size_t i = 1; i <= word.size(); ++i) {
+            state = automaton.StepByte(state, std::string_view(word).substr(0, i));
+        }
+        ASSERT(automaton.IsMatch(state));
+        ASSERT_EQUAL(automaton.Distance(state), 1);
+    }
+
+    SearchServer server("and"s);
+    server.AddDocument(1, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "fluffy dog and collar"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "кошка"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "cart horse"s, DocumentStatus::ACTUAL, {4});
+    ASSERT(server.FindTopDocuments("cst"s).empty());
+
+    server.SetFuzzyMaxEdits(1);
+    {
+        const auto found_docs = server.FindTopDocuments("cst"s);
+        ASSERT_EQUAL(found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(found_docs[0].id, 1);
+    }
+    // cat найден точно, cart - с одной правкой
+    {
+        const auto found_docs = server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(found_docs.size(), 2u);
+        ASSERT_EQUAL(found_docs[0].id, 1);
+        ASSERT(std::abs(found_docs[1].relevance - found_docs[0].relevance * FUZZY_EDIT_PENALTY) < EPSILON);
+        const auto par_docs = server.FindTopDocuments(std::execution::par, "cat"s);
+        ASSERT_EQUAL(par_docs.size(), 2u);
+        ASSERT(std::abs(par_docs[1].relevance - found_docs[1].relevance) < EPSILON);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("кощка"s).size(), SINGL_RSLT);
+    ASSERT(server.FindTopDocuments("dgo"s).empty());
+    ASSERT(server.FindTopDocuments("cat -crt"s).size() == 2u);
+    {
+        const auto& [words, _] = server.MatchDocument("fluffi"s, 2);
+        ASSERT_EQUAL(words.size(), SINGL_RSLT);
+        ASSERT_EQUAL(words[0], "fluffy"s);
+    }
+
+    server.SetFuzzyMaxEdits(2);
+    ASSERT_EQUAL(server.FindTopDocuments("dgo"s).size(), SINGL_RSLT);
+    try {
+        server.SetFuzzyMaxEdits(3);
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestBm25Scorer() {
+    for (size_t length = 0; length < 100000; length += 1 + length / 100) {
+        const size_t decoded = DecodeDocumentLength(EncodeDocumentLength(length));
+        ASSERT(decoded <= length);
+        ASSERT(length < 128 ? decoded == length : decoded * 16 > length * 15 || length >= (size_t{1} << 15));
+        ASSERT(EncodeDocumentLength(length) <= EncodeDocumentLength(length + 1));
+    }
+
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat cat bird fish"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "dog"s, DocumentStatus::ACTUAL, {3});
+    const double k1 = 1.2;
+    const double b = 0.75;
+    const double average_length = 7.0 / 3;
+    const double idf = std::log(1.0 + (3 - 2 + 0.5) / (2 + 0.5));
+    const auto bm25 = [&](double count, double length) {
+        return idf * count * (k1 + 1) / (count + k1 * (1 - b + b * length / average_length));
+    };
+    const auto found_docs = server.FindTopDocuments(std::execution::seq, "cat"s, DocumentStatus::ACTUAL, Bm25Scorer(k1, b));
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    ASSERT_EQUAL(found_docs[0].id, 2);
+    ASSERT(std::abs(found_docs[0].relevance - bm25(2, 4)) < EPSILON);
+    ASSERT(std::abs(found_docs[1].relevance - bm25(1, 2)) < EPSILON);
+    // по TF-IDF частоты cat в документах равны (1/2), выше документ с большим рейтингом
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s)[0].id, 2);
+    try {
+        Bm25Scorer(1.2, 1.5);
+        ASSERT(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestDocumentStatusChange() {
+    SearchServer server(""s);
+    // несколько блоков без ACTUAL документов перед единственным ACTUAL
+    for (int id = 0; id < 300; ++id) {
+        server.AddDocument(id, "cat"s, id == 250 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED, {id});
+    }
+    {
+        const auto found_docs = server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(found_docs[0].id, 250);
+        ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, "cat"s).size(), SINGL_RSLT);
+    }
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::REMOVED).empty());
+
+    server.ResetChangeTracking();
+    server.SetDocumentStatus(10, DocumentStatus::ACTUAL);
+    server.SetDocumentStatus(250, DocumentStatus::REMOVED);
+    ASSERT(server.HasChanges());
+    {
+        const auto found_docs = server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(found_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(found_docs[0].id, 10);
+        const auto par_docs = server.FindTopDocuments(std::execution::par, "cat"s);
+        ASSERT_EQUAL(par_docs.size(), SINGL_RSLT);
+        ASSERT_EQUAL(par_docs[0].id, 10);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s, DocumentStatus::REMOVED)[0].id, 250);
+    ASSERT(std::get<1>(server.MatchDocument("cat"s, 250)) == DocumentStatus::REMOVED);
+    // произвольный предикат видит новый статус
+    const auto found_docs = server.FindTopDocuments("cat"s, [](int, DocumentStatus status, int) {
+        return status != DocumentStatus::BANNED;
+    });
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    try {
+        server.SetDocumentStatus(1000, DocumentStatus::ACTUAL);
+        ASSERT(false);
+    } catch (const std::out_of_range&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestDocumentFilter() {
+    std::mt19937 generator(11);
+    DocumentAttributeStore attributes;
+    for (int i = 0; i < 300; ++i) {
+        const int rating = std::uniform_int_distribution<int>(-20, 20)(generator);
+        attributes.Add(i == 7 ? std::numeric_limits<int>::min() : rating,
+                       static_cast<DocumentStatus>(std::uniform_int_distribution<int>(0, 3)(generator)));
+    }
+    attributes.Remove(5);
+    ASSERT_EQUAL(attributes.Add(100, DocumentStatus::ACTUAL), 5u);
+    ASSERT_EQUAL(attributes.GetOrdinalCount(), 300u);
+
+    std::vector<int32_t> many_values;
+    for (int value = -20; value <= 20; value += 3) {
+        many_values.push_back(value);
+    }
+    const auto filter = DocumentFilter()
+                            .Range(DocumentAttribute::RATING, -10, std::numeric_limits<int32_t>::max())
+                            .StatusIn({DocumentStatus::ACTUAL, DocumentStatus::BANNED});
+    const auto set_filter = DocumentFilter().In(DocumentAttribute::RATING, many_values);
+    const FilterBitmap bitmap = filter.Evaluate(attributes);
+    const FilterBitmap set_bitmap = set_filter.Evaluate(attributes);
+    size_t expected_count = 0;
+    for (uint32_t ordinal = 0; ordinal < 300; ++ordinal) {
+        const int rating = attributes.GetRating(ordinal);
+        const DocumentStatus status = attributes.GetStatus(ordinal);
+        const bool is_match = rating >= -10 && (status == DocumentStatus::ACTUAL || status == DocumentStatus::BANNED);
+        expected_count += is_match;
+        ASSERT_EQUAL(bitmap.Contains(ordinal), is_match);
+        ASSERT_EQUAL(set_bitmap.Contains(ordinal),
+                     std::find(many_values.begin(), many_values.end(), rating) != many_values.end());
+    }
+    ASSERT_EQUAL(bitmap.Count(), expected_count);
+    ASSERT_EQUAL(DocumentFilter().Range(DocumentAttribute::RATING, 1, 0).Evaluate(attributes).Count(), 0u);
+
+    SearchServer server(""s);
+    for (int id = 0; id < 300; ++id) {
+        const int rating = std::uniform_int_distribution<int>(-20, 20)(generator);
+        const auto status = static_cast<DocumentStatus>(std::uniform_int_distribution<int>(0, 3)(generator));
+        server.AddDocument(id * 2, "cat "s + std::to_string(id % 7), status, {rating});
+    }
+    server.RemoveDocument(10);
+    server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {15});
+    const auto predicate = [](int, DocumentStatus status, int rating) {
+        return rating >= -10 && (status == DocumentStatus::ACTUAL || status == DocumentStatus::BANNED);
+    };
+    for (const std::string& query : {"cat"s, "cat 3"s}) {
+        const auto expected = server.FindTopDocuments(query, predicate);
+        for (const auto& found : {server.FindTopDocuments(query, filter), server.FindTopDocuments(std::execution::par, query, filter)}) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT(std::abs(found[i].relevance - expected[i].relevance) < EPSILON);
+                ASSERT_EQUAL(found[i].rating, expected[i].rating);
+            }
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestNearDuplicates() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat fluffy tail collar"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "white cat fluffy tail collar bell"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "collar and tail and fluffy cat white"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "black dog long ears"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "black dog short ears"s, DocumentStatus::ACTUAL, {5});
+
+    // пакетное удаление пропускает несуществующие и повторяющиеся id
+    {
+        SearchServer copy("and"s);
+        for (int id : server) {
+            copy.AddDocument(id + 10, "white cat"s, DocumentStatus::ACTUAL, {1});
+        }
+        copy.RemoveDocuments({11, 13, 13, 100});
+        ASSERT_EQUAL(copy.GetDocumentCount(), 3);
+        ASSERT_EQUAL(copy.FindTopDocuments("cat"s).size(), 3u);
+        ASSERT(copy.GetWordFrequencies(11).empty());
+    }
+
+    // 2 отличается от 1 одним словом: сходство 5/6, 5 и 4: 3/5 - ниже порога
+    const std::vector<int> removed = RemoveNearDuplicates(server, 0.8);
+    ASSERT(removed == (std::vector<int>{2, 3}));
+    ASSERT_EQUAL(server.GetDocumentCount(), 3);
+    ASSERT_EQUAL(server.FindTopDocuments("bell"s).size(), 0u);
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s).size(), 2u);
+    ASSERT_EQUAL(server.MemoryStats().posting_count, 5u + 4u + 4u);
+
+    try {
+        RemoveNearDuplicates(server, 0.0);
+        ASSERT_HINT(false, "threshold must be positive"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestDuplicatePolicy() {
+    const int invalid_id = SearchServer::INVALID_DOCUMENT_ID;
+    {
+        SearchServer server("and"s);
+        server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+        // индекс отпечатков строится по уже добавленным документам
+        server.SetDuplicatePolicy(DuplicatePolicy::REJECT);
+        ASSERT_EQUAL(server.AddDocument(2, "dog cat cat"s, DocumentStatus::ACTUAL, {2}), 1);
+        ASSERT_EQUAL(server.GetDocumentCount(), 1);
+        ASSERT_EQUAL(server.AddDocument(3, "dog cat bird"s, DocumentStatus::ACTUAL, {3}), invalid_id);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+        // после удаления документа его набор слов снова можно добавить
+        server.RemoveDocument(1);
+        ASSERT_EQUAL(server.AddDocument(4, "cat dog"s, DocumentStatus::ACTUAL, {4}), invalid_id);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    }
+    {
+        SearchServer server("and"s);
+        server.SetDuplicatePolicy(DuplicatePolicy::REPLACE);
+        server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_EQUAL(server.AddDocument(2, "dog cat"s, DocumentStatus::BANNED, {5}), 1);
+        ASSERT_EQUAL(server.GetDocumentCount(), 1);
+        ASSERT_EQUAL(*server.begin(), 2);
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).size(), 1u);
+    }
+    {
+        SearchServer server("and"s);
+        server.SetDuplicatePolicy(DuplicatePolicy::REPORT);
+        server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_EQUAL(server.AddDocument(2, "dog cat"s, DocumentStatus::ACTUAL, {1}), 1);
+        ASSERT_EQUAL(server.GetDocumentCount(), 2);
+        // второй экземпляр остается в индексе отпечатков после удаления первого
+        server.RemoveDocument(1);
+        ASSERT_EQUAL(server.AddDocument(3, "cat dog"s, DocumentStatus::ACTUAL, {1}), 2);
+        server.SetDuplicatePolicy(DuplicatePolicy::ALLOW);
+        ASSERT_EQUAL(server.AddDocument(4, "cat dog"s, DocumentStatus::ACTUAL, {1}), invalid_id);
+        ASSERT_EQUAL(server.GetDocumentCount(), 3);
+        // дубликаты, добавленные до REJECT, RemoveDuplicates все равно находит
+        server.SetDuplicatePolicy(DuplicatePolicy::REJECT);
+        ASSERT(RemoveDuplicates(server) == std::vector<int>({3, 4}));
+        ASSERT_EQUAL(server.GetDocumentCount(), 1);
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestPreparedQuery() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::BANNED, {3});
+    server.AddDocument(4, "big dog"s, DocumentStatus::ACTUAL, {4});
+
+    const std::string raw_query = "curly funny pet -dog c*"s;
+    SearchServer::PreparedQuery query = server.PrepareQuery(raw_query);
+    ASSERT_EQUAL(query.GetText(), raw_query);
+
+    const auto expected = server.FindTopDocuments(raw_query);
+    const auto actual = server.FindTopDocuments(query);
+    ASSERT_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        ASSERT_EQUAL(actual[i].id, expected[i].id);
+        ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, query, DocumentStatus::BANNED).size(), 1u);
+
+    // подготовленный запрос переживает перемещение: слова ссылаются на текст в куче
+    const SearchServer::PreparedQuery moved = std::move(query);
+    const std::vector<DocumentMatch> matches = server.MatchAllDocuments(moved);
+    ASSERT_EQUAL(matches.size(), 4u);
+    for (const DocumentMatch& match : matches) {
+        const auto [words, status] = server.MatchDocument(raw_query, match.id);
+        ASSERT(match.words == words);
+        ASSERT(match.status == status);
+        const auto [prepared_words, prepared_status] = server.MatchDocument(moved, match.id);
+        ASSERT(prepared_words == words);
+    }
+    ASSERT(matches[3].words.empty());
+
+    // новое слово в словаре: запрос разбирается заново
+    server.AddDocument(5, "cute cat"s, DocumentStatus::ACTUAL, {5});
+    ASSERT_EQUAL(server.MatchAllDocuments(moved).back().words.size(), 2u);
+
+    SearchServer other("and"s);
+    try {
+        other.FindTopDocuments(moved);
+        ASSERT_HINT(false, "query of another server must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestSearchPages() {
+    SearchServer server("and"s);
+    std::mt19937 generator(7);
+    const std::vector<std::string> words = {"cat"s, "dog"s, "rat"s, "owl"s, "fox"s};
+    for (int id = 0; id < 200; ++id) {
+        std::string text;
+        for (int i = 0; i < 4; ++i) {
+            text += words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 3});
+    }
+    const std::string query = "cat owl -fox"s;
+    const std::vector<Document> all = server.FindTopDocumentsPage(query, 0, 1000).documents;
+    ASSERT(all.size() > 50u);
+    ASSERT(std::is_sorted(all.begin(), all.end(), IsDocumentRankedHigher));
+
+    // страницы по смещению и по курсору совпадают с кусками полной выдачи, последовательно и параллельно
+    const size_t limit = 7;
+    SearchPage cursor_page = server.FindTopDocumentsPage(query, 0, limit);
+    SearchPage par_cursor_page = cursor_page;
+    for (size_t offset = 0; offset < all.size(); offset += limit) {
+        const SearchPage page = server.FindTopDocumentsPage(query, offset, limit);
+        const SearchPage par_page = server.FindTopDocumentsPage(std::execution::par, query, DocumentStatus::ACTUAL, offset, limit);
+        const size_t expected_size = std::min(limit, all.size() - offset);
+        ASSERT_EQUAL(page.size(), expected_size);
+        ASSERT_EQUAL(par_page.size(), expected_size);
+        ASSERT_EQUAL(cursor_page.size(), expected_size);
+        ASSERT_EQUAL(par_cursor_page.size(), expected_size);
+        for (size_t i = 0; i < expected_size; ++i) {
+            ASSERT_EQUAL(page.documents[i].id, all[offset + i].id);
+            ASSERT_EQUAL(par_page.documents[i].id, all[offset + i].id);
+            ASSERT_EQUAL(cursor_page.documents[i].id, all[offset + i].id);
+            ASSERT_EQUAL(par_cursor_page.documents[i].id, all[offset + i].id);
+        }
+        ASSERT_EQUAL(page.next_cursor.has_value(), expected_size == limit);
+        if (cursor_page.next_cursor) {
+            const SearchCursor cursor = DecodeSearchCursor(EncodeSearchCursor(*cursor_page.next_cursor));
+            cursor_page = server.FindTopDocumentsPage(query, cursor, limit);
+            par_cursor_page = server.FindTopDocumentsPage(std::execution::par, query, DocumentStatus::ACTUAL,
+                                                          *par_cursor_page.next_cursor, limit);
+        }
+    }
+    ASSERT_EQUAL(server.FindTopDocumentsPage(query, all.size(), limit).size(), 0u);
+
+    const auto pages = Paginate(server.FindTopDocumentsPage(query, 0, 10), 4);
+    ASSERT_EQUAL(pages.size(), 3);
+
+    // равенство релевантностей транзитивно: попарные разницы меньше EPSILON не замыкаются в цикл по рейтингу
+    const Document low(1, 0.0, 3);
+    const Document middle(2, 0.6 * EPSILON, 2);
+    const Document high(3, 1.2 * EPSILON, 1);
+    ASSERT(!(IsDocumentRankedHigher(low, middle) && IsDocumentRankedHigher(middle, high) && IsDocumentRankedHigher(high, low)));
+    ASSERT(IsDocumentRankedHigher(middle, high) && IsDocumentRankedHigher(middle, low) && IsDocumentRankedHigher(high, low));
+
+    try {
+        DecodeSearchCursor("not a cursor"s);
+        ASSERT_HINT(false, "malformed cursor must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestConjunctiveQuery() {
+    // оба ядра пересечения совпадают с std::set_intersection на списках разной плотности
+    std::mt19937 generator(11);
+    for (int density : {1, 3, 50, 400}) {
+        std::vector<int> short_ids;
+        std::vector<int> long_ids;
+        for (int id = 0; id < 20000; ++id) {
+            if (std::uniform_int_distribution(0, density)(generator) == 0) {
+                short_ids.push_back(id);
+            }
+            if (std::uniform_int_distribution(0, 2)(generator) == 0) {
+                long_ids.push_back(id);
+            }
+        }
+        std::vector<int> expected;
+        std::set_intersection(short_ids.begin(), short_ids.end(), long_ids.begin(), long_ids.end(), std::back_inserter(expected));
+        std::vector<uint32_t> short_indexes(short_ids.size());
+        std::vector<uint32_t> long_indexes(short_ids.size());
+        for (auto intersect : {IntersectMerge, IntersectGalloping, IntersectSorted}) {
+            const size_t count = intersect(short_ids.data(), short_ids.size(), long_ids.data(), long_ids.size(),
+                                           {short_indexes.data(), long_indexes.data()});
+            ASSERT_EQUAL(count, expected.size());
+            for (size_t i = 0; i < count; ++i) {
+                ASSERT_EQUAL(short_ids[short_indexes[i]], expected[i]);
+                ASSERT_EQUAL(long_ids[long_indexes[i]], expected[i]);
+            }
+        }
+    }
+
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat and fluffy tail"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "white dog and fluffy tail"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "black cat and fluffy tail"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "white cat with collar"s, DocumentStatus::BANNED, {4});
+    server.AddDocument(5, "white cat fluffy"s, DocumentStatus::ACTUAL, {5});
+
+    const auto all = server.FindTopDocuments("white cat fluffy -collar"s, QueryMode::ALL);
+    ASSERT_EQUAL(all.size(), 2u);
+    ASSERT_EQUAL(all[0].id, 5);
+    ASSERT_EQUAL(all[1].id, 1);
+    // релевантность та же, что у обычного запроса
+    const auto any = server.FindTopDocuments("white cat fluffy -collar"s);
+    ASSERT_EQUAL(any[0].id, 5);
+    ASSERT_EQUAL(any[0].relevance, all[0].relevance);
+
+    const auto prepared = server.PrepareQuery("white cat"s, QueryMode::ALL);
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::par, prepared, DocumentStatus::BANNED).size(), 1u);
+    ASSERT(std::get<0>(server.MatchDocument(prepared, 2)).empty());
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument(prepared, 1)).size(), 2u);
+    size_t matched_count = 0;
+    for (const DocumentMatch& match : server.MatchAllDocuments(prepared)) {
+        matched_count += !match.words.empty();
+    }
+    ASSERT_EQUAL(matched_count, 3u);
+    ASSERT(server.FindTopDocuments("white unknown"s, QueryMode::ALL).empty());
+
+    try {
+        server.FindTopDocuments("white c*"s, QueryMode::ALL);
+        ASSERT_HINT(false, "wildcard in conjunctive query must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestStopWordFilter() {
+    std::mt19937 generator(5);
+    std::set<std::string, std::less<>> stop_words;
+    while (stop_words.size() < 500) {
+        std::string word(std::uniform_int_distribution(1, 8)(generator), ' ');
+        for (char& c : word) {
+            c = std::uniform_int_distribution('a', 'k')(generator);
+        }
+        stop_words.insert(word);
+    }
+    const StopWordFilter filter(stop_words);
+    ASSERT_EQUAL(filter.size(), stop_words.size());
+    ASSERT(std::equal(filter.begin(), filter.end(), stop_words.begin(), stop_words.end()));
+    for (const std::string& word : stop_words) {
+        ASSERT(filter.Contains(word));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        std::string word(std::uniform_int_distribution(0, 10)(generator), ' ');
+        for (char& c : word) {
+            c = std::uniform_int_distribution('a', 'm')(generator);
+        }
+        ASSERT_EQUAL(filter.Contains(word), stop_words.count(word) > 0);
+    }
+    ASSERT(!StopWordFilter{}.Contains("in"s));
+
+    std::vector<std::string_view> words = {"dog", "cat", "dog", "ant", "cat"};
+    RemoveDuplicateWords(words);
+    ASSERT((words == std::vector<std::string_view>{"dog", "cat", "ant"}));
+    std::vector<std::string> many_words;
+    for (int i = 0; i < 300; ++i) {
+        many_words.push_back(std::to_string(i % 200));
+    }
+    std::vector<std::string_view> many_views(many_words.begin(), many_words.end());
+    RemoveDuplicateWords(many_views);
+    ASSERT_EQUAL(many_views.size(), 200u);
+    ASSERT(many_views.back() == "199");
+
+    // стоп-слова по-прежнему пропускаются и в документах, и в запросах
+    SearchServer server("in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.GetWordFrequencies(1).size(), 2u);
+    ASSERT(server.FindTopDocuments("in the"s).empty());
+    const std::string query = "city cat cat in"s;
+    const auto [matched_words, _] = server.MatchDocument(query, 1);
+    ASSERT((matched_words == std::vector<std::string_view>{"cat", "city"}));
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestTextAnalyzer() {
+    std::string buffer;
+    const std::string plain = "curly cat in the city"s;
+    ASSERT(AnalyzeText(TextAnalyzer::UTF8, plain, buffer).data() == plain.data());
+    ASSERT_EQUAL(AnalyzeText(TextAnalyzer::LEGACY, "Кот"s, buffer), "Кот"s);
+    ASSERT_EQUAL(AnalyzeText(TextAnalyzer::UTF8, "Curly CAT in THE BIG City\tÉTÉ"s, buffer), "curly cat in the big city été"s);
+    ASSERT_EQUAL(AnalyzeText(TextAnalyzer::UTF8, "Кот\u00A0ЁЖИК\u3000ΣΟΦΊΑ ŁÓDŹ"s, buffer), "кот ёжик σοφία łódź"s);
+    // разложенная й совпадает с составной
+    ASSERT_EQUAL(AnalyzeText(TextAnalyzer::UTF8, "Йод и\u0306од"s, buffer), "йод йод"s);
+    for (const std::string& invalid : {"caf\xC3"s, "\xC0\xAF"s, "\xED\xA0\x80"s, "\xF5\x80\x80\x80"s, "a\x80 b"s}) {
+        bool is_thrown = false;
+        try {
+            AnalyzeText(TextAnalyzer::UTF8, invalid, buffer);
+        } catch (const std::invalid_argument&) {
+            is_thrown = true;
+        }
+        ASSERT(is_thrown);
+    }
+
+    SearchServer server("В и"s);
+    server.SetTextAnalyzer(TextAnalyzer::UTF8);
+    server.AddDocument(1, "Кот в Городе"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "пёс И КОТ"s, DocumentStatus::ACTUAL, {2});
+    ASSERT_EQUAL(server.GetWordFrequencies(1).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("КОТ"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("кот -ПЁС"s).size(), 1u);
+    // найденные слова ссылаются на словарь, а не на временный текст запроса
+    const auto [matched_words, _] = server.MatchDocument("ГОРОДЕ Кот кот"s, 1);
+    ASSERT((matched_words == std::vector<std::string_view>{"городе", "кот"}));
+    bool is_thrown = false;
+    try {
+        server.SetTextAnalyzer(TextAnalyzer::LEGACY);
+    } catch (const std::logic_error&) {
+        is_thrown = true;
+    }
+    ASSERT(is_thrown);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestQuantizedScorer() {
+    std::mt19937 generator(13);
+    auto random_word = [&generator]() {
+        const int a = std::uniform_int_distribution<int>(0, 39)(generator);
+        const int b = std::uniform_int_distribution<int>(0, 39)(generator);
+        return "w"s + std::to_string(std::min(a, b));
+    };
+    SearchServer server(""s);
+    for (int id = 0; id < 1500; ++id) {
+        std::string text;
+        const int word_count = std::uniform_int_distribution<int>(1, 10)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {std::uniform_int_distribution<int>(-2, 2)(generator)});
+    }
+    const QuantizedScorer<TfIdfScorer> tf_idf;
+    const QuantizedScorer<Bm25Scorer> bm25(Bm25Scorer(1.5, 0.6));
+    for (int q = 0; q < 100; ++q) {
+        std::string query;
+        const int word_count = std::uniform_int_distribution<int>(1, 6)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            query += random_word() + " "s;
+        }
+        // целые суммы совпадают побитно, поэтому совпадают и документы, и релевантность
+        const auto check_equal = [](const std::vector<Document>& found, const std::vector<Document>& expected) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT(found[i].relevance == expected[i].relevance);
+            }
+        };
+        const auto seq_tf_idf = server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, tf_idf);
+        check_equal(seq_tf_idf, server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, tf_idf));
+        check_equal(server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, bm25),
+                    server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, bm25));
+        // ошибка квантования - полкванта на слово
+        const auto exact = server.FindTopDocuments(query);
+        ASSERT_EQUAL(seq_tf_idf.size(), exact.size());
+        for (size_t i = 0; i < exact.size(); ++i) {
+            ASSERT(std::abs(seq_tf_idf[i].relevance - exact[i].relevance) < EPSILON);
+        }
+    }
+
+    // сотни слов запроса, каждое с вкладом порядка наибольшего, не переполняют сумму
+    SearchServer long_server(""s);
+    std::string long_text;
+    for (int i = 0; i < 1000; ++i) {
+        long_text += "u"s + std::to_string(i) + " "s;
+    }
+    long_server.AddDocument(0, long_text, DocumentStatus::ACTUAL, {1});
+    for (int id = 1; id < 100; ++id) {
+        long_server.AddDocument(id, "filler"s, DocumentStatus::ACTUAL, {1});
+    }
+    const Bm25Scorer exact_bm25(1.2, 0.0);
+    const auto exact = long_server.FindTopDocuments(std::execution::seq, long_text, DocumentStatus::ACTUAL, exact_bm25);
+    const auto quantized = long_server.FindTopDocuments(std::execution::seq, long_text, DocumentStatus::ACTUAL,
+                                                        QuantizedScorer<Bm25Scorer>(exact_bm25));
+    ASSERT_EQUAL(quantized.size(), SINGL_RSLT);
+    ASSERT_EQUAL(exact.size(), SINGL_RSLT);
+    ASSERT(std::abs(quantized[0].relevance - exact[0].relevance) < EPSILON * exact[0].relevance);
+
+    // суммы копятся в 32-битных целых, а квант делит 2^32 - 1 между всеми словами запроса
+    static_assert(std::is_same_v<ScoreType<QuantizedScorer<Bm25Scorer>>, uint32_t>);
+    ASSERT_EQUAL(sizeof(ScoreType<QuantizedScorer<TfIdfScorer>>), 4u);
+    const CorpusStats stats{100, 10.99};
+    for (const size_t term_count : {size_t{1}, size_t{7}, size_t{1000}, size_t{100'000}}) {
+        QuantizedScorer<Bm25Scorer> scorer(exact_bm25);
+        scorer.Prepare(stats, term_count);
+        const uint64_t max_impact = scorer.UpperBound(scorer.InverseDocumentFreq(stats, 1), 1.0, 0);
+        ASSERT(max_impact > 0);
+        ASSERT(max_impact * term_count <= std::numeric_limits<uint32_t>::max());
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestLatencyHistogram() {
+    LatencyHistogram histogram;
+    ASSERT_EQUAL(histogram.Snapshot().count, 0u);
+    for (uint64_t value = 1; value <= 100'000; ++value) {
+        histogram.Record(value * 1'000);
+    }
+    const LatencySnapshot snapshot = histogram.Snapshot();
+    ASSERT_EQUAL(snapshot.count, 100'000u);
+    ASSERT_EQUAL(snapshot.min_ns, 1'000u);
+    ASSERT_EQUAL(snapshot.max_ns, 100'000'000u);
+    // верхняя граница корзины не меньше точного процентиля и больше него не более чем на 1/32
+    const auto check_percentile = [](uint64_t found, uint64_t exact) {
+        ASSERT(found >= exact && found <= exact + exact / 32);
+    };
+    check_percentile(snapshot.p50_ns, 50'000'000);
+    check_percentile(snapshot.p99_ns, 99'000'000);
+    check_percentile(snapshot.p999_ns, 99'900'000);
+    // малые значения хранятся точно
+    LatencyHistogram small;
+    for (uint64_t value : {3, 3, 7, 20}) {
+        small.Record(value);
+    }
+    ASSERT_EQUAL(small.ValueAtPercentile(50.0), 3u);
+    ASSERT_EQUAL(small.ValueAtPercentile(100.0), 20u);
+    small.Merge(histogram);
+    ASSERT_EQUAL(small.Count(), 100'004u);
+    ASSERT_EQUAL(small.Snapshot().min_ns, 3u);
+
+    ResetQueryPhases();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 1000; ++i) {
+                RecordQueryPhase(QueryPhase::TOP_K, 100 * (t + 1));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const LatencySnapshot top_k = QueryPhaseSnapshot(QueryPhase::TOP_K);
+    ASSERT_EQUAL(top_k.count, 4000u);
+    ASSERT_EQUAL(top_k.min_ns, 100u);
+    ASSERT_EQUAL(top_k.max_ns, 400u);
+    ASSERT_EQUAL(QueryPhaseSnapshot(QueryPhase::PARSE).count, 0u);
+
+    // чередующиеся фазы записываются по разу, даже если в фазу не переключались
+    ResetQueryPhases();
+    {
+        QueryPhaseClock clock({QueryPhase::POSTINGS, QueryPhase::MINUS_WORDS, QueryPhase::TOP_K});
+        for (int i = 0; i < 10; ++i) {
+            clock.Switch(QueryPhase::TOP_K);
+            clock.Switch(QueryPhase::POSTINGS);
+        }
+    }
+    ASSERT_EQUAL(QueryPhaseSnapshot(QueryPhase::POSTINGS).count, 1u);
+    ASSERT_EQUAL(QueryPhaseSnapshot(QueryPhase::MINUS_WORDS).count, 1u);
+    ASSERT_EQUAL(QueryPhaseSnapshot(QueryPhase::MINUS_WORDS).max_ns, 0u);
+    ASSERT_EQUAL(QueryPhaseSnapshot(QueryPhase::TOP_K).count, 1u);
+    ASSERT_EQUAL(QueryPhaseSnapshot(QueryPhase::PARSE).count, 0u);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestQueryStatistics() {
+    using namespace std::chrono;
+    QueryStatistics statistics;
+    const QueryStatistics::Clock::time_point base = QueryStatistics::Clock::time_point{} + 10h;
+    for (int i = 0; i < 100; ++i) {
+        statistics.Record(microseconds(100 + i), i % 10 == 0 ? 0 : 5, base);
+    }
+    const QueryWindowStats minute = statistics.Snapshot(StatisticsWindow::MINUTE, base + 30s);
+    ASSERT_EQUAL(minute.request_count, 100u);
+    ASSERT_EQUAL(minute.zero_result_count, 10u);
+    ASSERT(std::abs(minute.ZeroResultRate() - 0.1) < EPSILON);
+    // процентиль - верхняя граница корзины, ошибка не больше 1/8
+    ASSERT(minute.p50_ns >= 149'000 && minute.p50_ns <= 149'000 + 149'000 / 8);
+    ASSERT(minute.p99_ns >= 198'000 && minute.p99_ns <= 199'000 + 199'000 / 8);
+    // запросы уходят из коротких окон и остаются в длинных
+    ASSERT_EQUAL(statistics.Snapshot(StatisticsWindow::MINUTE, base + 2min).request_count, 0u);
+    ASSERT_EQUAL(statistics.Snapshot(StatisticsWindow::HOUR, base + 2min).request_count, 100u);
+    ASSERT_EQUAL(statistics.Snapshot(StatisticsWindow::HOUR, base + 2h).request_count, 0u);
+    ASSERT_EQUAL(statistics.Snapshot(StatisticsWindow::DAY, base + 2h).request_count, 100u);
+    ASSERT_EQUAL(statistics.Snapshot(StatisticsWindow::DAY, base + 25h).request_count, 0u);
+    // корзина того же места кольца через минуту обнуляется
+    statistics.Record(microseconds(1), 1, base + 60s);
+    ASSERT_EQUAL(statistics.Snapshot(StatisticsWindow::MINUTE, base + 60s).request_count, 1u);
+    ASSERT_EQUAL(statistics.Snapshot(StatisticsWindow::HOUR, base + 60s).request_count, 101u);
+
+    // запись из нескольких потоков без потерь
+    const auto later = base + 3h;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&statistics, later, t] {
+            for (int i = 0; i < 1000; ++i) {
+                statistics.Record(microseconds(t + 1), i % 2, later + milliseconds(i % 1000));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const QueryWindowStats concurrent = statistics.Snapshot(StatisticsWindow::MINUTE, later + 1s);
+    ASSERT_EQUAL(concurrent.request_count, 4000u);
+    ASSERT_EQUAL(concurrent.zero_result_count, 2000u);
+
+    // очередь запросов пишет в общую статистику
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "пушистый кот"s, DocumentStatus::ACTUAL, {1});
+    QueryStatistics queue_statistics;
+    RequestQueue request_queue(server, queue_statistics);
+    request_queue.AddFindRequest("кот"s);
+    request_queue.AddFindRequest("пес"s);
+    const QueryWindowStats queue_minute = queue_statistics.Snapshot(StatisticsWindow::MINUTE);
+    ASSERT_EQUAL(queue_minute.request_count, 2u);
+    ASSERT_EQUAL(queue_minute.zero_result_count, 1u);
+    ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestExplainTopDocuments() {
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(2, "ухоженный пес выразительные глаза"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(3, "пушистый пес и модный ошейник"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "кот на заборе"s, DocumentStatus::BANNED, {1});
+    server.AddDocument(5, "пушистый кот и ошейник"s, DocumentStatus::ACTUAL, {2});
+    const std::string query = "пушистый ухоженный кот -ошейник"s;
+
+    const QueryExplain explain = server.ExplainTopDocuments(query);
+    const std::vector<Document> expected = server.FindTopDocuments(query);
+    const std::vector<Document> documents = explain.GetDocuments();
+    ASSERT_EQUAL(documents.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(documents[i].id, expected[i].id);
+        ASSERT_EQUAL(documents[i].relevance, expected[i].relevance);
+        // вклады слов в сумме дают релевантность
+        double relevance = 0.0;
+        for (const double term_relevance : explain.documents[i].term_relevances) {
+            relevance += term_relevance;
+        }
+        ASSERT(std::abs(relevance - expected[i].relevance) < EPSILON);
+    }
+
+    ASSERT_EQUAL(explain.terms.size(), 4u);
+    const TermExplain& fluffy = explain.terms[0];
+    ASSERT_EQUAL(fluffy.word, "пушистый"s);
+    ASSERT_EQUAL(fluffy.posting_length, 3u);
+    ASSERT_EQUAL(fluffy.documents_scored, 3u);
+    ASSERT_EQUAL(fluffy.documents_rejected_by_minus_words, 2u);
+    ASSERT(std::abs(fluffy.inverse_document_freq - std::log(5.0 / 3.0)) < EPSILON);
+    // забаненный документ 4 отсеивается предикатом
+    const TermExplain& cat = explain.terms[2];
+    ASSERT_EQUAL(cat.posting_length, 3u);
+    ASSERT_EQUAL(cat.documents_scored, 2u);
+    ASSERT_EQUAL(cat.documents_rejected_by_predicate, 1u);
+    const TermExplain& collar = explain.terms[3];
+    ASSERT(collar.is_minus);
+    ASSERT_EQUAL(collar.documents_rejected_by_minus_words, 2u);
+    ASSERT_EQUAL(explain.candidate_count, 4u);
+    ASSERT_EQUAL(explain.rejected_by_phrases, 0u);
+
+    // произвольный предикат и другая стратегия
+    const auto is_even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+    const QueryExplain even = server.ExplainTopDocuments(query, is_even, Bm25Scorer{});
+    const std::vector<Document> even_expected = server.FindTopDocuments(std::execution::seq, query, is_even, Bm25Scorer{});
+    ASSERT_EQUAL(even.GetDocuments().size(), even_expected.size());
+    ASSERT_EQUAL(even.GetDocuments()[0].id, even_expected[0].id);
+    ASSERT_EQUAL(even.terms[2].documents_rejected_by_predicate, 2u);
+
+    std::ostringstream out;
+    PrintQueryExplain(out, explain);
+    ASSERT(out.str().find("-ошейник postings=2 rejected=2"s) != std::string::npos);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestZipfWorkload() {
+    // частоты номеров близки к 1 / (k + 1)^s, нулевой показатель - равновероятно
+    std::mt19937 generator(42);
+    const ZipfDistribution zipf(100, 1.0);
+    std::vector<int> counts(100);
+    const int sample_count = 100'000;
+    for (int i = 0; i < sample_count; ++i) {
+        ++counts[zipf(generator)];
+    }
+    ASSERT(std::abs(zipf.Probability(0) / zipf.Probability(9) - 10.0) < EPSILON);
+    ASSERT(std::abs(counts[0] * 1.0 / sample_count - zipf.Probability(0)) < 0.01);
+    ASSERT(counts[0] > 5 * counts[9]);
+    ASSERT(std::abs(ZipfDistribution(10, 0.0).Probability(3) - 0.1) < EPSILON);
+    try {
+        ZipfDistribution(0, 1.0);
+        ASSERT_HINT(false, "empty distribution must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+
+    WorkloadConfig config;
+    config.vocabulary_size = 500;
+    config.document_count = 200;
+    config.mean_document_length = 20;
+    config.operation_count = 2'000;
+    config.distinct_query_count = 50;
+    config.churn_ratio = 0.2;
+    const Workload workload = GenerateWorkload(config);
+    ASSERT_EQUAL(workload.corpus.size(), 200u);
+    ASSERT_EQUAL(workload.operations.size(), 2'000u);
+
+    // журнал воспроизводится без ошибок: удаляются только существующие документы, новые id не повторяются
+    SearchServer server(""s);
+    for (const WorkloadOperation& operation : workload.corpus) {
+        server.AddDocument(operation.document_id, operation.text, DocumentStatus::ACTUAL, {1});
+    }
+    std::set<std::string> distinct_queries;
+    size_t churn_count = 0;
+    for (const WorkloadOperation& operation : workload.operations) {
+        if (operation.type == WorkloadOperation::Type::ADD) {
+            server.AddDocument(operation.document_id, operation.text, DocumentStatus::ACTUAL, {1});
+            ++churn_count;
+        } else if (operation.type == WorkloadOperation::Type::REMOVE) {
+            const int document_count = server.GetDocumentCount();
+            server.RemoveDocument(operation.document_id);
+            ASSERT_EQUAL(server.GetDocumentCount(), document_count - 1);
+            ++churn_count;
+        } else {
+            distinct_queries.insert(operation.text);
+        }
+    }
+    ASSERT(churn_count > 300 && churn_count < 500);
+    ASSERT(distinct_queries.size() <= 50u);
+
+    std::stringstream log;
+    WriteWorkloadOperations(log, workload.operations);
+    const std::vector<WorkloadOperation> read = ReadWorkloadOperations(log);
+    ASSERT_EQUAL(read.size(), workload.operations.size());
+    for (size_t i = 0; i < read.size(); ++i) {
+        ASSERT(read[i].type == workload.operations[i].type);
+        ASSERT_EQUAL(read[i].document_id, workload.operations[i].document_id);
+        ASSERT_EQUAL(read[i].text, workload.operations[i].text);
+    }
+    std::istringstream broken("query\tcat\nremove\tx\n"s);
+    try {
+        ReadWorkloadOperations(broken);
+        ASSERT_HINT(false, "bad document id must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestPerfCounters() {
+    // без доступа к счетчикам (нет прав, нет PMU) замеры пусты, но все работает
+    const PerfCounterSample start = ThreadPerfCounters().Read();
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 1'000'000; ++i) {
+        sum = sum + i;
+    }
+    const PerfCounterSample counters = ThreadPerfCounters().Read() - start;
+    if (counters.Has(PerfCounter::INSTRUCTIONS)) {
+        ASSERT(counters.Get(PerfCounter::INSTRUCTIONS) >= 1'000'000u);
+    }
+    if (counters.Has(PerfCounter::CYCLES) && counters.Has(PerfCounter::INSTRUCTIONS)) {
+        ASSERT(counters.InstructionsPerCycle() > 0.0);
+    } else {
+        ASSERT_EQUAL(counters.InstructionsPerCycle(), 0.0);
+    }
+
+    // разность есть только у счетчиков, доступных в обоих замерах
+    PerfCounterSample before;
+    before.available = {true, true, false, true};
+    before.values = {100, 300, 0, 7};
+    PerfCounterSample after;
+    after.available = {true, true, true, false};
+    after.values = {500, 1100, 40, 9};
+    const PerfCounterSample difference = after - before;
+    ASSERT(difference.Has(PerfCounter::CYCLES) && difference.Has(PerfCounter::INSTRUCTIONS));
+    ASSERT(!difference.Has(PerfCounter::LLC_MISSES) && !difference.Has(PerfCounter::BRANCH_MISSES));
+    ASSERT_EQUAL(difference.InstructionsPerCycle(), 2.0);
+    ASSERT_EQUAL(difference.PerOperation(PerfCounter::CYCLES, 4), 100.0);
+    ASSERT_EQUAL(difference.PerOperation(PerfCounter::LLC_MISSES, 4), 0.0);
+
+    std::ostringstream out;
+    {
+        LOG_DURATION_PERF_STREAM("scope"s, out);
+    }
+    ASSERT(out.str().rfind("scope: "s, 0) == 0);
+    ASSERT((out.str().find("perf counters unavailable"s) != std::string::npos) == !ThreadPerfCounters().Read().HasAny());
+    {
+        LOG_DURATION_STREAM("plain"s, out);
+    }
+    ASSERT(out.str().find("plain: 0 ms\n"s) != std::string::npos);
+
+    SearchServer server("и"s);
+    server.AddDocument(1, "кот"s, DocumentStatus::ACTUAL, {1});
+    std::ostringstream explain_out;
+    PrintQueryExplain(explain_out, server.ExplainTopDocuments("кот"s));
+    ASSERT(explain_out.str().find("counters:"s) != std::string::npos);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestIndexAllocation() {
+    const std::vector<std::string> texts = {"funny pet and nasty rat"s, "funny pet with curly hair"s,
+                                            "big cat nasty hair"s, "big dog cat Vladislav"s};
+    SearchServer heap_server("and with"s);
+    ASSERT(heap_server.GetIndexAllocation() == IndexAllocation::HEAP);
+    ASSERT_EQUAL(heap_server.MemoryStats().allocation.allocation_count, 0u);
+    SearchServer arena_server("and with"s);
+    arena_server.SetIndexAllocation(IndexAllocation::MONOTONIC);
+    ASSERT(arena_server.GetIndexAllocation() == IndexAllocation::MONOTONIC);
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        heap_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        arena_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+    }
+
+    const IndexAllocationStats heap_stats = heap_server.MemoryStats().allocation;
+    ASSERT(heap_stats.allocation_count > 0);
+    ASSERT(heap_stats.live_bytes > 0);
+    ASSERT_EQUAL(heap_stats.reserved_bytes, heap_stats.live_bytes);
+    // узлы одни и те же, различается только то, откуда они берут память
+    const IndexAllocationStats arena_stats = arena_server.MemoryStats().allocation;
+    ASSERT_EQUAL(arena_stats.allocation_count, heap_stats.allocation_count);
+    ASSERT_EQUAL(arena_stats.live_bytes, heap_stats.live_bytes);
+    ASSERT(arena_stats.reserved_bytes >= arena_stats.live_bytes);
+
+    const auto heap_result = heap_server.FindTopDocuments("nasty cat -dog"s);
+    const auto arena_result = arena_server.FindTopDocuments("nasty cat -dog"s);
+    ASSERT_EQUAL(heap_result.size(), arena_result.size());
+    for (size_t i = 0; i < heap_result.size(); ++i) {
+        ASSERT_EQUAL(heap_result[i].id, arena_result[i].id);
+        ASSERT_EQUAL(heap_result[i].relevance, arena_result[i].relevance);
+    }
+
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        heap_server.RemoveDocument(id);
+        arena_server.RemoveDocument(id);
+    }
+    // словарь слов живет до уничтожения сервера, остальное возвращено
+    ASSERT(heap_server.MemoryStats().allocation.deallocation_count > 0);
+    ASSERT(heap_server.MemoryStats().allocation.live_bytes < heap_stats.live_bytes);
+    // арена при удалении ничего не возвращает вышестоящему ресурсу
+    ASSERT_EQUAL(arena_server.MemoryStats().allocation.reserved_bytes, arena_stats.reserved_bytes);
+
+    // без документов политику можно сменить: оставшийся словарь сбрасывается
+    heap_server.SetIndexAllocation(IndexAllocation::MONOTONIC);
+    ASSERT_EQUAL(heap_server.MemoryStats().dead_term_count, 0u);
+    ASSERT(heap_server.HasChanges());
+
+    // перемещенный сервер продолжает пользоваться своим ресурсом
+    SearchServer moved_server(std::move(arena_server));
+    moved_server.AddDocument(7, "curly cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(moved_server.FindTopDocuments("curly"s).size(), 1u);
+    ASSERT(moved_server.MemoryStats().allocation.allocation_count > arena_stats.allocation_count);
+    // а исходный получает новый ресурс и пустой индекс
+    ASSERT_EQUAL(arena_server.GetDocumentCount(), 0);
+    ASSERT_EQUAL(arena_server.MemoryStats().allocation.allocation_count, 0u);
+    arena_server.AddDocument(1, "curly dog"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(arena_server.FindTopDocuments("curly"s).size(), 1u);
+    ASSERT_EQUAL(moved_server.FindTopDocuments("dog"s).size(), 0u);
+
+    // Clear отдает блоки арены разом, не обходя узлы и массивы, и повторное наполнение не раздувает арену
+    const uint64_t deallocations_before_clear = moved_server.MemoryStats().allocation.deallocation_count;
+    moved_server.Clear();
+    ASSERT_EQUAL(moved_server.MemoryStats().allocation.deallocation_count, deallocations_before_clear);
+    ASSERT_EQUAL(moved_server.GetDocumentCount(), 0);
+    ASSERT(moved_server.FindTopDocuments("curly"s).empty());
+    ASSERT_EQUAL(moved_server.MemoryStats().dead_term_count, 0u);
+    size_t churn_reserved_bytes = 0;
+    for (int round = 0; round < 50; ++round) {
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+            moved_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        }
+        moved_server.Clear();
+        moved_server.ResetChangeTracking();
+        ASSERT_EQUAL(moved_server.MemoryStats().allocation.live_bytes, 0u);
+        if (round == 0) {
+            churn_reserved_bytes = moved_server.MemoryStats().allocation.reserved_bytes;
+        }
+        ASSERT_EQUAL(moved_server.MemoryStats().allocation.reserved_bytes, churn_reserved_bytes);
+    }
+    moved_server.AddDocument(7, "curly cat"s, DocumentStatus::ACTUAL, {1});
+
+    try {
+        moved_server.SetIndexAllocation(IndexAllocation::HEAP);
+        ASSERT_HINT(false, "allocation policy must not change with documents in the index"s);
+    } catch (const std::logic_error&) {
+    }
+    try {
+        SearchServer server(""s);
+        server.SetIndexAllocation(IndexAllocation::MONOTONIC, nullptr);
+        ASSERT_HINT(false, "null upstream must be rejected"s);
+    } catch (const std::invalid_argument&) {
+    }
+
+    // массивы списков документов, столбцы атрибутов и позиции тоже берут память у ресурса сервера
+    {
+        IndexMemoryResource resource;
+        {
+            PostingList postings{PostingList::allocator_type(&resource)};
+            postings.Add(1, 0, 0.5, 1, DocumentStatus::ACTUAL);
+            ASSERT(resource.Stats().live_bytes >= PostingList::UsedBytes(1));
+            DocumentAttributeStore attributes(&resource);
+            const size_t postings_bytes = resource.Stats().live_bytes;
+            attributes.Add(5, DocumentStatus::ACTUAL);
+            ASSERT(resource.Stats().live_bytes >= postings_bytes + attributes.PayloadBytes());
+        }
+        ASSERT_EQUAL(resource.Stats().live_bytes, 0u);
+
+        SearchServer plain_server(""s);
+        SearchServer positional_server(""s);
+        positional_server.EnablePositionalIndex();
+        for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+            plain_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+            positional_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, {id});
+        }
+        const IndexMemoryStats positional_stats = positional_server.MemoryStats();
+        ASSERT_EQUAL(positional_stats.allocation.live_bytes - plain_server.MemoryStats().allocation.live_bytes,
+                     positional_stats.positions.payload_bytes);
+        positional_server.Clear();
+        positional_server.ResetChangeTracking();
+        ASSERT_EQUAL(positional_server.MemoryStats().allocation.live_bytes, 0u);
+    }
+
+    std::ostringstream out;
+    out << moved_server.MemoryStats();
+    ASSERT(out.str().find("index allocations: "s) != std::string::npos);
+}
+//-------------------------------------------------------------------------------------------------------------
+void TestServerCopyAndMove() {
+    SearchServer server("and with"s);
+    server.SetIndexAllocation(IndexAllocation::MONOTONIC);
+    server.EnablePositionalIndex();
+    server.SetDuplicatePolicy(DuplicatePolicy::REPORT);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::BANNED, {3});
+    server.AddDocument(4, "big dog cat"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(5, "lonely word"s, DocumentStatus::ACTUAL, {5});
+    server.ResetChangeTracking();
+    // удаленный документ, смена статуса и новый документ попадают в дельту
+    server.RemoveDocument(5);
+    server.SetDocumentStatus(4, DocumentStatus::IRRELEVANT);
+    server.AddDocument(6, "curly cat"s, DocumentStatus::ACTUAL, {6});
+
+    std::ostringstream expected_snapshot;
+    std::ostringstream expected_delta;
+    server.SaveSnapshot(expected_snapshot);
+    server.SaveDelta(expected_delta);
+    const Bm25Scorer bm25;
+    const std::string query = "funny nasty cat curly hair"s;
+    const auto expected_actual = server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, bm25);
+    const auto expected_banned = server.FindTopDocuments(std::execution::seq, query, DocumentStatus::BANNED, bm25);
+
+    // каждый контейнер индекса проверяется через открытые методы, отпечатки - последними, добавлением дубликата
+    const auto check_index = [&](SearchServer& checked) {
+        const auto check_equal = [](const std::vector<Document>& found, const std::vector<Document>& expected) {
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected[i].id);
+                ASSERT(found[i].relevance == expected[i].relevance);
+                ASSERT_EQUAL(found[i].rating, expected[i].rating);
+            }
+        };
+        ASSERT(checked.GetIndexAllocation() == IndexAllocation::MONOTONIC);
+        ASSERT_EQUAL(checked.GetDocumentCount(), 5);
+        ASSERT((std::vector<int>(checked.begin(), checked.end()) == std::vector<int>{1, 2, 3, 4, 6}));
+        check_equal(checked.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, bm25), expected_actual);
+        check_equal(checked.FindTopDocuments(std::execution::seq, query, DocumentStatus::BANNED, bm25), expected_banned);
+        ASSERT_EQUAL(checked.FindTopDocuments("dog"s, DocumentStatus::IRRELEVANT).size(), 1u);
+        ASSERT(checked.FindTopDocuments("and"s).empty());
+        for (const int id : {1, 2, 3, 4, 5, 6}) {
+            ASSERT(checked.GetWordFrequencies(id) == server.GetWordFrequencies(id));
+        }
+        ASSERT_EQUAL(checked.FindTopDocuments("\"nasty rat\""s).size(), 1u);
+        ASSERT(checked.FindTopDocuments("\"rat nasty\""s).empty());
+        ASSERT(checked.HasChanges());
+        std::ostringstream snapshot;
+        std::ostringstream delta;
+        checked.SaveSnapshot(snapshot);
+        checked.SaveDelta(delta);
+        ASSERT(snapshot.str() == expected_snapshot.str());
+        ASSERT(delta.str() == expected_delta.str());
+        ASSERT_EQUAL(checked.MemoryStats().posting_count, server.MemoryStats().posting_count);
+        ASSERT(checked.GetDuplicatePolicy() == DuplicatePolicy::REPORT);
+        ASSERT_EQUAL(checked.AddDocument(7, "cat curly cat"s, DocumentStatus::ACTUAL, {7}), 6);
+    };
+
+    SearchServer copy(server);
+    SearchServer copy_assigned("stale"s);
+    copy_assigned.AddDocument(9, "stale text"s, DocumentStatus::ACTUAL, {9});
+    copy_assigned = server;
+    SearchServer move_source(server);
+    SearchServer moved(std::move(move_source));
+    SearchServer move_assigned("stale"s);
+    move_assigned.AddDocument(9, "stale text"s, DocumentStatus::ACTUAL, {9});
+    const SearchServer::PreparedQuery stale_query = move_assigned.PrepareQuery("text"s);
+    {
+        SearchServer source(server);
+        move_assigned = std::move(source);
+        // исходный сервер пуст, но пригоден к работе
+        ASSERT_EQUAL(source.GetDocumentCount(), 0);
+        source.AddDocument(1, "curly dog"s, DocumentStatus::ACTUAL, {1});
+        ASSERT_EQUAL(source.FindTopDocuments("curly"s).size(), 1u);
+    }
+    ASSERT(move_assigned.FindTopDocuments(stale_query).empty());
+    ASSERT_EQUAL(move_source.GetDocumentCount(), 0);
+
+    // копии живут на своих ресурсах: очистка оригинала их не задевает
+    SearchServer original(server);
+    server.Clear();
+    ASSERT_EQUAL(server.GetDocumentCount(), 0);
+    server = std::move(original);
+    for (SearchServer* checked : {&copy, &copy_assigned, &moved, &move_assigned}) {
+        check_index(*checked);
+    }
+    check_index(server);
+}
+//-------------------------------------------------------------------------------------------------------------
 void TestSearchServer() {
     RUN_TEST(TestAddedDocumentContent);
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
@@ -350,6 +1859,31 @@ void TestSearchServer() {
     RUN_TEST(TestRemoveDocument);
     RUN_TEST(TestRemoveDuplicat);
     RUN_TEST(TestRemoveParalel);
+    RUN_TEST(TestMemoryStats);
+    RUN_TEST(TestIndexCheckpoint);
+    RUN_TEST(TestPrunedTopDocuments);
+    RUN_TEST(TestPostingListBlocks);
+    RUN_TEST(TestPhraseQuery);
+    RUN_TEST(TestWildcardQuery);
+    RUN_TEST(TestFuzzyQuery);
+    RUN_TEST(TestBm25Scorer);
+    RUN_TEST(TestDocumentStatusChange);
+    RUN_TEST(TestDocumentFilter);
+    RUN_TEST(TestNearDuplicates);
+    RUN_TEST(TestDuplicatePolicy);
+    RUN_TEST(TestPreparedQuery);
+    RUN_TEST(TestSearchPages);
+    RUN_TEST(TestConjunctiveQuery);
+    RUN_TEST(TestStopWordFilter);
+    RUN_TEST(TestTextAnalyzer);
+    RUN_TEST(TestQuantizedScorer);
+    RUN_TEST(TestLatencyHistogram);
+    RUN_TEST(TestQueryStatistics);
+    RUN_TEST(TestExplainTopDocuments);
+    RUN_TEST(TestZipfWorkload);
+    RUN_TEST(TestPerfCounters);
+    RUN_TEST(TestIndexAllocation);
+    RUN_TEST(TestServerCopyAndMove);
 }
 //-------------------------------------------------------------------------------------------------------------
 
@@ -69,6 +69,56 @@ void TestRemoveDocument();
 void TestRemoveDuplicat(); // TODO в тест системе видимо тоже имя тест с TestRemoveDuplicates, возникает ошибка (error: cannot convert ‘<unresolved overloaded function type>’ to ‘std::function<void()>&&’) не справедливо почему я менять должен
 // ест проверяет, RemoveDocument(std::execution::seq, 1);
 void TestRemoveParalel();
+// Тест проверяет, MemoryStats
+void TestMemoryStats();
+// Тест проверяет, снимки и дельты IndexCheckpointer
+void TestIndexCheckpoint();
+// Тест проверяет, что FindTopDocuments с отсечением MaxScore совпадает с полным перебором
+void TestPrunedTopDocuments();
+// Тест проверяет, блоки PostingList и Seek
+void TestPostingListBlocks();
+// Тест проверяет, поиск фраз по позиционному индексу
+void TestPhraseQuery();
+// Тест проверяет, запросы с шаблонами cat* и c?t
+void TestWildcardQuery();
+// Тест проверяет, нечеткий поиск автоматом Левенштейна
+void TestFuzzyQuery();
+// Тест проверяет, ранжирование BM25 и сжатие длин документов
+void TestBm25Scorer();
+// Тест проверяет, отбор по статусу через флаги списков и смену статуса документа
+void TestDocumentStatusChange();
+// Тест проверяет, фильтры по столбцам атрибутов документов
+void TestDocumentFilter();
+// Тест проверяет, пакетное удаление документов и поиск почти-дубликатов
+void TestNearDuplicates();
+// Тест проверяет, политики обработки дубликатов при добавлении документа
+void TestDuplicatePolicy();
+// Тест проверяет, подготовленные запросы дают те же результаты, что и разбор текста запроса
+void TestPreparedQuery();
+// Тест проверяет, постраничную выдачу по смещению и по курсору
+void TestSearchPages();
+// Тест проверяет, пересечение списков документов и запросы в режиме QueryMode::ALL
+void TestConjunctiveQuery();
+// Тест проверяет, совершенную хеш-функцию стоп-слов и удаление повторов слов запроса
+void TestStopWordFilter();
+// Тест проверяет, анализатор UTF-8: проверку кодировки, разделители Unicode и приведение к нижнему регистру
+void TestTextAnalyzer();
+// Тест проверяет, что квантованные оценки дают одинаковую выдачу при последовательном и параллельном поиске
+void TestQuantizedScorer();
+// Тест проверяет, процентили гистограммы задержек и слияние гистограмм фаз из разных потоков
+void TestLatencyHistogram();
+// Тест проверяет, окна статистики запросов, обнуление корзин кольца и запись из нескольких потоков
+void TestQueryStatistics();
+// Тест проверяет, что explain дает ту же выдачу, что FindTopDocuments, и правильно считает документы по словам
+void TestExplainTopDocuments();
+// Тест проверяет, распределение Ципфа, корректность генерируемой нагрузки и чтение журнала операций
+void TestZipfWorkload();
+// Тест проверяет, счетчики процессора и их отсутствие без доступа к perf_event_open
+void TestPerfCounters();
+// Тест проверяет, политики памяти индекса, счетчики выделений и одинаковую выдачу при обеих политиках
+void TestIndexAllocation();
+// Тест проверяет, копирование и перемещение сервера переносят каждый контейнер индекса
+void TestServerCopyAndMove();
 // запуск тестов
 void TestSearchServer();
 //-------------------------------------------------------------------------------------------------------------
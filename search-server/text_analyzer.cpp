@@ -0,0 +1,228 @@
+#include "text_analyzer.h"
+#include "string_processing.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Байтовые маски для обработки 8 байт ASCII одним 64-битным словом (SWAR). Слагаемые подобраны так,
+ *  что для байтов меньше 0x80 сумма не переносится в соседний байт, а старший бит суммы - результат сравнения */
+static constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+static constexpr uint64_t BYTES_80_MINUS_A = 0x3F3F3F3F3F3F3F3Full;    // 0x80 - 'A'
+static constexpr uint64_t BYTES_7F_MINUS_Z = 0x2525252525252525ull;    // 0x7F - 'Z'
+static constexpr uint64_t BYTES_80_MINUS_SPACE = 0x6060606060606060ull; // 0x80 - ' '
+//-------------------------------------------------------------------------------------------------------------
+static uint64_t LoadWord(const char* data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Старший бит каждого байта 'A'..'Z', word - только байты ASCII */
+static uint64_t UpperCaseMask(uint64_t word) {
+    return (word + BYTES_80_MINUS_A) & ~(word + BYTES_7F_MINUS_Z) & HIGH_BITS;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Старший бит каждого управляющего байта (меньше ' '), word - только байты ASCII */
+static uint64_t ControlMask(uint64_t word) {
+    return ~(word + BYTES_80_MINUS_SPACE) & HIGH_BITS;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Байт, который анализатор UTF8 может изменить: не ASCII, заглавная буква или управляющий символ */
+static bool IsChangingByte(unsigned char byte) {
+    return byte >= 0x80 || byte < 0x20 || (byte >= 'A' && byte <= 'Z');
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Позиция первого байта, который может измениться, или text.size() */
+static size_t FindFirstChange(string_view text) {
+    size_t pos = 0;
+    for (; pos + sizeof(uint64_t) <= text.size(); pos += sizeof(uint64_t)) {
+        const uint64_t word = LoadWord(text.data() + pos);
+        if ((word & HIGH_BITS) != 0 || (UpperCaseMask(word) | ControlMask(word)) != 0) {
+            break;
+        }
+    }
+    while (pos < text.size() && !IsChangingByte(static_cast<unsigned char>(text[pos]))) {
+        ++pos;
+    }
+    return pos;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Кодовая точка по позиции pos с проверкой UTF-8: обрезанные и лишние байты продолжения, избыточная
+ *  длина, суррогаты и кодовые точки больше U+10FFFF - invalid_argument. pos сдвигается за последовательность */
+static char32_t DecodeStrict(string_view text, size_t& pos) {
+    const auto lead = static_cast<unsigned char>(text[pos]);
+    size_t length = 0;
+    char32_t min_code_point = 0;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+        min_code_point = 0x80;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        min_code_point = 0x800;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        min_code_point = 0x10000;
+    } else {
+        throw invalid_argument("invalid UTF-8 lead byte"s);
+    }
+    if (pos + length > text.size()) {
+        throw invalid_argument("truncated UTF-8 sequence"s);
+    }
+    char32_t code_point = lead & (0x7F >> length);
+    for (size_t i = 1; i < length; ++i) {
+        const auto byte = static_cast<unsigned char>(text[pos + i]);
+        if ((byte & 0xC0) != 0x80) {
+            throw invalid_argument("truncated UTF-8 sequence"s);
+        }
+        code_point = (code_point << 6) | (byte & 0x3F);
+    }
+    if (code_point < min_code_point || (code_point >= 0xD800 && code_point <= 0xDFFF) || code_point > 0x10FFFF) {
+        throw invalid_argument("invalid UTF-8 code point"s);
+    }
+    pos += length;
+    return code_point;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Заменяет последнюю букву out на составную, если combining - диакритика над ней:
+ *  и + U+0306 = й, е + U+0308 = ё (разложенная форма, которую дают некоторые системы) */
+static bool ComposeWithLast(char32_t combining, string& out) {
+    const auto ends_with = [&out](string_view suffix) {
+        return out.size() >= suffix.size() && string_view(out).substr(out.size() - suffix.size()) == suffix;
+    };
+    if (combining == 0x0306 && ends_with("\xD0\xB8"sv)) {
+        out.back() = '\xB9';
+        return true;
+    }
+    if (combining == 0x0308 && ends_with("\xD0\xB5"sv)) {
+        out.resize(out.size() - 2);
+        out += "\xD1\x91"sv;
+        return true;
+    }
+    return false;
+}
+//-------------------------------------------------------------------------------------------------------------
+static string_view AnalyzeUtf8(string_view text, string& buffer) {
+    size_t pos = FindFirstChange(text);
+    if (pos == text.size()) {
+        return text;
+    }
+    buffer.clear();
+    buffer.reserve(text.size());
+    buffer.append(text.substr(0, pos));
+    while (pos < text.size()) {
+        if (pos + sizeof(uint64_t) <= text.size()) {
+            uint64_t word = LoadWord(text.data() + pos);
+            if ((word & HIGH_BITS) == 0 && ControlMask(word) == 0) {
+                word |= UpperCaseMask(word) >> 2; // 0x80 >> 2 == 'a' - 'A'
+                buffer.append(reinterpret_cast<const char*>(&word), sizeof(word));
+                pos += sizeof(uint64_t);
+                continue;
+            }
+        }
+        const auto byte = static_cast<unsigned char>(text[pos]);
+        if (byte < 0x80) {
+            buffer.push_back(IsUnicodeSpace(byte) ? ' ' : static_cast<char>(FoldCase(byte)));
+            ++pos;
+            continue;
+        }
+        const char32_t code_point = FoldCase(DecodeStrict(text, pos));
+        if (IsUnicodeSpace(code_point)) {
+            buffer.push_back(' ');
+        } else if (!ComposeWithLast(code_point, buffer)) {
+            AppendUtf8(code_point, buffer);
+        }
+    }
+    return buffer;
+}
+//-------------------------------------------------------------------------------------------------------------
+std::string_view AnalyzeText(TextAnalyzer analyzer, std::string_view text, std::string& buffer) {
+    switch (analyzer) {
+    case TextAnalyzer::LEGACY:
+        return text;
+    case TextAnalyzer::UTF8:
+        return AnalyzeUtf8(text, buffer);
+    }
+    return text;
+}
+//-------------------------------------------------------------------------------------------------------------
+char32_t FoldCase(char32_t code_point) {
+    // в блоках Latin Extended-A и кириллицы строчная буква пары - соседняя кодовая точка
+    const auto fold_pair = [code_point](char32_t first, char32_t last, bool upper_is_even) -> char32_t {
+        if (code_point < first || code_point > last || ((code_point % 2 == 0) != upper_is_even)) {
+            return 0;
+        }
+        return code_point + 1;
+    };
+    if (code_point < 0x80) {
+        return code_point >= 'A' && code_point <= 'Z' ? code_point + ('a' - 'A') : code_point;
+    }
+    if (code_point < 0x100) {
+        if (code_point == 0xB5) {
+            return 0x3BC; // знак микро - греческая мю
+        }
+        return code_point >= 0xC0 && code_point <= 0xDE && code_point != 0xD7 ? code_point + 0x20 : code_point;
+    }
+    if (code_point < 0x180) {
+        if (code_point == 0x178) {
+            return 0xFF;
+        }
+        if (code_point == 0x17F) {
+            return 's';
+        }
+        for (const char32_t folded : {fold_pair(0x100, 0x12F, true), fold_pair(0x132, 0x137, true),
+                                      fold_pair(0x139, 0x148, false), fold_pair(0x14A, 0x177, true),
+                                      fold_pair(0x179, 0x17E, false)}) {
+            if (folded != 0) {
+                return folded;
+            }
+        }
+        return code_point;
+    }
+    if (code_point >= 0x386 && code_point <= 0x3AB) {
+        if (code_point == 0x386) {
+            return 0x3AC;
+        }
+        if (code_point >= 0x388 && code_point <= 0x38A) {
+            return code_point + 0x25;
+        }
+        if (code_point == 0x38C) {
+            return 0x3CC;
+        }
+        if (code_point == 0x38E || code_point == 0x38F) {
+            return code_point + 0x3F;
+        }
+        return code_point >= 0x391 && code_point != 0x3A2 ? code_point + 0x20 : code_point;
+    }
+    if (code_point == 0x3C2) {
+        return 0x3C3; // конечная сигма
+    }
+    if (code_point >= 0x400 && code_point <= 0x52F) {
+        if (code_point < 0x410) {
+            return code_point + 0x50;
+        }
+        if (code_point < 0x430) {
+            return code_point + 0x20;
+        }
+        if (code_point == 0x4C0) {
+            return 0x4CF;
+        }
+        for (const char32_t folded : {fold_pair(0x460, 0x481, true), fold_pair(0x48A, 0x4BF, true),
+                                      fold_pair(0x4C1, 0x4CE, false), fold_pair(0x4D0, 0x52F, true)}) {
+            if (folded != 0) {
+                return folded;
+            }
+        }
+    }
+    return code_point;
+}
+//-------------------------------------------------------------------------------------------------------------
+bool IsUnicodeSpace(char32_t code_point) {
+    return (code_point >= 0x09 && code_point <= 0x0D) || code_point == 0x20 || code_point == 0x85
+           || code_point == 0xA0 || code_point == 0x1680 || (code_point >= 0x2000 && code_point <= 0x200A)
+           || code_point == 0x2028 || code_point == 0x2029 || code_point == 0x202F || code_point == 0x205F
+           || code_point == 0x3000;
+}
+//-------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+//-------------------------------------------------------------------------------------------------------------
+/** Анализатор текста документов и запросов: как текст делится на слова и приводится к единой форме */
+enum class TextAnalyzer {
+    LEGACY, // слова разделяются пробелами ASCII, текст не меняется
+    UTF8,   // проверка UTF-8, разделители - пробельные символы Unicode, приведение к нижнему регистру
+};
+//-------------------------------------------------------------------------------------------------------------
+/** Текст после анализатора: сам text, если менять нечего, иначе нормализованная копия в buffer.
+ *  Все разделители слов заменяются на ' ', поэтому результат разбивается обычным SplitIntoWords.
+ *  Для UTF8 неверная последовательность UTF-8 - invalid_argument. Текст ASCII проверяется
+ *  и переводится в нижний регистр по 8 байт за раз */
+std::string_view AnalyzeText(TextAnalyzer analyzer, std::string_view text, std::string& buffer);
+//-------------------------------------------------------------------------------------------------------------
+/** Простое приведение к нижнему регистру (simple case folding) для латиницы, кириллицы и греческого,
+ *  остальные кодовые точки возвращаются как есть */
+char32_t FoldCase(char32_t code_point);
+//-------------------------------------------------------------------------------------------------------------
+/** Пробельный символ Unicode (свойство White_Space) */
+bool IsUnicodeSpace(char32_t code_point);
+//-------------------------------------------------------------------------------------------------------------
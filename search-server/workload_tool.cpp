@@ -0,0 +1,293 @@
+#include <chrono>
+#include <execution>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "corpus_generator.h"
+#include "latency_histogram.h"
+#include "search_server.h"
+
+using namespace std;
+//-------------------------------------------------------------------------------------------------------------
+/** Аргументы --имя=значение (или --имя для флагов) после команды */
+static map<string, string> ParseOptions(int argc, char* argv[]) {
+    map<string, string> options;
+    for (int i = 2; i < argc; ++i) {
+        const string argument = argv[i];
+        if (argument.rfind("--"s, 0) != 0) {
+            throw invalid_argument("unknown argument "s + argument);
+        }
+        const size_t equal = argument.find('=');
+        options[argument.substr(2, equal == string::npos ? string::npos : equal - 2)] =
+            equal == string::npos ? ""s : argument.substr(equal + 1);
+    }
+    return options;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Значение опции с проверкой: опция, которую команда не знает, - ошибка */
+class Options {
+public:
+    explicit Options(map<string, string> options)
+        : options_(move(options)) {
+    }
+
+    string GetString(const string& name, const string& default_value) {
+        const auto it = options_.find(name);
+        if (it == options_.end()) {
+            return default_value;
+        }
+        string value = it->second;
+        options_.erase(it);
+        return value;
+    }
+
+    string GetRequired(const string& name) {
+        if (options_.count(name) == 0) {
+            throw invalid_argument("missing --"s + name);
+        }
+        return GetString(name, {});
+    }
+
+    int GetInt(const string& name, int default_value) {
+        const string value = GetString(name, to_string(default_value));
+        size_t parsed = 0;
+        const int result = stoi(value, &parsed);
+        if (parsed != value.size() || result < 0) {
+            throw invalid_argument("expected non-negative integer for --"s + name + ", got "s + value);
+        }
+        return result;
+    }
+
+    double GetDouble(const string& name, double default_value) {
+        const string value = GetString(name, to_string(default_value));
+        size_t parsed = 0;
+        const double result = stod(value, &parsed);
+        if (parsed != value.size() || !(result >= 0.0)) {
+            throw invalid_argument("expected non-negative number for --"s + name + ", got "s + value);
+        }
+        return result;
+    }
+
+    bool GetFlag(const string& name) {
+        const bool has_flag = options_.count(name) > 0;
+        options_.erase(name);
+        return has_flag;
+    }
+
+    void CheckAllUsed() const {
+        if (!options_.empty()) {
+            throw invalid_argument("unknown option --"s + options_.begin()->first);
+        }
+    }
+
+private:
+    map<string, string> options_;
+};
+//-------------------------------------------------------------------------------------------------------------
+static DocumentLengthDistribution ParseLengthDistribution(const string& name) {
+    if (name == "fixed"s) {
+        return DocumentLengthDistribution::FIXED;
+    } else if (name == "uniform"s) {
+        return DocumentLengthDistribution::UNIFORM;
+    } else if (name == "lognormal"s) {
+        return DocumentLengthDistribution::LOG_NORMAL;
+    }
+    throw invalid_argument("unknown length distribution "s + name);
+}
+//-------------------------------------------------------------------------------------------------------------
+static void WriteFile(const string& path, const vector<WorkloadOperation>& operations) {
+    ofstream out(path);
+    if (!out) {
+        throw runtime_error("cannot write "s + path);
+    }
+    WriteWorkloadOperations(out, operations);
+}
+//-------------------------------------------------------------------------------------------------------------
+static vector<WorkloadOperation> ReadFile(const string& path) {
+    ifstream in(path);
+    if (!in) {
+        throw runtime_error("cannot read "s + path);
+    }
+    return ReadWorkloadOperations(in);
+}
+//-------------------------------------------------------------------------------------------------------------
+static int GenerateCommand(Options options) {
+    WorkloadConfig config;
+    const string corpus_path = options.GetRequired("corpus"s);
+    const string log_path = options.GetRequired("log"s);
+    config.vocabulary_size = options.GetInt("vocabulary"s, config.vocabulary_size);
+    config.max_word_length = options.GetInt("max-word-length"s, config.max_word_length);
+    config.word_exponent = options.GetDouble("word-exponent"s, config.word_exponent);
+    config.document_count = options.GetInt("documents"s, config.document_count);
+    config.document_length_distribution = ParseLengthDistribution(options.GetString("length-distribution"s, "lognormal"s));
+    config.mean_document_length = options.GetInt("document-words"s, config.mean_document_length);
+    config.document_length_sigma = options.GetDouble("length-sigma"s, config.document_length_sigma);
+    config.operation_count = options.GetInt("operations"s, config.operation_count);
+    config.query_word_count = options.GetInt("query-words"s, config.query_word_count);
+    config.minus_word_prob = options.GetDouble("minus-prob"s, config.minus_word_prob);
+    config.distinct_query_count = options.GetInt("distinct-queries"s, config.distinct_query_count);
+    config.query_exponent = options.GetDouble("query-exponent"s, config.query_exponent);
+    config.churn_ratio = options.GetDouble("churn"s, config.churn_ratio);
+    config.seed = static_cast<unsigned>(options.GetInt("seed"s, static_cast<int>(config.seed)));
+    options.CheckAllUsed();
+
+    const Workload workload = GenerateWorkload(config);
+    WriteFile(corpus_path, workload.corpus);
+    WriteFile(log_path, workload.operations);
+    cout << "corpus: "s << workload.corpus.size() << " documents, log: "s << workload.operations.size() << " operations"s << endl;
+    return 0;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Задержки операций одного типа и число ошибок (добавление существующего id и т.п.) */
+struct OperationStats {
+    LatencyHistogram latency;
+    uint64_t failed_count = 0;
+};
+//-------------------------------------------------------------------------------------------------------------
+static string_view OperationName(WorkloadOperation::Type type) {
+    switch (type) {
+    case WorkloadOperation::Type::ADD:
+        return "add"sv;
+    case WorkloadOperation::Type::REMOVE:
+        return "remove"sv;
+    case WorkloadOperation::Type::QUERY:
+        return "query"sv;
+    }
+    return "unknown"sv;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** Выполняет операцию и возвращает число найденных документов (для запросов) */
+template <typename ExecutionPolicy>
+static size_t ExecuteOperation(ExecutionPolicy&& policy, SearchServer& server, const WorkloadOperation& operation) {
+    switch (operation.type) {
+    case WorkloadOperation::Type::ADD:
+        server.AddDocument(operation.document_id, operation.text, DocumentStatus::ACTUAL, {1});
+        return 0;
+    case WorkloadOperation::Type::REMOVE:
+        server.RemoveDocument(operation.document_id);
+        return 0;
+    case WorkloadOperation::Type::QUERY:
+        return server.FindTopDocuments(policy, operation.text).size();
+    }
+    return 0;
+}
+//-------------------------------------------------------------------------------------------------------------
+/** При заданной частоте операции запускаются по расписанию, не дожидаясь медленных предыдущих сверх их очереди:
+ *  задержка считается от запланированного момента, поэтому отставание от расписания входит в задержку,
+ *  а не прячется (coordinated omission). Без частоты операции идут подряд с наибольшей пропускной способностью */
+template <typename ExecutionPolicy>
+static void Replay(ExecutionPolicy&& policy, SearchServer& server, const vector<WorkloadOperation>& operations, double rate,
+                   map<WorkloadOperation::Type, OperationStats>& stats, uint64_t& zero_result_count) {
+    const auto start = chrono::steady_clock::now();
+    const auto period = rate > 0 ? chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / rate))
+                                 : chrono::steady_clock::duration::zero();
+    for (size_t i = 0; i < operations.size(); ++i) {
+        const WorkloadOperation& operation = operations[i];
+        auto scheduled = chrono::steady_clock::now();
+        if (rate > 0) {
+            scheduled = start + period * static_cast<int64_t>(i);
+            this_thread::sleep_until(scheduled);
+        }
+        OperationStats& operation_stats = stats[operation.type];
+        try {
+            const size_t result_count = ExecuteOperation(policy, server, operation);
+            if (operation.type == WorkloadOperation::Type::QUERY && result_count == 0) {
+                ++zero_result_count;
+            }
+        } catch (const exception&) {
+            ++operation_stats.failed_count;
+        }
+        const auto latency = chrono::steady_clock::now() - scheduled;
+        operation_stats.latency.Record(static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(latency).count()));
+    }
+}
+//-------------------------------------------------------------------------------------------------------------
+static int ReplayCommand(Options options) {
+    const string corpus_path = options.GetRequired("corpus"s);
+    const string log_path = options.GetRequired("log"s);
+    const double rate = options.GetDouble("rate"s, 0.0);
+    const string policy = options.GetString("policy"s, "seq"s);
+    const bool is_json = options.GetFlag("json"s);
+    options.CheckAllUsed();
+    if (policy != "seq"s && policy != "par"s) {
+        throw invalid_argument("--policy must be seq or par"s);
+    }
+
+    const vector<WorkloadOperation> corpus = ReadFile(corpus_path);
+    const vector<WorkloadOperation> operations = ReadFile(log_path);
+    SearchServer server(""s);
+    const auto build_start = chrono::steady_clock::now();
+    for (const WorkloadOperation& operation : corpus) {
+        ExecuteOperation(execution::seq, server, operation);
+    }
+    const auto build_duration = chrono::steady_clock::now() - build_start;
+
+    map<WorkloadOperation::Type, OperationStats> stats;
+    uint64_t zero_result_count = 0;
+    const auto replay_start = chrono::steady_clock::now();
+    if (policy == "par"s) {
+        Replay(execution::par, server, operations, rate, stats, zero_result_count);
+    } else {
+        Replay(execution::seq, server, operations, rate, stats, zero_result_count);
+    }
+    const double replay_seconds = chrono::duration<double>(chrono::steady_clock::now() - replay_start).count();
+    const double build_seconds = chrono::duration<double>(build_duration).count();
+    const uint64_t query_count = stats.count(WorkloadOperation::Type::QUERY) ? stats[WorkloadOperation::Type::QUERY].latency.Count() : 0;
+
+    if (is_json) {
+        cout << "{\n  \"index_build_seconds\": "s << build_seconds << ",\n  \"replay_seconds\": "s << replay_seconds
+             << ",\n  \"ops_per_sec\": "s << (replay_seconds > 0 ? operations.size() / replay_seconds : 0.0)
+             << ",\n  \"zero_result_queries\": "s << zero_result_count << ",\n  \"operations\": [\n"s;
+        size_t written = 0;
+        for (const auto& [type, operation_stats] : stats) {
+            const LatencySnapshot latency = operation_stats.latency.Snapshot();
+            cout << "    {\"name\": \""s << OperationName(type) << "\", \"count\": "s << latency.count
+                 << ", \"failed\": "s << operation_stats.failed_count
+                 << ", \"min_ns\": "s << latency.min_ns << ", \"p50_ns\": "s << latency.p50_ns
+                 << ", \"p99_ns\": "s << latency.p99_ns << ", \"p999_ns\": "s << latency.p999_ns
+                 << ", \"max_ns\": "s << latency.max_ns << "}"s << (++written < stats.size() ? ",\n"s : "\n"s);
+        }
+        cout << "  ]\n}\n"s;
+        return 0;
+    }
+    cout << fixed << setprecision(3) << "index build: "s << corpus.size() << " documents in "s << build_seconds << " s\n"s
+         << "replay: "s << operations.size() << " operations in "s << replay_seconds << " s ("s << setprecision(1)
+         << (replay_seconds > 0 ? operations.size() / replay_seconds : 0.0) << " ops/s), zero-result queries: "s
+         << zero_result_count << " of "s << query_count << "\n\n"s;
+    cout << left << setw(10) << "operation"s << right << setw(10) << "count"s << setw(10) << "failed"s << setw(14) << "p50 ns"s
+         << setw(14) << "p99 ns"s << setw(14) << "p999 ns"s << setw(14) << "max ns"s << '\n';
+    for (const auto& [type, operation_stats] : stats) {
+        const LatencySnapshot latency = operation_stats.latency.Snapshot();
+        cout << left << setw(10) << OperationName(type) << right << setw(10) << latency.count << setw(10) << operation_stats.failed_count
+             << setw(14) << latency.p50_ns << setw(14) << latency.p99_ns << setw(14) << latency.p999_ns << setw(14) << latency.max_ns << '\n';
+    }
+    return 0;
+}
+//-------------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    const string command = argc > 1 ? argv[1] : ""s;
+    try {
+        if (command == "generate"s) {
+            return GenerateCommand(Options(ParseOptions(argc, argv)));
+        } else if (command == "replay"s) {
+            return ReplayCommand(Options(ParseOptions(argc, argv)));
+        }
+        throw invalid_argument(command.empty() ? "missing command"s : "unknown command "s + command);
+    } catch (const exception& e) {
+        cerr << e.what() << "\nusage:\n"
+                            "  workload_tool generate --corpus=FILE --log=FILE [--vocabulary=N] [--max-word-length=N] [--word-exponent=X]\n"
+                            "      [--documents=N] [--length-distribution=fixed|uniform|lognormal] [--document-words=N] [--length-sigma=X]\n"
+                            "      [--operations=N] [--query-words=N] [--minus-prob=X] [--distinct-queries=N] [--query-exponent=X]\n"
+                            "      [--churn=X] [--seed=N]\n"
+                            "  workload_tool replay --corpus=FILE --log=FILE [--rate=OPS_PER_SEC] [--policy=seq|par] [--json]"s
+             << endl;
+        return 1;
+    }
+}
+//-------------------------------------------------------------------------------------------------------------